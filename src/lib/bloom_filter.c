@@ -0,0 +1,122 @@
+#include "bloom_filter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Odd constants spreading a key's 32 low hash bits over the eight words,
+// the same ones Parquet and Impala use
+static const uint32_t BLOOM_SALTS[8] = {0x47b6137bu, 0x44974d91u, 0x8824ad5bu,
+                                        0xa2b7289du, 0x705495c7u, 0x2df1424bu,
+                                        0x9efc4947u, 0x5c6bfb31u};
+
+//-----------------Internal Functions-----------------
+
+static uint64_t          mix(uint64_t hash);
+static BloomFilterBlock* block_for(const BloomFilter* filter, uint64_t hash);
+
+//----------------------------------------------------
+
+int bloom_filter_initiate(BloomFilter* filter, size_t capacity,
+                          unsigned bits_per_key) {
+    if (bits_per_key == 0) {
+        bits_per_key = BLOOM_FILTER_DEFAULT_BITS_PER_KEY;
+    }
+
+    size_t bits         = (capacity ? capacity : 1) * bits_per_key;
+    filter->block_count = (bits + 255) / 256;
+    filter->capacity    = capacity;
+    filter->count       = 0;
+
+    // Blocks are cache line aligned so no lookup straddles two lines
+    size_t size    = filter->block_count * sizeof(BloomFilterBlock);
+    filter->blocks = aligned_alloc(64, (size + 63) & ~(size_t)63);
+    if (filter->blocks == NULL) {
+        filter->block_count = 0;
+        return -2;
+    }
+    memset(filter->blocks, 0, size);
+
+    return 0;
+}
+
+void bloom_filter_add(BloomFilter* filter, uint64_t hash) {
+    hash                    = mix(hash);
+    BloomFilterBlock* block = block_for(filter, hash);
+    uint32_t          key   = (uint32_t)hash;
+
+    for (int i = 0; i < 8; i++) {
+        block->words[i] |= 1u << ((key * BLOOM_SALTS[i]) >> 27);
+    }
+    filter->count++;
+}
+
+int bloom_filter_may_contain(const BloomFilter* filter, uint64_t hash) {
+    hash                          = mix(hash);
+    const BloomFilterBlock* block = block_for(filter, hash);
+    uint32_t                key   = (uint32_t)hash;
+
+    // No early exit, the branch-free loop vectorises
+    uint32_t missing = 0;
+    for (int i = 0; i < 8; i++) {
+        missing |= ~block->words[i] & (1u << ((key * BLOOM_SALTS[i]) >> 27));
+    }
+    return missing == 0;
+}
+
+void bloom_filter_clear(BloomFilter* filter) {
+    memset(filter->blocks, 0, filter->block_count * sizeof(BloomFilterBlock));
+    filter->count = 0;
+}
+
+double bloom_filter_false_positive_rate(const BloomFilter* filter) {
+    if (filter->block_count == 0) {
+        return 0.0;
+    }
+
+    // A miss passes a word with the word's fill ratio as probability
+    double total = 0.0;
+    for (size_t i = 0; i < filter->block_count; i++) {
+        double rate = 1.0;
+        for (int j = 0; j < 8; j++) {
+            rate *= __builtin_popcount(filter->blocks[i].words[j]) / 32.0;
+        }
+        total += rate;
+    }
+    return total / (double)filter->block_count;
+}
+
+size_t bloom_filter_memory(const BloomFilter* filter) {
+    return filter->block_count * sizeof(BloomFilterBlock);
+}
+
+void bloom_filter_dispose(BloomFilter* filter) {
+    free(filter->blocks);
+    filter->blocks      = NULL;
+    filter->block_count = 0;
+    filter->capacity    = 0;
+    filter->count       = 0;
+}
+
+/* ============= Internal Functions Implementation ============= */
+
+/**
+ * Callers' hashes may be weak in some bits (FNV-1a is in its high ones), the
+ * MurmurHash3 finaliser spreads every input bit over the result
+ */
+static uint64_t mix(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * The high half picks the block, by multiply-shift rather than modulo so
+ * any block count works
+ */
+static BloomFilterBlock* block_for(const BloomFilter* filter, uint64_t hash) {
+    uint64_t index = ((hash >> 32) * (uint64_t)filter->block_count) >> 32;
+    return &filter->blocks[index];
+}
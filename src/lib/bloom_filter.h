@@ -0,0 +1,49 @@
+/// Split block Bloom filter. Each key lands in one 32-byte block and sets a
+/// single bit in each of its eight words, so a lookup reads one cache line
+/// and answers either "definitely absent" or "maybe present". Keys are given
+/// as 64-bit hashes, the filter never sees the keys themselves. Bits cannot
+/// be cleared, so owners removing keys rebuild the filter now and then.
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// About 1.3% false positives
+#ifndef BLOOM_FILTER_DEFAULT_BITS_PER_KEY
+#    define BLOOM_FILTER_DEFAULT_BITS_PER_KEY 10
+#endif
+
+typedef struct {
+    uint32_t words[8];
+} BloomFilterBlock;
+
+typedef struct {
+    BloomFilterBlock* blocks;
+    size_t            block_count;
+    size_t            capacity; // Keys it was sized for
+    size_t            count;    // Keys added, repeats included
+} BloomFilter;
+
+/* Sizes the filter for capacity keys at bits_per_key, 0 picks the default.
+ * Returns 0 on success and -2 on allocation failure. */
+int bloom_filter_initiate(BloomFilter* filter, size_t capacity,
+                          unsigned bits_per_key);
+
+void bloom_filter_add(BloomFilter* filter, uint64_t hash);
+
+/* 0 if hash was never added, 1 if it may have been */
+int bloom_filter_may_contain(const BloomFilter* filter, uint64_t hash);
+
+/* Forgets every key, keeping the size */
+void bloom_filter_clear(BloomFilter* filter);
+
+/* Chance that a key never added is reported present, estimated from how
+ * full each block is */
+double bloom_filter_false_positive_rate(const BloomFilter* filter);
+
+size_t bloom_filter_memory(const BloomFilter* filter);
+
+void bloom_filter_dispose(BloomFilter* filter);
+
+#endif // BLOOM_FILTER_H
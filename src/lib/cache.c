@@ -2,11 +2,38 @@
 
 #include <stdio.h>
 
+// Buckets per cache, a power of two near max_size within these bounds
+#define CACHE_MIN_BUCKETS 16
+#define CACHE_MAX_BUCKETS (1u << 16)
+
+// FNV-1a over a string key
+static uint64_t hash_key(const char* key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (; *key; key++) {
+        hash ^= (uint8_t)*key;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// MurmurHash3's 64-bit finalizer. Every bit of the id reaches the low bits
+// picking the bucket, and being a bijection equal hashes mean equal ids.
+static uint64_t hash_id(uint64_t id) {
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdull;
+    id ^= id >> 33;
+    id *= 0xc4ceb9fe1a85ec53ull;
+    id ^= id >> 33;
+    return id;
+}
+
 // Helper function to free a cache entry
-static void free_cache_entry(CacheEntry* entry) {
+static void free_cache_entry(Cache* cache, CacheEntry* entry) {
     if (entry) {
         free(entry->key);
-        free(entry->data);
+        if (entry->data) {
+            cache->free_data(entry->data);
+        }
         free(entry);
     }
 }
@@ -18,27 +45,114 @@ static int is_expired(CacheEntry* entry) {
     return (time(NULL) > entry->expiry);
 }
 
+static CacheEntry** bucket_of(Cache* cache, uint64_t hash) {
+    return &cache->buckets[hash & (cache->bucket_count - 1)];
+}
+
+// Entry with this hash and key, a NULL key matching integer keys only
+static CacheEntry* find_entry(Cache* cache, uint64_t hash, const char* key) {
+    for (CacheEntry* entry = *bucket_of(cache, hash); entry;
+         entry = entry->next) {
+        if (entry->hash == hash &&
+            (key ? entry->key && strcmp(entry->key, key) == 0 : !entry->key)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void remove_entry(Cache* cache, CacheEntry* entry) {
+    CacheEntry** link = bucket_of(cache, entry->hash);
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+
+    intrusive_list_remove(&cache->entries, &entry->hook);
+    free_cache_entry(cache, entry);
+}
+
+static int insert_entry(Cache* cache, uint64_t hash, const char* key,
+                        void* data, size_t data_size, time_t ttl) {
+    // Remove existing entry if it exists
+    CacheEntry* existing = find_entry(cache, hash, key);
+    if (existing) {
+        remove_entry(cache, existing);
+    }
+
+    // Check if cache is full
+    if (cache->entries.size >= cache->max_size && cache->entries.head) {
+        // Remove oldest entry (first in list)
+        remove_entry(cache, IntrusiveList_entry(cache->entries.head,
+                                                CacheEntry, hook));
+    }
+
+    // Create new entry, the cache owns data from here on
+    CacheEntry* entry = (CacheEntry*)malloc(sizeof(CacheEntry));
+    if (!entry) {
+        cache->free_data(data);
+        return -1;
+    }
+
+    entry->key  = NULL;
+    entry->data = data;
+    if (key && !(entry->key = strdup(key))) {
+        free_cache_entry(cache, entry);
+        return -1;
+    }
+
+    entry->hash      = hash;
+    entry->data_size = data_size;
+    entry->timestamp = time(NULL);
+    entry->expiry    = entry->timestamp + (ttl > 0 ? ttl : cache->default_ttl);
+
+    // Add to list and bucket
+    intrusive_list_append(&cache->entries, &entry->hook);
+    CacheEntry** bucket = bucket_of(cache, hash);
+    entry->next         = *bucket;
+    *bucket             = entry;
+
+    return 0;
+}
+
+static CacheEntry* peek_entry(Cache* cache, uint64_t hash, const char* key) {
+    CacheEntry* entry = find_entry(cache, hash, key);
+    if (entry && is_expired(entry)) {
+        remove_entry(cache, entry);
+        return NULL;
+    }
+    return entry;
+}
+
 Cache* cache_create(size_t max_size, time_t default_ttl) {
     Cache* cache = (Cache*)malloc(sizeof(Cache));
     if (!cache)
         return NULL;
 
-    cache->entries = linked_list_create();
-    if (!cache->entries) {
+    cache->bucket_count = CACHE_MIN_BUCKETS;
+    while (cache->bucket_count < max_size &&
+           cache->bucket_count < CACHE_MAX_BUCKETS) {
+        cache->bucket_count *= 2;
+    }
+    cache->buckets = calloc(cache->bucket_count, sizeof(CacheEntry*));
+    if (!cache->buckets) {
         free(cache);
         return NULL;
     }
 
+    intrusive_list_init(&cache->entries);
+
     cache->max_size    = max_size;
     cache->default_ttl = default_ttl;
+    cache->free_data   = free;
     return cache;
 }
 
 void cache_destroy(Cache* cache) {
     if (!cache)
         return;
-    linked_list_clear(cache->entries, (void (*)(void*))free_cache_entry);
-    linked_list_dispose(&cache->entries, NULL);
+    cache_clear(cache);
+    free(cache->buckets);
     free(cache);
 }
 
@@ -47,86 +161,104 @@ int cache_set(Cache* cache, const char* key, void* data, size_t data_size,
     if (!cache || !key || !data)
         return -1;
 
-    // Remove existing entry if it exists
-    cache_remove(cache, key);
-
-    // Check if cache is full
-    if (cache->entries->size >= cache->max_size) {
-        // Remove oldest entry (first in list)
-        if (cache->entries->head) {
-            CacheEntry* oldest = (CacheEntry*)cache->entries->head->item;
-            cache_remove(cache, oldest->key);
-        }
-    }
-
-    // Create new entry
-    CacheEntry* entry = (CacheEntry*)malloc(sizeof(CacheEntry));
-    if (!entry)
+    void* data_copy = malloc(data_size);
+    if (!data_copy)
         return -1;
+    memcpy(data_copy, data, data_size);
 
-    entry->key  = strdup(key);
-    entry->data = malloc(data_size);
-    if (!entry->key || !entry->data) {
-        free_cache_entry(entry);
-        return -1;
-    }
+    return cache_insert(cache, key, data_copy, data_size, ttl);
+}
 
-    memcpy(entry->data, data, data_size);
-    entry->data_size = data_size;
-    entry->timestamp = time(NULL);
-    entry->expiry    = entry->timestamp + (ttl > 0 ? ttl : cache->default_ttl);
+void cache_set_free_data(Cache* cache, CacheFreeData free_data) {
+    if (cache)
+        cache->free_data = free_data ? free_data : free;
+}
 
-    // Add to list
-    if (linked_list_append(cache->entries, entry) != 0) {
-        free_cache_entry(entry);
+int cache_insert(Cache* cache, const char* key, void* data, size_t data_size,
+                 time_t ttl) {
+    if (!cache || !key || !data)
         return -1;
-    }
 
-    return 0;
+    return insert_entry(cache, hash_key(key), key, data, data_size, ttl);
 }
 
 void* cache_get(Cache* cache, const char* key, size_t* data_size) {
     if (!cache || !key)
         return NULL;
 
-    LinkedList_foreach(cache->entries, node) {
-        CacheEntry* entry = (CacheEntry*)node->item;
-        if (strcmp(entry->key, key) == 0) {
-            if (is_expired(entry)) {
-                cache_remove(cache, key);
-                return NULL;
-            }
-            if (data_size)
-                *data_size = entry->data_size;
-            void* data_copy = malloc(entry->data_size);
-            if (data_copy) {
-                memcpy(data_copy, entry->data, entry->data_size);
-            }
-            return data_copy;
-        }
+    CacheEntry* entry = peek_entry(cache, hash_key(key), key);
+    if (!entry)
+        return NULL;
+
+    if (data_size)
+        *data_size = entry->data_size;
+    void* data_copy = malloc(entry->data_size);
+    if (data_copy) {
+        memcpy(data_copy, entry->data, entry->data_size);
     }
+    return data_copy;
+}
 
-    return NULL;
+void* cache_peek(Cache* cache, const char* key, size_t* data_size) {
+    if (!cache || !key)
+        return NULL;
+
+    CacheEntry* entry = peek_entry(cache, hash_key(key), key);
+    if (!entry)
+        return NULL;
+
+    if (data_size)
+        *data_size = entry->data_size;
+    return entry->data;
 }
 
 void cache_remove(Cache* cache, const char* key) {
     if (!cache || !key)
         return;
 
-    size_t index = 0;
-    LinkedList_foreach(cache->entries, node) {
-        CacheEntry* entry = (CacheEntry*)node->item;
-        if (strcmp(entry->key, key) == 0) {
-            linked_list_pop(cache->entries, index,
-                            (void (*)(void*))free_cache_entry);
-            return;
-        }
-        index++;
+    CacheEntry* entry = find_entry(cache, hash_key(key), key);
+    if (entry) {
+        remove_entry(cache, entry);
     }
 }
 
 void cache_clear(Cache* cache) {
     if (!cache)
         return;
-    linked_list_clear(cache->entries, (void (*)(void*))free_cache_entry);
-}
\ No newline at end of file
+    ListHook* hook;
+    while ((hook = intrusive_list_pop_front(&cache->entries)) != NULL) {
+        free_cache_entry(cache, IntrusiveList_entry(hook, CacheEntry, hook));
+    }
+    memset(cache->buckets, 0, cache->bucket_count * sizeof(CacheEntry*));
+}
+
+int cache_insert_id(Cache* cache, uint64_t id, void* data, size_t data_size,
+                    time_t ttl) {
+    if (!cache || !data)
+        return -1;
+
+    return insert_entry(cache, hash_id(id), NULL, data, data_size, ttl);
+}
+
+void* cache_peek_id(Cache* cache, uint64_t id, size_t* data_size) {
+    if (!cache)
+        return NULL;
+
+    CacheEntry* entry = peek_entry(cache, hash_id(id), NULL);
+    if (!entry)
+        return NULL;
+
+    if (data_size)
+        *data_size = entry->data_size;
+    return entry->data;
+}
+
+void cache_remove_id(Cache* cache, uint64_t id) {
+    if (!cache)
+        return;
+
+    CacheEntry* entry = find_entry(cache, hash_id(id), NULL);
+    if (entry) {
+        remove_entry(cache, entry);
+    }
+}
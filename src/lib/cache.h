@@ -3,24 +3,35 @@
 
 #include "linked_list.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
 // Cache entry structure
-typedef struct {
-    char*  key;       // Cache key (e.g., request URL or identifier)
-    void*  data;      // Cached data
-    size_t data_size; // Size of cached data
-    time_t timestamp; // When the entry was cached
-    time_t expiry;    // When the entry should expire
-} CacheEntry;
+typedef struct CacheEntry CacheEntry;
+struct CacheEntry {
+    ListHook    hook;      // Position in Cache.entries, oldest first
+    CacheEntry* next;      // Next entry in the same bucket
+    uint64_t    hash;      // Of key, or the mixed id when key is NULL
+    char*       key;       // Cache key (e.g., request URL or identifier)
+    void*       data;      // Cached data
+    size_t      data_size; // Size of cached data
+    time_t      timestamp; // When the entry was cached
+    time_t      expiry;    // When the entry should expire
+};
+
+// Releases the data of an entry that is removed or evicted
+typedef void (*CacheFreeData)(void* data);
 
 // Cache structure
 typedef struct {
-    LinkedList* entries;     // List of cache entries
-    size_t      max_size;    // Maximum number of entries
-    time_t      default_ttl; // Default time-to-live in seconds
+    IntrusiveList entries;      // List of cache entries
+    CacheEntry**  buckets;      // Entries chained by hash
+    size_t        bucket_count; // A power of two
+    size_t        max_size;     // Maximum number of entries
+    time_t        default_ttl;  // Default time-to-live in seconds
+    CacheFreeData free_data;    // free() unless set with cache_set_free_data
 } Cache;
 
 // Function declarations
@@ -29,7 +40,22 @@ void   cache_destroy(Cache* cache);
 int    cache_set(Cache* cache, const char* key, void* data, size_t data_size,
                  time_t ttl);
 void*  cache_get(Cache* cache, const char* key, size_t* data_size);
+
+// Ownership variants: the cache keeps the pointer itself instead of a copy
+// and releases it with free_data
+void  cache_set_free_data(Cache* cache, CacheFreeData free_data);
+int   cache_insert(Cache* cache, const char* key, void* data, size_t data_size,
+                   time_t ttl);
+void* cache_peek(Cache* cache, const char* key, size_t* data_size);
+
 void   cache_remove(Cache* cache, const char* key);
 void   cache_clear(Cache* cache);
 
-#endif /* CACHE_H */
\ No newline at end of file
+// Integer keys, e.g. packed coordinates: nothing is formatted, copied or
+// compared as a string. They never match a string key.
+int   cache_insert_id(Cache* cache, uint64_t id, void* data, size_t data_size,
+                      time_t ttl);
+void* cache_peek_id(Cache* cache, uint64_t id, size_t* data_size);
+void  cache_remove_id(Cache* cache, uint64_t id);
+
+#endif /* CACHE_H */
@@ -0,0 +1,199 @@
+#include "circuit_breaker.h"
+
+#include <string.h>
+
+// Weight of the newest success in the long-term latency baseline
+#define BASELINE_WEIGHT 0.05
+
+// Share of the limit kept when it is cut
+#define LIMIT_BACKOFF 0.5
+
+//-----------------Internal Functions-----------------
+
+static void   trip(CircuitBreaker* breaker, uint64_t now);
+static void   close_circuit(CircuitBreaker* breaker);
+static double average(double current, double sample, uint32_t samples);
+static void   adapt_limit(CircuitBreaker* breaker, uint64_t now, int success,
+                          double latency_ms);
+
+//----------------------------------------------------
+
+void circuit_breaker_initiate(CircuitBreaker* breaker, unsigned limit,
+                              unsigned limit_max) {
+    memset(breaker, 0, sizeof(CircuitBreaker));
+    breaker->state     = CIRCUIT_CLOSED;
+    breaker->limit_max = limit_max > CIRCUIT_BREAKER_MIN_LIMIT
+                             ? limit_max
+                             : CIRCUIT_BREAKER_MIN_LIMIT;
+    breaker->limit     = limit > CIRCUIT_BREAKER_MIN_LIMIT
+                             ? limit
+                             : CIRCUIT_BREAKER_MIN_LIMIT;
+    if (breaker->limit > breaker->limit_max) {
+        breaker->limit = breaker->limit_max;
+    }
+
+    circuit_breaker_set_thresholds(breaker, 50, 0, 5000);
+}
+
+void circuit_breaker_set_thresholds(CircuitBreaker* breaker, int error_percent,
+                                    int latency_ms, int open_ms) {
+    breaker->error_threshold      = error_percent > 0 ? error_percent / 100.0
+                                                      : 0.0;
+    breaker->latency_threshold_ms = latency_ms > 0 ? latency_ms : 0.0;
+    breaker->open_ms              = open_ms > 0 ? (uint64_t)open_ms : 1;
+    breaker->backoff_ms           = breaker->open_ms;
+}
+
+int circuit_breaker_acquire(CircuitBreaker* breaker, uint64_t now) {
+    if (breaker->state == CIRCUIT_OPEN) {
+        if (now < breaker->open_until) {
+            breaker->rejected++;
+            return 0;
+        }
+        breaker->state  = CIRCUIT_HALF_OPEN;
+        breaker->probes = 0;
+    }
+
+    uint32_t limit = breaker->state == CIRCUIT_HALF_OPEN
+                         ? 1
+                         : (uint32_t)breaker->limit;
+    if (breaker->in_flight >= limit) {
+        breaker->rejected++;
+        return 0;
+    }
+
+    breaker->in_flight++;
+    return 1;
+}
+
+void circuit_breaker_release(CircuitBreaker* breaker, uint64_t now,
+                             int success, double latency_ms) {
+    circuit_breaker_cancel(breaker);
+
+    // Calls that were in flight when it opened say nothing new
+    if (breaker->state == CIRCUIT_OPEN) {
+        return;
+    }
+
+    breaker->error_rate = average(breaker->error_rate, success ? 0.0 : 1.0,
+                                  breaker->samples);
+    breaker->latency_ms = average(breaker->latency_ms, latency_ms,
+                                  breaker->samples);
+    breaker->samples++;
+
+    if (breaker->state == CIRCUIT_HALF_OPEN) {
+        if (!success) {
+            trip(breaker, now);
+        } else if (++breaker->probes >= CIRCUIT_BREAKER_PROBES) {
+            close_circuit(breaker);
+        }
+        return;
+    }
+
+    if (breaker->samples >= CIRCUIT_BREAKER_MIN_SAMPLES &&
+        ((breaker->error_threshold > 0.0 &&
+          breaker->error_rate >= breaker->error_threshold) ||
+         (breaker->latency_threshold_ms > 0.0 &&
+          breaker->latency_ms >= breaker->latency_threshold_ms))) {
+        trip(breaker, now);
+        return;
+    }
+
+    adapt_limit(breaker, now, success, latency_ms);
+}
+
+void circuit_breaker_cancel(CircuitBreaker* breaker) {
+    if (breaker->in_flight > 0) {
+        breaker->in_flight--;
+    }
+}
+
+const char* circuit_breaker_state_name(CircuitState state) {
+    switch (state) {
+    case CIRCUIT_CLOSED:
+        return "closed";
+    case CIRCUIT_OPEN:
+        return "open";
+    case CIRCUIT_HALF_OPEN:
+        return "half-open";
+    }
+    return "unknown";
+}
+
+/* ============= Internal Functions Implementation ============= */
+
+static void trip(CircuitBreaker* breaker, uint64_t now) {
+    // A probe failing means upstream is still down, wait longer next time
+    if (breaker->state == CIRCUIT_HALF_OPEN) {
+        uint64_t max = breaker->open_ms * CIRCUIT_BREAKER_MAX_BACKOFF;
+        breaker->backoff_ms =
+            breaker->backoff_ms * 2 < max ? breaker->backoff_ms * 2 : max;
+    }
+
+    breaker->state      = CIRCUIT_OPEN;
+    breaker->open_until = now + breaker->backoff_ms;
+    breaker->opened++;
+}
+
+static void close_circuit(CircuitBreaker* breaker) {
+    // Averages start over, the outage must not reopen it right away
+    breaker->state      = CIRCUIT_CLOSED;
+    breaker->samples    = 0;
+    breaker->error_rate = 0.0;
+    breaker->latency_ms = 0.0;
+    breaker->backoff_ms = breaker->open_ms;
+
+    // Start small again rather than send the old limit at a recovering host
+    breaker->limit *= LIMIT_BACKOFF;
+    if (breaker->limit < CIRCUIT_BREAKER_MIN_LIMIT) {
+        breaker->limit = CIRCUIT_BREAKER_MIN_LIMIT;
+    }
+}
+
+static double average(double current, double sample, uint32_t samples) {
+    if (samples == 0) {
+        return sample;
+    }
+    return (1.0 - CIRCUIT_BREAKER_EWMA_WEIGHT) * current +
+           CIRCUIT_BREAKER_EWMA_WEIGHT * sample;
+}
+
+/* AIMD: about one more call in flight per round trip while upstream keeps
+ * up, half as many when it fails or queues requests. A call much slower
+ * than the long-term average is the early sign, before anything times out;
+ * latency that stays up becomes the new average and the limit grows
+ * again. */
+static void adapt_limit(CircuitBreaker* breaker, uint64_t now, int success,
+                        double latency_ms) {
+    int congested = !success ||
+                    (breaker->baseline_ms > 0.0 &&
+                     latency_ms > breaker->baseline_ms *
+                                      CIRCUIT_BREAKER_LATENCY_TOLERANCE);
+
+    if (success && latency_ms > 0.0) {
+        breaker->baseline_ms = breaker->baseline_ms > 0.0
+                                   ? (1.0 - BASELINE_WEIGHT) *
+                                             breaker->baseline_ms +
+                                         BASELINE_WEIGHT * latency_ms
+                                   : latency_ms;
+    }
+
+    if (congested) {
+        if (now >= breaker->decrease_after) {
+            breaker->limit *= LIMIT_BACKOFF;
+            if (breaker->limit < CIRCUIT_BREAKER_MIN_LIMIT) {
+                breaker->limit = CIRCUIT_BREAKER_MIN_LIMIT;
+            }
+            breaker->decrease_after = now + (uint64_t)breaker->latency_ms;
+        }
+        return;
+    }
+
+    // Only a limit that was used has shown it is not too low
+    if ((breaker->in_flight + 1) * 2 >= (uint32_t)breaker->limit) {
+        breaker->limit += 1.0 / breaker->limit;
+        if (breaker->limit > breaker->limit_max) {
+            breaker->limit = breaker->limit_max;
+        }
+    }
+}
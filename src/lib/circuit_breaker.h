@@ -0,0 +1,101 @@
+/// Circuit breaker with an adaptive concurrency limit, for calls to one
+/// upstream. Moving averages of the error rate and latency open the circuit
+/// when upstream fails or slows down; while open every call is refused at
+/// once, then a few probes decide whether it closes again. While closed, the
+/// number of calls in flight is capped by an AIMD limit that grows slowly
+/// while upstream keeps up and halves when calls fail or take well over the
+/// long-term average. Not thread-safe, times are monotonic ms.
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <stdint.h>
+
+// Weight of the newest outcome in the moving averages
+#ifndef CIRCUIT_BREAKER_EWMA_WEIGHT
+#    define CIRCUIT_BREAKER_EWMA_WEIGHT 0.2
+#endif
+
+// Outcomes seen after closing before the averages may open the circuit
+#ifndef CIRCUIT_BREAKER_MIN_SAMPLES
+#    define CIRCUIT_BREAKER_MIN_SAMPLES 5
+#endif
+
+// Successful probes in a row that close a half-open circuit
+#ifndef CIRCUIT_BREAKER_PROBES
+#    define CIRCUIT_BREAKER_PROBES 3
+#endif
+
+// Latency this many times the long-term average counts as congestion
+#ifndef CIRCUIT_BREAKER_LATENCY_TOLERANCE
+#    define CIRCUIT_BREAKER_LATENCY_TOLERANCE 2.0
+#endif
+
+// The limit never drops below this, the breaker handles outright failure
+#ifndef CIRCUIT_BREAKER_MIN_LIMIT
+#    define CIRCUIT_BREAKER_MIN_LIMIT 2
+#endif
+
+// Failed probes double the open time up to this many times the first
+#ifndef CIRCUIT_BREAKER_MAX_BACKOFF
+#    define CIRCUIT_BREAKER_MAX_BACKOFF 12
+#endif
+
+typedef enum {
+    CIRCUIT_CLOSED,    // Calls flow, limited by the concurrency limit
+    CIRCUIT_OPEN,      // Calls are refused until open_until
+    CIRCUIT_HALF_OPEN, // One probe at a time decides what comes next
+} CircuitState;
+
+typedef struct {
+    CircuitState state;
+
+    // Thresholds, see circuit_breaker_set_thresholds
+    double   error_threshold;
+    double   latency_threshold_ms;
+    uint64_t open_ms;
+
+    double   error_rate;  // Moving average of failures, 0 to 1
+    double   latency_ms;  // Moving average of call durations
+    double   baseline_ms; // Long-term average latency of successes
+    uint32_t samples;     // Outcomes since the circuit closed
+    uint32_t probes;      // Successful probes while half-open
+    uint64_t open_until;
+    uint64_t backoff_ms; // Open time after the next failure
+
+    double   limit; // Calls allowed in flight, fractional while growing
+    double   limit_max;
+    uint32_t in_flight;
+    uint64_t decrease_after; // One decrease per round trip
+
+    uint64_t opened;   // Times the circuit opened
+    uint64_t rejected; // Calls refused without reaching upstream
+} CircuitBreaker;
+
+/* Starts closed with limit calls allowed in flight, growing up to
+ * limit_max. Thresholds start at 50% errors, no latency trigger and 5
+ * seconds open. */
+void circuit_breaker_initiate(CircuitBreaker* breaker, unsigned limit,
+                              unsigned limit_max);
+
+/* Opens the circuit once the error rate reaches error_percent or the
+ * latency average reaches latency_ms, 0 disables that trigger. The circuit
+ * stays open open_ms, doubled after every failed probe. */
+void circuit_breaker_set_thresholds(CircuitBreaker* breaker, int error_percent,
+                                    int latency_ms, int open_ms);
+
+/* Returns 1 if a call may start now, counting it in flight, and 0 if it
+ * must fail without reaching upstream. Every admitted call is ended with
+ * circuit_breaker_release or circuit_breaker_cancel. */
+int circuit_breaker_acquire(CircuitBreaker* breaker, uint64_t now);
+
+/* Ends an admitted call with its outcome. Failures are what says upstream
+ * is unwell (timeouts, 5xx), not requests it refused. */
+void circuit_breaker_release(CircuitBreaker* breaker, uint64_t now,
+                             int success, double latency_ms);
+
+/* Ends an admitted call that never reached upstream */
+void circuit_breaker_cancel(CircuitBreaker* breaker);
+
+const char* circuit_breaker_state_name(CircuitState state);
+
+#endif // CIRCUIT_BREAKER_H
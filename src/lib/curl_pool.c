@@ -0,0 +1,163 @@
+#include "curl_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//-----------------Internal Functions-----------------
+
+static void share_lock(CURL* handle, curl_lock_data data,
+                       curl_lock_access access, void* context);
+static void share_unlock(CURL* handle, curl_lock_data data, void* context);
+static void setup_handle(CurlPool* pool, CURL* curl);
+
+//----------------------------------------------------
+
+int curl_pool_initiate(CurlPool* pool, size_t handles, const char* ca_file,
+                       int http2) {
+    memset(pool, 0, sizeof(CurlPool));
+    pool->capacity = handles ? handles : CURL_POOL_DEFAULT_HANDLES;
+    pool->http2    = http2;
+
+    pool->idle = calloc(pool->capacity, sizeof(CURL*));
+    if (pool->idle == NULL) {
+        return -2;
+    }
+    if (ca_file != NULL && (pool->ca_file = strdup(ca_file)) == NULL) {
+        free(pool->idle);
+        return -2;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    for (size_t i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&pool->locks[i], NULL);
+    }
+
+    pool->share = curl_share_init();
+    if (pool->share == NULL ||
+        curl_share_setopt(pool->share, CURLSHOPT_LOCKFUNC, share_lock) ||
+        curl_share_setopt(pool->share, CURLSHOPT_UNLOCKFUNC, share_unlock) ||
+        curl_share_setopt(pool->share, CURLSHOPT_USERDATA, pool) ||
+        curl_share_setopt(pool->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS) ||
+        curl_share_setopt(pool->share, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_SSL_SESSION) ||
+        curl_share_setopt(pool->share, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_CONNECT)) {
+        curl_pool_dispose(pool);
+        return -1;
+    }
+
+    return 0;
+}
+
+CURL* curl_pool_acquire(CurlPool* pool) {
+    CURL* curl = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->idle_count > 0) {
+        curl = pool->idle[--pool->idle_count];
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (curl == NULL) {
+        curl = curl_easy_init();
+        if (curl == NULL) {
+            return NULL;
+        }
+    }
+
+    setup_handle(pool, curl);
+    return curl;
+}
+
+void curl_pool_setup_multi(CurlPool* pool, CURLM* multi) {
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING,
+                      pool->http2 ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+}
+
+void curl_pool_release(CurlPool* pool, CURL* curl) {
+    if (curl == NULL) {
+        return;
+    }
+
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+
+    // Connections stay in the share's cache, the handle only loses options
+    curl_easy_reset(curl);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->requests++;
+    pool->connections += connects > 0 ? (uint64_t)connects : 0;
+    if (pool->idle_count < pool->capacity) {
+        pool->idle[pool->idle_count++] = curl;
+        curl = NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (curl != NULL) {
+        curl_easy_cleanup(curl);
+    }
+}
+
+void curl_pool_dispose(CurlPool* pool) {
+    for (size_t i = 0; i < pool->idle_count; i++) {
+        curl_easy_cleanup(pool->idle[i]);
+    }
+    pool->idle_count = 0;
+
+    // Closes the cached connections, every handle must be cleaned up first
+    if (pool->share != NULL) {
+        curl_share_cleanup(pool->share);
+        pool->share = NULL;
+    }
+
+    if (pool->idle != NULL) {
+        pthread_mutex_destroy(&pool->lock);
+        for (size_t i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_destroy(&pool->locks[i]);
+        }
+    }
+
+    free(pool->idle);
+    pool->idle = NULL;
+    free(pool->ca_file);
+    pool->ca_file = NULL;
+}
+
+/* ============= Internal Functions Implementation ============= */
+
+static void share_lock(CURL* handle, curl_lock_data data,
+                       curl_lock_access access, void* context) {
+    (void)handle;
+    (void)access;
+    CurlPool* pool = context;
+    pthread_mutex_lock(&pool->locks[data]);
+}
+
+static void share_unlock(CURL* handle, curl_lock_data data, void* context) {
+    (void)handle;
+    CurlPool* pool = context;
+    pthread_mutex_unlock(&pool->locks[data]);
+}
+
+static void setup_handle(CurlPool* pool, CURL* curl) {
+    curl_easy_setopt(curl, CURLOPT_SHARE, pool->share);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    // Keep idle connections alive through NATs and firewalls between misses
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, CURL_POOL_KEEPALIVE_IDLE);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, CURL_POOL_KEEPALIVE_IDLE);
+
+    if (pool->http2) {
+        // Wait for a connection that can multiplex rather than open another
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    }
+
+    if (pool->ca_file != NULL) {
+        curl_easy_setopt(curl, CURLOPT_CAINFO, pool->ca_file);
+    }
+}
@@ -0,0 +1,62 @@
+/// Long-lived curl easy handles for talking to one upstream. Every handle is
+/// attached to a single share object holding the DNS cache, TLS sessions and
+/// the connection cache, so a request finds the address resolved, the TLS
+/// session resumable and usually a kept-alive connection it can send on
+/// right away. Handles go back to the pool after use instead of being
+/// cleaned up.
+#ifndef CURL_POOL_H
+#define CURL_POOL_H
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Idle handles kept for reuse, more may be in use at once
+#ifndef CURL_POOL_DEFAULT_HANDLES
+#    define CURL_POOL_DEFAULT_HANDLES 8
+#endif
+
+// Seconds of TCP idle time before keep-alive probes start
+#ifndef CURL_POOL_KEEPALIVE_IDLE
+#    define CURL_POOL_KEEPALIVE_IDLE 60L
+#endif
+
+typedef struct {
+    CURLSH*         share;
+    pthread_mutex_t locks[CURL_LOCK_DATA_LAST]; // One per kind of shared data
+    pthread_mutex_t lock;                       // Guards idle
+    CURL**          idle;
+    size_t          idle_count;
+    size_t          capacity;
+
+    char* ca_file; // NULL uses the system's CA bundle
+    int   http2;
+
+    // Transfers finished and connections they had to open, the rest reused
+    uint64_t requests;
+    uint64_t connections;
+} CurlPool;
+
+/* handles 0 picks the default. ca_file is a PEM bundle to verify upstream
+ * with, NULL for the system's. http2 negotiates HTTP/2 over TLS, so requests
+ * running at once share one connection. Returns 0 on success, -1 if curl
+ * refused the share and -2 on allocation failure. */
+int curl_pool_initiate(CurlPool* pool, size_t handles, const char* ca_file,
+                       int http2);
+
+/* Returns a handle set up for the pool, with every per-request option at
+ * curl's default. NULL on failure. */
+CURL* curl_pool_acquire(CurlPool* pool);
+
+/* Sets up a multi handle to drive pooled handles, multiplexing them over
+ * HTTP/2 when the pool negotiates it */
+void curl_pool_setup_multi(CurlPool* pool, CURLM* multi);
+
+/* Gives a handle from curl_pool_acquire back after its transfer, it must no
+ * longer be added to a multi handle */
+void curl_pool_release(CurlPool* pool, CURL* curl);
+
+void curl_pool_dispose(CurlPool* pool);
+
+#endif // CURL_POOL_H
@@ -0,0 +1,417 @@
+#include "file_io.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef FILE_IO_NO_IO_URING
+#    include <linux/io_uring.h>
+#    include <sys/syscall.h>
+#endif
+
+struct FileIoRequest {
+    FileIoRequest* next;
+    FileIoCallback callback;
+    void*          context;
+    int            fd;
+    struct iovec   iov; // Read by the kernel until the read completes
+    off_t          offset;
+    ssize_t        result;
+};
+
+//-----------------Internal Functions-----------------
+
+static void  file_io_task_work(void* context, uint64_t mon_time);
+static void  file_io_complete(FileIo* io, FileIoRequest* request);
+static int   ring_setup(FileIoRing* ring, unsigned entries);
+static int   ring_submit(FileIoRing* ring, FileIoRequest* request);
+static void  ring_reap(FileIo* io);
+static void  ring_wait(FileIoRing* ring);
+static void  ring_close(FileIoRing* ring);
+static int   pool_start(FileIoPool* pool, size_t threads);
+static void  pool_submit(FileIoPool* pool, FileIoRequest* request);
+static void  pool_reap(FileIo* io);
+static void  pool_stop(FileIo* io);
+static void* pool_worker(void* context);
+
+//----------------------------------------------------
+
+int file_io_initiate(FileIo* io, size_t depth, size_t threads) {
+    memset(io, 0, sizeof(FileIo));
+    io->ring.fd = -1;
+    io->depth   = depth ? depth : FILE_IO_DEFAULT_DEPTH;
+
+    if (ring_setup(&io->ring, (unsigned)io->depth) == 0) {
+        io->backend = FILE_IO_BACKEND_IO_URING;
+    } else if (pool_start(&io->pool, threads ? threads
+                                             : FILE_IO_DEFAULT_THREADS) == 0) {
+        io->backend = FILE_IO_BACKEND_THREADS;
+    } else {
+        return -1;
+    }
+
+    io->task = smw_create_task(io, file_io_task_work);
+    if (io->task == NULL) {
+        file_io_dispose(io);
+        return -1;
+    }
+    return 0;
+}
+
+int file_io_read(FileIo* io, int fd, void* buffer, size_t len, off_t offset,
+                 FileIoCallback callback, void* context) {
+    if (io->backend == FILE_IO_BACKEND_NONE) {
+        return -2;
+    }
+    if (io->in_flight >= io->depth) {
+        return -1;
+    }
+
+    FileIoRequest* request = calloc(1, sizeof(FileIoRequest));
+    if (request == NULL) {
+        return -2;
+    }
+    request->callback     = callback;
+    request->context      = context;
+    request->fd           = fd;
+    request->iov.iov_base = buffer;
+    request->iov.iov_len  = len;
+    request->offset       = offset;
+
+    if (io->backend == FILE_IO_BACKEND_IO_URING) {
+        if (ring_submit(&io->ring, request) != 0) {
+            free(request);
+            return -2;
+        }
+    } else {
+        pool_submit(&io->pool, request);
+    }
+
+    io->in_flight++;
+    return 0;
+}
+
+const char* file_io_backend_name(const FileIo* io) {
+    switch (io->backend) {
+    case FILE_IO_BACKEND_IO_URING:
+        return "io_uring";
+    case FILE_IO_BACKEND_THREADS:
+        return "threads";
+    default:
+        return "none";
+    }
+}
+
+void file_io_dispose(FileIo* io) {
+    if (io->backend == FILE_IO_BACKEND_IO_URING) {
+        while (io->in_flight > 0) {
+            ring_wait(&io->ring);
+            ring_reap(io);
+        }
+        ring_close(&io->ring);
+    } else if (io->backend == FILE_IO_BACKEND_THREADS) {
+        pool_stop(io);
+    }
+    io->backend = FILE_IO_BACKEND_NONE;
+
+    if (io->task) {
+        smw_destroy_task(io->task);
+        io->task = NULL;
+    }
+}
+
+/* ============= Internal Functions Implementation ============= */
+
+static void file_io_task_work(void* context, uint64_t mon_time) {
+    FileIo* io = (FileIo*)context;
+    if (io->in_flight == 0) {
+        return;
+    }
+
+    if (io->backend == FILE_IO_BACKEND_IO_URING) {
+        ring_reap(io);
+    } else if (io->backend == FILE_IO_BACKEND_THREADS) {
+        pool_reap(io);
+    }
+}
+
+static void file_io_complete(FileIo* io, FileIoRequest* request) {
+    io->in_flight--;
+    io->completed++;
+    request->callback(request->context, request->result);
+    free(request);
+}
+
+#ifndef FILE_IO_NO_IO_URING
+
+/**
+ * Creates the ring and maps its submission queue, completion queue and
+ * submission entries
+ */
+static int ring_setup(FileIoRing* ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        printf("[FILE_IO] io_uring unavailable (%s), using threads\n",
+               strerror(errno));
+        return -1;
+    }
+    ring->fd = fd;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        sq_size = cq_size = sq_size > cq_size ? sq_size : cq_size;
+    }
+
+    ring->ring_size = sq_size;
+    ring->ring = mmap(NULL, sq_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->ring == MAP_FAILED) {
+        ring->ring = NULL;
+        ring_close(ring);
+        return -1;
+    }
+
+    if (single) {
+        ring->cq_map = ring->ring;
+    } else {
+        ring->cq_size = cq_size;
+        ring->cq_map  = mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED) {
+            ring->cq_map = NULL;
+            ring_close(ring);
+            return -1;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes_map  = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes_map == MAP_FAILED) {
+        ring->sqes_map = NULL;
+        ring_close(ring);
+        return -1;
+    }
+
+    uint8_t* sq = ring->ring;
+    uint8_t* cq = ring->cq_map;
+    ring->sq_head  = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail  = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask  = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head  = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail  = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask  = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->sqes     = ring->sqes_map;
+    ring->cqes     = cq + params.cq_off.cqes;
+    ring->entries  = params.sq_entries;
+
+    printf("[FILE_IO] io_uring ready, %u entries\n", ring->entries);
+    return 0;
+}
+
+/**
+ * Queues one readv and tells the kernel about it. The loop thread is the
+ * only producer, so the tail needs no atomic increment, only ordering.
+ */
+static int ring_submit(FileIoRing* ring, FileIoRequest* request) {
+    unsigned tail  = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+
+    struct io_uring_sqe* sqe = &((struct io_uring_sqe*)ring->sqes)[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_READV;
+    sqe->fd        = request->fd;
+    sqe->addr      = (uint64_t)(uintptr_t)&request->iov;
+    sqe->len       = 1;
+    sqe->off       = (uint64_t)request->offset;
+    sqe->user_data = (uint64_t)(uintptr_t)request;
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    int submitted =
+        (int)syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+    if (submitted <= 0) {
+        // Nothing consumed it, without SQPOLL the kernel only reads on enter
+        __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+        return -1;
+    }
+    return 0;
+}
+
+static void ring_reap(FileIo* io) {
+    FileIoRing* ring = &io->ring;
+    unsigned    head = *ring->cq_head;
+    unsigned    tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        struct io_uring_cqe* cqe =
+            &((struct io_uring_cqe*)ring->cqes)[head & *ring->cq_mask];
+        FileIoRequest* request = (FileIoRequest*)(uintptr_t)cqe->user_data;
+        request->result        = cqe->res;
+        head++;
+
+        // Hand the slot back before the callback, it may submit again
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        file_io_complete(io, request);
+    }
+}
+
+static void ring_wait(FileIoRing* ring) {
+    syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL,
+            0);
+}
+
+static void ring_close(FileIoRing* ring) {
+    if (ring->sqes_map) {
+        munmap(ring->sqes_map, ring->sqes_size);
+    }
+    if (ring->cq_map && ring->cq_map != ring->ring) {
+        munmap(ring->cq_map, ring->cq_size);
+    }
+    if (ring->ring) {
+        munmap(ring->ring, ring->ring_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(FileIoRing));
+    ring->fd = -1;
+}
+
+#else
+
+static int ring_setup(FileIoRing* ring, unsigned entries) {
+    (void)ring;
+    (void)entries;
+    return -1;
+}
+
+static int ring_submit(FileIoRing* ring, FileIoRequest* request) {
+    (void)ring;
+    (void)request;
+    return -1;
+}
+
+static void ring_reap(FileIo* io) { (void)io; }
+
+static void ring_wait(FileIoRing* ring) { (void)ring; }
+
+static void ring_close(FileIoRing* ring) { (void)ring; }
+
+#endif // FILE_IO_NO_IO_URING
+
+static int pool_start(FileIoPool* pool, size_t threads) {
+    if (threads > FILE_IO_MAX_THREADS) {
+        threads = FILE_IO_MAX_THREADS;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for (size_t i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[pool->thread_count], NULL,
+                           pool_worker, pool) == 0) {
+            pool->thread_count++;
+        }
+    }
+    if (pool->thread_count == 0) {
+        pthread_cond_destroy(&pool->wake);
+        pthread_mutex_destroy(&pool->lock);
+        return -1;
+    }
+
+    printf("[FILE_IO] Thread pool ready, %zu threads\n", pool->thread_count);
+    return 0;
+}
+
+static void pool_submit(FileIoPool* pool, FileIoRequest* request) {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->queued_tail) {
+        pool->queued_tail->next = request;
+    } else {
+        pool->queued = request;
+    }
+    pool->queued_tail = request;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void pool_reap(FileIo* io) {
+    FileIoPool* pool = &io->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    FileIoRequest* done = pool->done;
+    pool->done          = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    while (done) {
+        FileIoRequest* next = done->next;
+        file_io_complete(io, done);
+        done = next;
+    }
+}
+
+/**
+ * Workers finish the queue before they exit, their results are delivered
+ * before the lock goes away
+ */
+static void pool_stop(FileIo* io) {
+    FileIoPool* pool = &io->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pool->thread_count = 0;
+    pool_reap(io);
+
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+static void* pool_worker(void* context) {
+    FileIoPool* pool = (FileIoPool*)context;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->queued == NULL && !pool->stop) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->queued == NULL) {
+            break;
+        }
+
+        FileIoRequest* request = pool->queued;
+        pool->queued           = request->next;
+        if (pool->queued == NULL) {
+            pool->queued_tail = NULL;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        ssize_t result = pread(request->fd, request->iov.iov_base,
+                               request->iov.iov_len, request->offset);
+        request->result = result < 0 ? -errno : result;
+
+        pthread_mutex_lock(&pool->lock);
+        request->next = pool->done;
+        pool->done    = request;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
@@ -0,0 +1,102 @@
+/// Asynchronous file reads for the event loop. Reads go through io_uring,
+/// driven with raw syscalls so no liburing is needed, and through a small
+/// thread pool calling pread where the kernel has no io_uring or refuses it.
+/// Either way completions are collected by an smw task and every callback
+/// runs on the loop thread, never on a worker.
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include "smw.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// Reads in flight at once, a power of two
+#ifndef FILE_IO_DEFAULT_DEPTH
+#    define FILE_IO_DEFAULT_DEPTH 64
+#endif
+
+#ifndef FILE_IO_DEFAULT_THREADS
+#    define FILE_IO_DEFAULT_THREADS 2
+#endif
+
+#ifndef FILE_IO_MAX_THREADS
+#    define FILE_IO_MAX_THREADS 16
+#endif
+
+/* result is the byte count read or a negative errno */
+typedef void (*FileIoCallback)(void* context, ssize_t result);
+
+typedef enum {
+    FILE_IO_BACKEND_NONE,
+    FILE_IO_BACKEND_IO_URING,
+    FILE_IO_BACKEND_THREADS,
+} FileIoBackend;
+
+typedef struct FileIoRequest FileIoRequest;
+
+typedef struct {
+    int      fd;
+    void*    ring;
+    size_t   ring_size;
+    void*    sqes_map;
+    size_t   sqes_size;
+    void*    cq_map; // Same as ring when the kernel maps both rings at once
+    size_t   cq_size;
+    unsigned entries;
+
+    // Pointers into the shared rings
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    void*     sqes;
+    void*     cqes;
+} FileIoRing;
+
+typedef struct {
+    pthread_t       threads[FILE_IO_MAX_THREADS];
+    size_t          thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+    FileIoRequest*  queued; // Waiting for a worker, oldest first
+    FileIoRequest*  queued_tail;
+    FileIoRequest*  done; // Finished, waiting for the loop
+    int             stop;
+} FileIoPool;
+
+typedef struct {
+    FileIoBackend backend;
+    SmwTask*      task;
+    size_t        depth;
+    size_t        in_flight;
+
+    FileIoRing ring;
+    FileIoPool pool;
+
+    uint64_t completed;
+} FileIo;
+
+/* Sets up io_uring, or the thread pool if that fails. depth 0 and threads 0
+ * pick the defaults. Returns 0 on success, -1 if neither backend started. */
+int file_io_initiate(FileIo* io, size_t depth, size_t threads);
+
+/* Starts reading len bytes at offset of fd into buffer. fd and buffer must
+ * stay valid until callback has been called. Returns 0 if the read was
+ * started, -1 if too many are in flight and -2 on other errors, callback is
+ * then never called. */
+int file_io_read(FileIo* io, int fd, void* buffer, size_t len, off_t offset,
+                 FileIoCallback callback, void* context);
+
+/* "io_uring", "threads" or "none" */
+const char* file_io_backend_name(const FileIo* io);
+
+/* Waits for reads in flight and calls their callbacks, then shuts down */
+void file_io_dispose(FileIo* io);
+
+#endif // FILE_IO_H
@@ -35,6 +35,15 @@ int http_client_init(const char* _URL, http_client** _ClientPtr,
 
     strcpy(_Client->url, _URL);
 
+    _Client->write_buffer     = NULL;
+    _Client->read_buffer      = NULL;
+    _Client->read_buffer_size = 0;
+    _Client->body_start       = 0;
+    _Client->content_len      = 0;
+    _Client->has_content_len  = 0;
+    _Client->status_code      = 0;
+    _Client->body             = NULL;
+
     _Client->tcp_conn    = NULL;
     _Client->hostname[0] = '\0';
     _Client->path[0]     = '\0';
@@ -230,6 +239,32 @@ http_client_state http_client_work_writing(http_client* _Client) {
     return http_client_state_writing;
 }
 
+/* Hands the body, content_len bytes after the headers, to the callback */
+static http_client_state http_client_finish(http_client* client) {
+    printf("DEBUG: Complete response received!\n");
+
+    // Extract response body
+    if (client->content_len > 0) {
+        client->body = malloc(client->content_len + 1);
+        if (client->body) {
+            memcpy(client->body, client->read_buffer + client->body_start,
+                   client->content_len);
+            client->body[client->content_len] = '\0';
+            printf("DEBUG: Body extracted: %s\n", (char*)client->body);
+        }
+    }
+
+    // Call client callback
+    if (client->callback) {
+        char response_info[256];
+        snprintf(response_info, sizeof(response_info), "Status: %d, Body: %s",
+                 client->status_code, client->body ? (char*)client->body : "");
+        client->callback("RESPONSE", response_info);
+    }
+
+    return http_client_state_done;
+}
+
 http_client_state http_client_work_reading(http_client* client) {
     if (!client) {
         return http_client_state_dispose;
@@ -244,7 +279,18 @@ http_client_state http_client_work_reading(http_client* client) {
 
     printf("DEBUG: tcp_client_read returned: %d\n", bytes_read);
 
-    if (bytes_read < 0) {
+    if (bytes_read == TCP_CLIENT_CLOSED) {
+        // Without Content-Length the body ends where the server closes
+        if (client->body_start > 0 && !client->has_content_len) {
+            client->content_len = client->read_buffer_size - client->body_start;
+            return http_client_finish(client);
+        }
+        printf("DEBUG: Connection closed before the response was complete\n");
+        if (client->callback) {
+            client->callback("ERROR", "Connection closed");
+        }
+        return http_client_state_dispose;
+    } else if (bytes_read < 0) {
         printf("DEBUG: Read error: %s\n", strerror(errno));
         if (client->callback) {
             client->callback("ERROR", "Read failed");
@@ -342,6 +388,7 @@ http_client_state http_client_work_reading(http_client* client) {
                     sscanf(content_len_ptr, "Content-Length: %zu",
                            &content_len);
                     printf("DEBUG: Found Content-Length: %zu\n", content_len);
+                    client->has_content_len = 1;
                 } else {
                     printf("DEBUG: No Content-Length header found\n");
                 }
@@ -371,33 +418,11 @@ http_client_state http_client_work_reading(http_client* client) {
                client->body_start, client->content_len,
                client->read_buffer_size);
 
-        if (client->read_buffer_size >=
-            client->body_start + client->content_len) {
-            printf("DEBUG: Complete response received!\n");
-
-            // Extract response body
-            if (client->content_len > 0) {
-                client->body = malloc(client->content_len + 1);
-                if (client->body) {
-                    memcpy(client->body,
-                           client->read_buffer + client->body_start,
-                           client->content_len);
-                    client->body[client->content_len] = '\0';
-                    printf("DEBUG: Body extracted: %s\n", (char*)client->body);
-                }
-            }
-
-            // Call client callback
-            if (client->callback) {
-                char response_info[256];
-                snprintf(response_info, sizeof(response_info),
-                         "Status: %d, Body: %s", client->status_code,
-                         client->body ? (char*)client->body : "");
-                client->callback("RESPONSE", response_info);
-            }
-
-            return http_client_state_done;
-        } else {
+        if (client->has_content_len &&
+            client->read_buffer_size >=
+                client->body_start + client->content_len) {
+            return http_client_finish(client);
+        } else if (client->has_content_len) {
             printf("DEBUG: Incomplete body - need %zu more bytes\n",
                    (client->body_start + client->content_len) -
                        client->read_buffer_size);
@@ -39,6 +39,7 @@ typedef struct {
     size_t   read_buffer_size; // Current size of read buffer
     size_t   body_start;       // Position where HTTP body starts
     size_t   content_len;      // Content-Length from headers
+    int      has_content_len;  // Else the body runs until the server closes
     int      status_code;      // HTTP status code (200, 404, etc.)
     uint8_t* body;             // Extracted response body
 
@@ -0,0 +1,194 @@
+#include "http_encoding.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+
+#ifdef HAVE_BROTLI
+#    include <brotli/encode.h>
+#endif
+
+static const char* const HTTP_ENCODING_NAMES[HTTP_ENCODING_COUNT] = {
+    "identity", "gzip", "br"};
+
+//-----------------Internal Functions-----------------
+
+static int compress_gzip(int level, const void* data, size_t len,
+                         uint8_t** out, size_t* out_len);
+#ifdef HAVE_BROTLI
+static int compress_brotli(int level, const void* data, size_t len,
+                           uint8_t** out, size_t* out_len);
+#endif
+
+//----------------------------------------------------
+
+const char* http_encoding_name(HttpEncoding encoding) {
+    if (encoding >= HTTP_ENCODING_COUNT) {
+        return HTTP_ENCODING_NAMES[HTTP_ENCODING_IDENTITY];
+    }
+    return HTTP_ENCODING_NAMES[encoding];
+}
+
+int http_encoding_supported(HttpEncoding encoding) {
+    switch (encoding) {
+    case HTTP_ENCODING_IDENTITY:
+    case HTTP_ENCODING_GZIP:
+        return 1;
+    case HTTP_ENCODING_BR:
+#ifdef HAVE_BROTLI
+        return 1;
+#else
+        return 0;
+#endif
+    default:
+        return 0;
+    }
+}
+
+unsigned http_encoding_parse_accept(const char* value, size_t len) {
+    unsigned    accepted = HTTP_ENCODING_BIT(HTTP_ENCODING_IDENTITY);
+    const char* end      = value ? value + len : NULL;
+    const char* cur      = value;
+
+    while (cur != NULL && cur < end) {
+        const char* token_end = memchr(cur, ',', end - cur);
+        if (token_end == NULL) {
+            token_end = end;
+        }
+
+        // "gzip;q=0.8" -> name "gzip", q 0.8
+        while (cur < token_end && isspace((unsigned char)*cur)) {
+            cur++;
+        }
+        const char* name_end = cur;
+        while (name_end < token_end && *name_end != ';' &&
+               !isspace((unsigned char)*name_end)) {
+            name_end++;
+        }
+
+        int         rejected = 0;
+        const char* q        = name_end;
+        while (q + 2 < token_end && !(q[0] == 'q' && q[1] == '=')) {
+            q++;
+        }
+        if (q + 2 < token_end && q[0] == 'q' && q[1] == '=') {
+            rejected = strtod(q + 2, NULL) <= 0.0;
+        }
+
+        size_t name_len = name_end - cur;
+        for (int i = HTTP_ENCODING_GZIP; i < HTTP_ENCODING_COUNT; i++) {
+            const char* name = HTTP_ENCODING_NAMES[i];
+            int         match =
+                (name_len == strlen(name) &&
+                 strncasecmp(cur, name, name_len) == 0) ||
+                (name_len == 1 && *cur == '*');
+            if (match && !rejected) {
+                accepted |= HTTP_ENCODING_BIT(i);
+            }
+        }
+
+        cur = token_end + 1;
+    }
+
+    return accepted;
+}
+
+HttpEncoding http_encoding_choose(unsigned accepted, unsigned available) {
+    unsigned usable = accepted & available;
+
+    if (usable & HTTP_ENCODING_BIT(HTTP_ENCODING_BR)) {
+        return HTTP_ENCODING_BR;
+    }
+    if (usable & HTTP_ENCODING_BIT(HTTP_ENCODING_GZIP)) {
+        return HTTP_ENCODING_GZIP;
+    }
+    return HTTP_ENCODING_IDENTITY;
+}
+
+int http_encoding_compress(HttpEncoding encoding, int level, const void* data,
+                           size_t len, uint8_t** out, size_t* out_len) {
+    if (!data || !out || !out_len) {
+        return -1;
+    }
+
+    if (level < 1) {
+        level = 1;
+    } else if (level > 9) {
+        level = 9;
+    }
+
+    switch (encoding) {
+    case HTTP_ENCODING_GZIP:
+        return compress_gzip(level, data, len, out, out_len);
+#ifdef HAVE_BROTLI
+    case HTTP_ENCODING_BR:
+        return compress_brotli(level, data, len, out, out_len);
+#endif
+    default:
+        return -1;
+    }
+}
+
+/* ============= Internal Functions Implementation ============= */
+
+static int compress_gzip(int level, const void* data, size_t len,
+                         uint8_t** out, size_t* out_len) {
+    z_stream stream = {0};
+
+    // 15 window bits + 16 selects the gzip wrapper instead of zlib's
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return -1;
+    }
+
+    size_t   bound  = deflateBound(&stream, len);
+    uint8_t* buffer = malloc(bound);
+    if (!buffer) {
+        deflateEnd(&stream);
+        return -2;
+    }
+
+    stream.next_in   = (Bytef*)data;
+    stream.avail_in  = (uInt)len;
+    stream.next_out  = buffer;
+    stream.avail_out = (uInt)bound;
+
+    int result = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END) {
+        free(buffer);
+        return -3;
+    }
+
+    *out     = buffer;
+    *out_len = stream.total_out;
+    return 0;
+}
+
+#ifdef HAVE_BROTLI
+static int compress_brotli(int level, const void* data, size_t len,
+                           uint8_t** out, size_t* out_len) {
+    size_t   bound  = BrotliEncoderMaxCompressedSize(len);
+    uint8_t* buffer = malloc(bound ? bound : len + 64);
+    if (!buffer) {
+        return -2;
+    }
+
+    // Brotli quality runs 0-11
+    int    quality = (level * BROTLI_MAX_QUALITY + 8) / 9;
+    size_t written = bound ? bound : len + 64;
+    if (!BrotliEncoderCompress(quality, BROTLI_DEFAULT_WINDOW,
+                               BROTLI_MODE_TEXT, len, (const uint8_t*)data,
+                               &written, buffer)) {
+        free(buffer);
+        return -3;
+    }
+
+    *out     = buffer;
+    *out_len = written;
+    return 0;
+}
+#endif
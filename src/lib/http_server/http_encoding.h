@@ -0,0 +1,41 @@
+/// Content-Encoding negotiation and body compression. gzip uses zlib and is
+/// always available, brotli is compiled in with HAVE_BROTLI (make
+/// WITH_BROTLI=1).
+#ifndef HTTP_ENCODING_H
+#define HTTP_ENCODING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    HTTP_ENCODING_IDENTITY,
+    HTTP_ENCODING_GZIP,
+    HTTP_ENCODING_BR,
+    HTTP_ENCODING_COUNT,
+} HttpEncoding;
+
+#define HTTP_ENCODING_BIT(encoding) (1u << (encoding))
+
+// Compression level used when the caller has no preference
+#define HTTP_ENCODING_DEFAULT_LEVEL 6
+
+/* Returns the Content-Encoding token, e.g. "gzip" */
+const char* http_encoding_name(HttpEncoding encoding);
+
+/* Returns non-zero if this build can produce the encoding */
+int http_encoding_supported(HttpEncoding encoding);
+
+/* Parses an Accept-Encoding value into a mask of HTTP_ENCODING_BIT()s.
+ * Identity is always included, codings with q=0 are left out. */
+unsigned http_encoding_parse_accept(const char* value, size_t len);
+
+/* Picks the encoding to respond with among the ones in available, preferring
+ * brotli, then gzip, then identity */
+HttpEncoding http_encoding_choose(unsigned accepted, unsigned available);
+
+/* Compresses data into a new malloc'd buffer. level is 1-9 and mapped onto
+ * the encoder's own range. Returns 0 on success. */
+int http_encoding_compress(HttpEncoding encoding, int level, const void* data,
+                           size_t len, uint8_t** out, size_t* out_len);
+
+#endif // HTTP_ENCODING_H
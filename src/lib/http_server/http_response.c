@@ -0,0 +1,537 @@
+#include "http_response.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int         status;
+    const char* line; // Full status line including "\r\n"
+    size_t      line_len;
+    const char* reason;
+} HttpStatusLine;
+
+#define HTTP_STATUS_LINE(code, text)                                           \
+    {code, "HTTP/1.1 " #code " " text "\r\n",                                  \
+     sizeof("HTTP/1.1 " #code " " text "\r\n") - 1, text}
+
+static const HttpStatusLine HTTP_STATUS_LINES[] = {
+    HTTP_STATUS_LINE(200, "OK"),
+    HTTP_STATUS_LINE(204, "No Content"),
+    HTTP_STATUS_LINE(304, "Not Modified"),
+    HTTP_STATUS_LINE(400, "Bad Request"),
+    HTTP_STATUS_LINE(404, "Not Found"),
+    HTTP_STATUS_LINE(405, "Method Not Allowed"),
+    HTTP_STATUS_LINE(429, "Too Many Requests"),
+    HTTP_STATUS_LINE(500, "Internal Server Error"),
+    HTTP_STATUS_LINE(502, "Bad Gateway"),
+    HTTP_STATUS_LINE(503, "Service Unavailable"),
+    HTTP_STATUS_LINE(504, "Gateway Timeout"),
+};
+
+static const char DIGIT_PAIRS[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+static const char DAY_NAMES[7][4] = {"Sun", "Mon", "Tue", "Wed",
+                                      "Thu", "Fri", "Sat"};
+static const char MONTH_NAMES[12][4] = {"Jan", "Feb", "Mar", "Apr",
+                                        "May", "Jun", "Jul", "Aug",
+                                        "Sep", "Oct", "Nov", "Dec"};
+
+//-----------------Internal Functions-----------------
+
+static const HttpStatusLine* http_status_line(int status);
+static uint8_t* http_static_serialize(int status, const char* headers,
+                                      HttpEncoding encoding, int vary,
+                                      const void* body, size_t body_len,
+                                      size_t* out_len, size_t* header_len);
+
+//----------------------------------------------------
+
+size_t http_format_uint(char* out, uint64_t value) {
+    char  buffer[HTTP_UINT_MAX_DIGITS];
+    char* end = buffer + sizeof(buffer);
+    char* cur = end;
+
+    // Two digits per division, written backwards
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100) * 2;
+        *--cur        = DIGIT_PAIRS[pair + 1];
+        *--cur        = DIGIT_PAIRS[pair];
+        value /= 100;
+    }
+    if (value >= 10) {
+        unsigned pair = (unsigned)value * 2;
+        *--cur        = DIGIT_PAIRS[pair + 1];
+        *--cur        = DIGIT_PAIRS[pair];
+    } else {
+        *--cur = (char)('0' + value);
+    }
+
+    size_t len = end - cur;
+    memcpy(out, cur, len);
+    return len;
+}
+
+const char* http_status_reason(int status) {
+    const HttpStatusLine* line = http_status_line(status);
+    return line ? line->reason : "Unknown";
+}
+
+void http_format_date(char* out, time_t time) {
+    struct tm tm;
+    gmtime_r(&time, &tm);
+
+    // strftime would follow the locale, the HTTP date format never does
+    memcpy(out, DAY_NAMES[tm.tm_wday], 3);
+    out[3] = ',';
+    out[4] = ' ';
+    memcpy(out + 5, DIGIT_PAIRS + tm.tm_mday * 2, 2);
+    out[7] = ' ';
+    memcpy(out + 8, MONTH_NAMES[tm.tm_mon], 3);
+    out[11] = ' ';
+    int year = tm.tm_year + 1900;
+    memcpy(out + 12, DIGIT_PAIRS + (year / 100 % 100) * 2, 2);
+    memcpy(out + 14, DIGIT_PAIRS + (year % 100) * 2, 2);
+    out[16] = ' ';
+    memcpy(out + 17, DIGIT_PAIRS + tm.tm_hour * 2, 2);
+    out[19] = ':';
+    memcpy(out + 20, DIGIT_PAIRS + tm.tm_min * 2, 2);
+    out[22] = ':';
+    memcpy(out + 23, DIGIT_PAIRS + tm.tm_sec * 2, 2);
+    memcpy(out + 25, " GMT", 5);
+}
+
+int http_parse_date(const char* value, size_t len, time_t* time) {
+    if (value == NULL || len != HTTP_DATE_LENGTH) {
+        return -1;
+    }
+
+    char buffer[HTTP_DATE_LENGTH + 1];
+    memcpy(buffer, value, len);
+    buffer[len] = '\0';
+
+    char      month[4];
+    struct tm tm = {0};
+    if (sscanf(buffer, "%*3s, %2d %3s %4d %2d:%2d:%2d GMT", &tm.tm_mday,
+               month, &tm.tm_year, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+        return -1;
+    }
+
+    tm.tm_mon = -1;
+    for (int i = 0; i < 12; i++) {
+        if (strcmp(month, MONTH_NAMES[i]) == 0) {
+            tm.tm_mon = i;
+            break;
+        }
+    }
+    if (tm.tm_mon < 0) {
+        return -1;
+    }
+    tm.tm_year -= 1900;
+
+    *time = timegm(&tm);
+    return 0;
+}
+
+int http_etag_list_match(const char* list, size_t len, const char* etag) {
+    if (list == NULL || etag == NULL) {
+        return 0;
+    }
+
+    const char* end      = list + len;
+    const char* cur      = list;
+    size_t      etag_len = strlen(etag);
+
+    while (cur < end) {
+        while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == ',')) {
+            cur++;
+        }
+        if (cur == end) {
+            break;
+        }
+
+        if (*cur == '*') {
+            return 1;
+        }
+        if (end - cur >= 2 && cur[0] == 'W' && cur[1] == '/') {
+            cur += 2;
+        }
+
+        const char* tag_end = memchr(cur, ',', end - cur);
+        if (tag_end == NULL) {
+            tag_end = end;
+        }
+        const char* trimmed = tag_end;
+        while (trimmed > cur && (trimmed[-1] == ' ' || trimmed[-1] == '\t')) {
+            trimmed--;
+        }
+
+        if ((size_t)(trimmed - cur) == etag_len &&
+            memcmp(cur, etag, etag_len) == 0) {
+            return 1;
+        }
+
+        cur = tag_end;
+    }
+
+    return 0;
+}
+
+void http_response_init(HttpResponse* response) {
+    response->status     = 0;
+    response->header_len = 0;
+    response->overflow   = 0;
+    response->iov_count  = 1;
+    response->body_len   = 0;
+    response->iov_index  = 0;
+    response->finished   = 0;
+
+    response->iov[0].iov_base = response->header;
+    response->iov[0].iov_len  = 0;
+}
+
+int http_response_begin(HttpResponse* response, int status) {
+    response->status     = status;
+    response->header_len = 0;
+
+    const HttpStatusLine* line = http_status_line(status);
+    if (line) {
+        return http_response_add_raw(response, line->line, line->line_len);
+    }
+
+    char   buffer[64];
+    size_t len = sizeof("HTTP/1.1 ") - 1;
+    memcpy(buffer, "HTTP/1.1 ", len);
+    len += http_format_uint(buffer + len, status < 0 ? 0 : (uint64_t)status);
+    memcpy(buffer + len, " Unknown\r\n", sizeof(" Unknown\r\n") - 1);
+    len += sizeof(" Unknown\r\n") - 1;
+
+    return http_response_add_raw(response, buffer, len);
+}
+
+int http_response_add_raw(HttpResponse* response, const char* data,
+                          size_t len) {
+    if (response->header_len + len > sizeof(response->header)) {
+        response->overflow = 1;
+        return -1;
+    }
+
+    memcpy(response->header + response->header_len, data, len);
+    response->header_len += len;
+    return 0;
+}
+
+int http_response_add_header(HttpResponse* response, const char* name,
+                             const char* value) {
+    size_t name_len  = strlen(name);
+    size_t value_len = strlen(value);
+
+    if (response->header_len + name_len + value_len + 4 >
+        sizeof(response->header)) {
+        response->overflow = 1;
+        return -1;
+    }
+
+    char* cur = response->header + response->header_len;
+    memcpy(cur, name, name_len);
+    cur += name_len;
+    *cur++ = ':';
+    *cur++ = ' ';
+    memcpy(cur, value, value_len);
+    cur += value_len;
+    *cur++ = '\r';
+    *cur++ = '\n';
+
+    response->header_len = cur - response->header;
+    return 0;
+}
+
+int http_response_add_header_uint(HttpResponse* response, const char* name,
+                                  uint64_t value) {
+    size_t name_len = strlen(name);
+
+    if (response->header_len + name_len + HTTP_UINT_MAX_DIGITS + 4 >
+        sizeof(response->header)) {
+        response->overflow = 1;
+        return -1;
+    }
+
+    char* cur = response->header + response->header_len;
+    memcpy(cur, name, name_len);
+    cur += name_len;
+    *cur++ = ':';
+    *cur++ = ' ';
+    cur += http_format_uint(cur, value);
+    *cur++ = '\r';
+    *cur++ = '\n';
+
+    response->header_len = cur - response->header;
+    return 0;
+}
+
+int http_response_add_header_date(HttpResponse* response, const char* name,
+                                  time_t value) {
+    char date[HTTP_DATE_LENGTH + 1];
+    http_format_date(date, value);
+    return http_response_add_header(response, name, date);
+}
+
+int http_response_add_body(HttpResponse* response, const void* data,
+                           size_t len, HttpResponseRelease release,
+                           void* context) {
+    if (response->iov_count >= 1 + HTTP_RESPONSE_MAX_BODY_PARTS) {
+        if (release) {
+            release(context);
+        }
+        return -1;
+    }
+
+    size_t index = response->iov_count++;
+
+    response->iov[index].iov_base       = (void*)data;
+    response->iov[index].iov_len        = len;
+    response->owners[index - 1].release = release;
+    response->owners[index - 1].context = context;
+
+    response->body_len += len;
+
+    return 0;
+}
+
+int http_response_finish(HttpResponse* response) {
+    if (response->status != 204 && response->status != 304) {
+        http_response_add_header_uint(response, "Content-Length",
+                                      response->body_len);
+    }
+    http_response_add_literal(response, "\r\n");
+
+    if (response->overflow) {
+        return -1;
+    }
+
+    response->iov[0].iov_base = response->header;
+    response->iov[0].iov_len  = response->header_len;
+    response->iov_index       = 0;
+    response->finished        = 1;
+
+    return 0;
+}
+
+void http_response_omit_body(HttpResponse* response) {
+    if (!response->finished || response->iov_index != 0) {
+        return;
+    }
+
+    // A static response holds header and body in iov[0], cut it after the
+    // header. The release callbacks of the other parts still run on dispose.
+    response->iov[0].iov_len = response->header_len;
+    for (size_t i = 1; i < response->iov_count; i++) {
+        response->iov[i].iov_len = 0;
+    }
+}
+
+int http_response_send(HttpResponse* response, TCPClient* client) {
+    if (!response->finished) {
+        return -1;
+    }
+
+    // Skip empty parts so a finished response never issues an empty write
+    while (response->iov_index < response->iov_count &&
+           response->iov[response->iov_index].iov_len == 0) {
+        response->iov_index++;
+    }
+    if (response->iov_index >= response->iov_count) {
+        return 1;
+    }
+
+    struct iovec* pending = &response->iov[response->iov_index];
+    int           count   = (int)(response->iov_count - response->iov_index);
+
+    ssize_t sent = tcp_client_writev(client, pending, count);
+    if (sent < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    // Advance past what the kernel took, possibly ending inside a part
+    while (sent > 0 && response->iov_index < response->iov_count) {
+        struct iovec* part = &response->iov[response->iov_index];
+        if ((size_t)sent >= part->iov_len) {
+            sent -= part->iov_len;
+            part->iov_len = 0;
+            response->iov_index++;
+        } else {
+            part->iov_base = (uint8_t*)part->iov_base + sent;
+            part->iov_len -= sent;
+            sent = 0;
+        }
+    }
+
+    return response->iov_index >= response->iov_count ? 1 : 0;
+}
+
+void http_response_dispose(HttpResponse* response) {
+    for (size_t i = 1; i < response->iov_count; i++) {
+        HttpResponseOwner* owner = &response->owners[i - 1];
+        if (owner->release) {
+            owner->release(owner->context);
+        }
+    }
+
+    http_response_init(response);
+}
+
+int http_static_response_initiate(HttpStaticResponse* static_response,
+                                  int status, const char* headers,
+                                  const void* body, size_t body_len,
+                                  unsigned encodings, int level) {
+    memset(static_response, 0, sizeof(*static_response));
+
+    uint8_t* compressed[HTTP_ENCODING_COUNT]     = {0};
+    size_t   compressed_len[HTTP_ENCODING_COUNT] = {0};
+    unsigned available = HTTP_ENCODING_BIT(HTTP_ENCODING_IDENTITY);
+
+    for (int i = HTTP_ENCODING_IDENTITY + 1; i < HTTP_ENCODING_COUNT; i++) {
+        if (!(encodings & HTTP_ENCODING_BIT(i)) ||
+            !http_encoding_supported((HttpEncoding)i)) {
+            continue;
+        }
+
+        if (http_encoding_compress((HttpEncoding)i, level, body, body_len,
+                                   &compressed[i], &compressed_len[i]) != 0) {
+            continue;
+        }
+
+        // Small bodies can grow when compressed, those are not worth a variant
+        if (compressed_len[i] >= body_len) {
+            free(compressed[i]);
+            compressed[i] = NULL;
+            continue;
+        }
+        available |= HTTP_ENCODING_BIT(i);
+    }
+
+    // Caches must key on Accept-Encoding as soon as the bytes differ by it
+    int vary   = available != HTTP_ENCODING_BIT(HTTP_ENCODING_IDENTITY);
+    int result = 0;
+
+    for (int i = HTTP_ENCODING_IDENTITY; i < HTTP_ENCODING_COUNT; i++) {
+        if (!(available & HTTP_ENCODING_BIT(i))) {
+            continue;
+        }
+
+        const void* data = i == HTTP_ENCODING_IDENTITY ? body : compressed[i];
+        size_t len = i == HTTP_ENCODING_IDENTITY ? body_len : compressed_len[i];
+
+        static_response->data[i] =
+            http_static_serialize(status, headers, (HttpEncoding)i, vary, data,
+                                  len, &static_response->len[i],
+                                  &static_response->header_len[i]);
+        if (static_response->data[i] == NULL) {
+            result = -2;
+            break;
+        }
+    }
+
+    for (int i = 0; i < HTTP_ENCODING_COUNT; i++) {
+        free(compressed[i]);
+    }
+
+    if (result != 0) {
+        http_static_response_dispose(static_response);
+        return result;
+    }
+
+    static_response->available = available;
+    return 0;
+}
+
+int http_response_set_static(HttpResponse*             response,
+                             const HttpStaticResponse* static_response,
+                             unsigned                  accepted) {
+    HttpEncoding encoding =
+        http_encoding_choose(accepted, static_response->available);
+    if (static_response->data[encoding] == NULL) {
+        return -1;
+    }
+
+    http_response_dispose(response);
+
+    response->iov[0].iov_base = static_response->data[encoding];
+    response->iov[0].iov_len  = static_response->len[encoding];
+    response->header_len      = static_response->header_len[encoding];
+    response->iov_count       = 1;
+    response->iov_index       = 0;
+    response->finished        = 1;
+
+    return 0;
+}
+
+void http_static_response_dispose(HttpStaticResponse* static_response) {
+    for (int i = 0; i < HTTP_ENCODING_COUNT; i++) {
+        free(static_response->data[i]);
+        static_response->data[i]       = NULL;
+        static_response->len[i]        = 0;
+        static_response->header_len[i] = 0;
+    }
+    static_response->available = 0;
+}
+
+/* ============= Internal Functions Implementation ============= */
+
+static const HttpStatusLine* http_status_line(int status) {
+    for (size_t i = 0;
+         i < sizeof(HTTP_STATUS_LINES) / sizeof(HTTP_STATUS_LINES[0]); i++) {
+        if (HTTP_STATUS_LINES[i].status == status) {
+            return &HTTP_STATUS_LINES[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Formats the full response for one encoding into a single malloc'd buffer,
+ * reusing the regular builder for the header.
+ */
+static uint8_t* http_static_serialize(int status, const char* headers,
+                                      HttpEncoding encoding, int vary,
+                                      const void* body, size_t body_len,
+                                      size_t* out_len, size_t* header_len) {
+    HttpResponse response;
+    http_response_init(&response);
+
+    http_response_begin(&response, status);
+    http_response_add_raw(&response, headers, strlen(headers));
+    if (encoding != HTTP_ENCODING_IDENTITY) {
+        http_response_add_header(&response, "Content-Encoding",
+                                 http_encoding_name(encoding));
+    }
+    if (vary) {
+        http_response_add_literal(&response, HTTP_HEADER_VARY_ENCODING);
+    }
+    http_response_add_body(&response, body, body_len, NULL, NULL);
+    if (http_response_finish(&response) != 0) {
+        return NULL;
+    }
+
+    uint8_t* data = malloc(response.header_len + body_len);
+    if (data == NULL) {
+        return NULL;
+    }
+
+    memcpy(data, response.header, response.header_len);
+    memcpy(data + response.header_len, body, body_len);
+
+    *out_len    = response.header_len + body_len;
+    *header_len = response.header_len;
+    return data;
+}
@@ -0,0 +1,146 @@
+/// Response builder that keeps the header and body apart. The header is
+/// assembled from preformatted blocks plus a fast integer formatter, and the
+/// body parts are referenced, never copied, then sent together with one
+/// scatter-gather write. Each body part may carry a release callback that is
+/// called when the response is disposed.
+/// Responses whose bytes never change are serialized once into an
+/// HttpStaticResponse, with precompressed variants, and sent by reference.
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include "../tcp_client.h"
+#include "http_encoding.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <time.h>
+
+#ifndef HTTP_RESPONSE_HEADER_MAX
+#    define HTTP_RESPONSE_HEADER_MAX 1024
+#endif
+
+#ifndef HTTP_RESPONSE_MAX_BODY_PARTS
+#    define HTTP_RESPONSE_MAX_BODY_PARTS 8
+#endif
+
+// Preformatted header blocks, concatenate them to add several at once
+#define HTTP_HEADER_CORS "Access-Control-Allow-Origin: *\r\n"
+#define HTTP_CONTENT_TYPE_JSON "Content-Type: application/json\r\n"
+#define HTTP_CONTENT_TYPE_HTML "Content-Type: text/html; charset=utf-8\r\n"
+#define HTTP_CONTENT_TYPE_TEXT "Content-Type: text/plain\r\n"
+#define HTTP_HEADER_VARY_ENCODING "Vary: Accept-Encoding\r\n"
+
+// Length of the longest decimal uint64_t
+#define HTTP_UINT_MAX_DIGITS 20
+
+// Length of an IMF-fixdate, "Sun, 06 Nov 1994 08:49:37 GMT"
+#define HTTP_DATE_LENGTH 29
+
+typedef void (*HttpResponseRelease)(void* context);
+
+typedef struct {
+    HttpResponseRelease release;
+    void*               context;
+} HttpResponseOwner;
+
+typedef struct {
+    int    status;
+    char   header[HTTP_RESPONSE_HEADER_MAX];
+    size_t header_len;
+    int    overflow; // Set when a header did not fit, finish then fails
+
+    // iov[0] is the header, the rest are body parts
+    struct iovec      iov[1 + HTTP_RESPONSE_MAX_BODY_PARTS];
+    HttpResponseOwner owners[HTTP_RESPONSE_MAX_BODY_PARTS];
+    size_t            iov_count;
+    size_t            body_len;
+
+    size_t iov_index; // First iovec not fully sent yet
+    int    finished;
+} HttpResponse;
+
+typedef struct {
+    // Header and body serialized back to back, NULL if the variant is absent
+    uint8_t* data[HTTP_ENCODING_COUNT];
+    size_t   len[HTTP_ENCODING_COUNT];
+    size_t   header_len[HTTP_ENCODING_COUNT];
+    unsigned available; // HTTP_ENCODING_BIT() of every variant present
+} HttpStaticResponse;
+
+/* Writes value in decimal to out (no terminator), returns the digit count.
+ * out must hold HTTP_UINT_MAX_DIGITS bytes. */
+size_t http_format_uint(char* out, uint64_t value);
+
+/* Returns the reason phrase for a status code, "Unknown" if not known */
+const char* http_status_reason(int status);
+
+/* Writes time as an IMF-fixdate plus a terminator, out must hold
+ * HTTP_DATE_LENGTH + 1 bytes */
+void http_format_date(char* out, time_t time);
+
+/* Parses an IMF-fixdate, returns 0 on success */
+int http_parse_date(const char* value, size_t len, time_t* time);
+
+/* Returns 1 if the If-None-Match list contains etag or "*". Uses the weak
+ * comparison, so W/"x" matches "x". */
+int http_etag_list_match(const char* list, size_t len, const char* etag);
+
+void http_response_init(HttpResponse* response);
+
+/* Starts the header with the status line */
+int http_response_begin(HttpResponse* response, int status);
+
+/* Appends preformatted header lines, each ending in "\r\n" */
+int http_response_add_raw(HttpResponse* response, const char* data,
+                          size_t len);
+
+#define http_response_add_literal(response, literal)                           \
+    http_response_add_raw((response), (literal), sizeof(literal) - 1)
+
+int http_response_add_header(HttpResponse* response, const char* name,
+                             const char* value);
+int http_response_add_header_uint(HttpResponse* response, const char* name,
+                                  uint64_t value);
+int http_response_add_header_date(HttpResponse* response, const char* name,
+                                  time_t value);
+
+/* References len bytes of data as the next body part. release is called with
+ * context when the response is disposed, pass NULL for static data. */
+int http_response_add_body(HttpResponse* response, const void* data,
+                           size_t len, HttpResponseRelease release,
+                           void* context);
+
+/* Appends Content-Length and the blank line, the response is then ready to
+ * send. 204 and 304 responses get no Content-Length. Returns -1 if the header
+ * did not fit in HTTP_RESPONSE_HEADER_MAX. */
+int http_response_finish(HttpResponse* response);
+
+/* Sends only the header of a finished response, for HEAD requests. The body
+ * parts stay referenced and Content-Length still gives their size. */
+void http_response_omit_body(HttpResponse* response);
+
+/* Writes as much as the socket takes. Returns 1 when everything is sent, 0 if
+ * more remains and -1 on socket error. */
+int http_response_send(HttpResponse* response, TCPClient* client);
+
+/* Releases all body parts and resets the builder */
+void http_response_dispose(HttpResponse* response);
+
+/* Serializes a complete response once. headers are preformatted lines without
+ * Content-Length. A variant is built for every encoding in encodings this build
+ * supports, and kept only if it is smaller than the identity body. */
+int http_static_response_initiate(HttpStaticResponse* static_response,
+                                  int status, const char* headers,
+                                  const void* body, size_t body_len,
+                                  unsigned encodings, int level);
+
+/* Points the response at the best variant for the accepted encodings. Nothing
+ * is copied, the static response must outlive the send. */
+int http_response_set_static(HttpResponse*             response,
+                             const HttpStaticResponse* static_response,
+                             unsigned                  accepted);
+
+void http_static_response_dispose(HttpStaticResponse* static_response);
+
+#endif // HTTP_RESPONSE_H
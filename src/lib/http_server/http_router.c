@@ -0,0 +1,381 @@
+#include "http_router.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Seeds tried per table size before the table is doubled
+#define HTTP_ROUTER_SEED_ATTEMPTS 64
+#define HTTP_ROUTER_MAX_TABLE_SIZE 65536
+
+struct HttpRouterNode {
+    char*  segment; // Static segment matched by this node
+    size_t segment_len;
+
+    // Static children, gathered while building and then perfect-hashed
+    HttpRouterNode** children;
+    size_t           child_count;
+    HttpRouterNode** table;
+    uint32_t         table_mask;
+    uint32_t         seed;
+
+    HttpRouterNode* param_child;
+    char*           param_name;
+
+    const HttpRoute* routes[HTTP_METHOD_COUNT];
+    char             allow[HTTP_ROUTER_ALLOW_MAX_LEN];
+};
+
+static const char* const HTTP_METHOD_NAMES[HTTP_METHOD_COUNT] = {
+    "GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS"};
+
+//-----------------Internal Functions-----------------
+
+static uint32_t        segment_hash(uint32_t seed, const char* segment,
+                                    size_t len);
+static HttpRouterNode* node_create(const char* segment, size_t len);
+static void            node_free(HttpRouterNode* node);
+static HttpRouterNode* node_add_child(HttpRouterNode* node, const char* segment,
+                                      size_t len);
+static int             node_compile(HttpRouterNode* node);
+static const HttpRouterNode* node_match(const HttpRouterNode* node,
+                                        const char* path, const char* end,
+                                        HttpRouteMatch* match);
+
+//----------------------------------------------------
+
+HttpMethod http_method_parse(const char* method) {
+    if (method == NULL) {
+        return HTTP_METHOD_UNKNOWN;
+    }
+
+    for (int i = 0; i < HTTP_METHOD_COUNT; i++) {
+        if (strcmp(method, HTTP_METHOD_NAMES[i]) == 0) {
+            return (HttpMethod)i;
+        }
+    }
+
+    return HTTP_METHOD_UNKNOWN;
+}
+
+int http_router_initiate(HttpRouter* router, const HttpRoute* routes,
+                         size_t route_count) {
+    router->root = node_create("", 0);
+    if (router->root == NULL) {
+        return -2;
+    }
+
+    for (size_t i = 0; i < route_count; i++) {
+        const HttpRoute* route   = &routes[i];
+        HttpMethod       method  = http_method_parse(route->method);
+        const char*      pattern = route->pattern;
+
+        if (method == HTTP_METHOD_UNKNOWN || pattern == NULL ||
+            pattern[0] != '/') {
+            printf("[ROUTER] Invalid route %s %s\n", route->method, pattern);
+            http_router_dispose(router);
+            return -1;
+        }
+
+        HttpRouterNode* node = router->root;
+        const char*     cur  = strcmp(pattern, "/") == 0 ? NULL : pattern;
+
+        while (cur != NULL) {
+            const char* segment = cur + 1;
+            const char* next    = strchr(segment, '/');
+            size_t len = next ? (size_t)(next - segment) : strlen(segment);
+
+            if (len > 1 && segment[0] == ':') {
+                if (node->param_child == NULL) {
+                    node->param_child = node_create("", 0);
+                    node->param_name  = strndup(segment + 1, len - 1);
+                    if (!node->param_child || !node->param_name) {
+                        http_router_dispose(router);
+                        return -2;
+                    }
+                } else if (strlen(node->param_name) != len - 1 ||
+                           strncmp(node->param_name, segment + 1, len - 1) !=
+                               0) {
+                    printf("[ROUTER] Conflicting parameter in %s\n", pattern);
+                    http_router_dispose(router);
+                    return -1;
+                }
+                node = node->param_child;
+            } else {
+                node = node_add_child(node, segment, len);
+                if (node == NULL) {
+                    http_router_dispose(router);
+                    return -2;
+                }
+            }
+
+            cur = next;
+        }
+
+        if (node->routes[method] != NULL) {
+            printf("[ROUTER] Duplicate route %s %s\n", route->method, pattern);
+            http_router_dispose(router);
+            return -1;
+        }
+        node->routes[method] = route;
+    }
+
+    int result = node_compile(router->root);
+    if (result != 0) {
+        http_router_dispose(router);
+        return result;
+    }
+
+    return 0;
+}
+
+HttpRouterResult http_router_match(const HttpRouter* router,
+                                   const char* method, const char* path,
+                                   size_t path_len, HttpRouteMatch* match) {
+    match->route       = NULL;
+    match->allow       = NULL;
+    match->param_count = 0;
+
+    if (router->root == NULL || path_len == 0 || path[0] != '/') {
+        return HTTP_ROUTER_NOT_FOUND;
+    }
+
+    const char*           end  = path + path_len;
+    const HttpRouterNode* node = router->root;
+    if (path_len > 1) {
+        node = node_match(router->root, path, end, match);
+    }
+    if (node == NULL || node->allow[0] == '\0') {
+        match->param_count = 0;
+        return HTTP_ROUTER_NOT_FOUND;
+    }
+
+    // HEAD without a route of its own is served by GET, the connection then
+    // sends the header only
+    HttpMethod index = http_method_parse(method);
+    if (index == HTTP_METHOD_HEAD && node->routes[index] == NULL) {
+        index = HTTP_METHOD_GET;
+    }
+    if (index == HTTP_METHOD_UNKNOWN || node->routes[index] == NULL) {
+        match->allow = node->allow;
+        return HTTP_ROUTER_METHOD_NOT_ALLOWED;
+    }
+
+    match->route = node->routes[index];
+    return HTTP_ROUTER_MATCH;
+}
+
+const HttpRouteParam* http_route_match_param(const HttpRouteMatch* match,
+                                             const char*           name) {
+    for (size_t i = 0; i < match->param_count; i++) {
+        if (strcmp(match->params[i].name, name) == 0) {
+            return &match->params[i];
+        }
+    }
+    return NULL;
+}
+
+void http_router_dispose(HttpRouter* router) {
+    node_free(router->root);
+    router->root = NULL;
+}
+
+/* ============= Internal Functions Implementation ============= */
+
+/**
+ * FNV-1a over the segment, the seed is what makes the table perfect
+ */
+static uint32_t segment_hash(uint32_t seed, const char* segment, size_t len) {
+    uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)segment[i];
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+static HttpRouterNode* node_create(const char* segment, size_t len) {
+    HttpRouterNode* node = calloc(1, sizeof(HttpRouterNode));
+    if (node == NULL) {
+        return NULL;
+    }
+
+    node->segment = strndup(segment, len);
+    if (node->segment == NULL) {
+        free(node);
+        return NULL;
+    }
+    node->segment_len = len;
+
+    return node;
+}
+
+static void node_free(HttpRouterNode* node) {
+    if (node == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < node->child_count; i++) {
+        node_free(node->children[i]);
+    }
+    node_free(node->param_child);
+
+    free(node->children);
+    free(node->table);
+    free(node->param_name);
+    free(node->segment);
+    free(node);
+}
+
+static HttpRouterNode* node_add_child(HttpRouterNode* node, const char* segment,
+                                      size_t len) {
+    for (size_t i = 0; i < node->child_count; i++) {
+        HttpRouterNode* child = node->children[i];
+        if (child->segment_len == len &&
+            memcmp(child->segment, segment, len) == 0) {
+            return child;
+        }
+    }
+
+    HttpRouterNode** children =
+        realloc(node->children, (node->child_count + 1) * sizeof(*children));
+    if (children == NULL) {
+        return NULL;
+    }
+    node->children = children;
+
+    HttpRouterNode* child = node_create(segment, len);
+    if (child == NULL) {
+        return NULL;
+    }
+    node->children[node->child_count++] = child;
+
+    return child;
+}
+
+/**
+ * Searches for a table size and seed that give every static child its own
+ * slot, then builds the Allow header value. Runs once per node at startup.
+ */
+static int node_compile(HttpRouterNode* node) {
+    size_t allow_len = 0;
+    for (int i = 0; i < HTTP_METHOD_COUNT; i++) {
+        int head_from_get =
+            i == HTTP_METHOD_HEAD && node->routes[HTTP_METHOD_GET] != NULL;
+        if (node->routes[i] == NULL && !head_from_get) {
+            continue;
+        }
+        allow_len += snprintf(node->allow + allow_len,
+                              sizeof(node->allow) - allow_len, "%s%s",
+                              allow_len ? ", " : "", HTTP_METHOD_NAMES[i]);
+    }
+
+    if (node->child_count > 0) {
+        uint32_t size = 1;
+        while (size < node->child_count) {
+            size <<= 1;
+        }
+
+        int placed = 0;
+        while (!placed && size <= HTTP_ROUTER_MAX_TABLE_SIZE) {
+            node->table = calloc(size, sizeof(*node->table));
+            if (node->table == NULL) {
+                return -2;
+            }
+            node->table_mask = size - 1;
+
+            for (uint32_t seed = 0; seed < HTTP_ROUTER_SEED_ATTEMPTS; seed++) {
+                memset(node->table, 0, size * sizeof(*node->table));
+                placed = 1;
+
+                for (size_t i = 0; i < node->child_count; i++) {
+                    HttpRouterNode* child = node->children[i];
+                    uint32_t        slot =
+                        segment_hash(seed, child->segment, child->segment_len) &
+                        node->table_mask;
+                    if (node->table[slot] != NULL) {
+                        placed = 0;
+                        break;
+                    }
+                    node->table[slot] = child;
+                }
+
+                if (placed) {
+                    node->seed = seed;
+                    break;
+                }
+            }
+
+            if (!placed) {
+                free(node->table);
+                node->table = NULL;
+                size <<= 1;
+            }
+        }
+
+        if (!placed) {
+            printf("[ROUTER] Could not build perfect hash for /%s\n",
+                   node->segment);
+            return -1;
+        }
+    }
+
+    for (size_t i = 0; i < node->child_count; i++) {
+        int result = node_compile(node->children[i]);
+        if (result != 0) {
+            return result;
+        }
+    }
+
+    return node->param_child ? node_compile(node->param_child) : 0;
+}
+
+/**
+ * Matches the remaining path, which starts at a '/'. Static segments win over
+ * parameters, falling back to the parameter branch if the static one fails.
+ */
+static const HttpRouterNode* node_match(const HttpRouterNode* node,
+                                        const char* path, const char* end,
+                                        HttpRouteMatch* match) {
+    if (path == end) {
+        return node->allow[0] != '\0' ? node : NULL;
+    }
+
+    const char* segment = path + 1;
+    const char* next    = memchr(segment, '/', end - segment);
+    if (next == NULL) {
+        next = end;
+    }
+    size_t len = next - segment;
+
+    if (node->table != NULL) {
+        const HttpRouterNode* child =
+            node->table[segment_hash(node->seed, segment, len) &
+                        node->table_mask];
+        if (child != NULL && child->segment_len == len &&
+            memcmp(child->segment, segment, len) == 0) {
+            const HttpRouterNode* found = node_match(child, next, end, match);
+            if (found != NULL) {
+                return found;
+            }
+        }
+    }
+
+    if (node->param_child != NULL && len > 0 &&
+        match->param_count < HTTP_ROUTER_MAX_PARAMS) {
+        HttpRouteParam* param = &match->params[match->param_count++];
+        param->name           = node->param_name;
+        param->value          = segment;
+        param->value_len      = len;
+
+        const HttpRouterNode* found =
+            node_match(node->param_child, next, end, match);
+        if (found != NULL) {
+            return found;
+        }
+        match->param_count--;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,85 @@
+/// Declarative route table compiled once at startup into a segment trie.
+/// Each trie node stores its static children in a perfect hash table, so a
+/// lookup costs one probe per path segment no matter how many routes exist.
+/// Segments starting with ':' capture a path parameter, e.g. "/v1/:city".
+/// HEAD falls back to the GET route of the same path, so it is listed in the
+/// Allow value of every path with a GET route.
+#ifndef HTTP_ROUTER_H
+#define HTTP_ROUTER_H
+
+#include <stddef.h>
+
+// Path parameters captured by a single match
+#define HTTP_ROUTER_MAX_PARAMS 8
+
+// Space for the Allow header value, e.g. "GET, HEAD, POST"
+#define HTTP_ROUTER_ALLOW_MAX_LEN 64
+
+typedef enum {
+    HTTP_METHOD_GET,
+    HTTP_METHOD_HEAD,
+    HTTP_METHOD_POST,
+    HTTP_METHOD_PUT,
+    HTTP_METHOD_DELETE,
+    HTTP_METHOD_PATCH,
+    HTTP_METHOD_OPTIONS,
+    HTTP_METHOD_COUNT,
+    HTTP_METHOD_UNKNOWN = HTTP_METHOD_COUNT,
+} HttpMethod;
+
+typedef enum {
+    HTTP_ROUTER_MATCH,
+    HTTP_ROUTER_NOT_FOUND,
+    HTTP_ROUTER_METHOD_NOT_ALLOWED,
+} HttpRouterResult;
+
+typedef struct {
+    const char* name;  // Parameter name without the leading ':'
+    const char* value; // Points into the matched path, not NUL-terminated
+    size_t      value_len;
+} HttpRouteParam;
+
+typedef struct HttpRoute      HttpRoute;
+typedef struct HttpRouteMatch HttpRouteMatch;
+
+typedef int (*HttpRouteHandler)(void* context, const HttpRouteMatch* match);
+
+struct HttpRoute {
+    const char*      method;  // "GET", "POST", ...
+    const char*      pattern; // "/v1/current", "/v1/:city/current", ...
+    HttpRouteHandler handler;
+};
+
+struct HttpRouteMatch {
+    const HttpRoute* route; // Set on HTTP_ROUTER_MATCH
+    const char*      allow; // Set on HTTP_ROUTER_METHOD_NOT_ALLOWED
+
+    HttpRouteParam params[HTTP_ROUTER_MAX_PARAMS];
+    size_t         param_count;
+};
+
+typedef struct HttpRouterNode HttpRouterNode;
+
+typedef struct {
+    HttpRouterNode* root;
+} HttpRouter;
+
+HttpMethod http_method_parse(const char* method);
+
+/* Compiles the route table, routes must outlive the router. Returns 0 on
+ * success, -1 on an invalid or duplicate route and -2 on allocation failure */
+int http_router_initiate(HttpRouter* router, const HttpRoute* routes,
+                         size_t route_count);
+
+/* Matches method and path (without query string) against the compiled table */
+HttpRouterResult http_router_match(const HttpRouter* router,
+                                   const char* method, const char* path,
+                                   size_t path_len, HttpRouteMatch* match);
+
+/* Returns the value of a captured path parameter, NULL if not captured */
+const HttpRouteParam* http_route_match_param(const HttpRouteMatch* match,
+                                             const char*           name);
+
+void http_router_dispose(HttpRouter* router);
+
+#endif // HTTP_ROUTER_H
@@ -54,7 +54,12 @@ int http_server_on_accept(int fd, void* context) {
         return -1;
     }
 
-    server->onConnection(server, connection);
+    if (server->onConnection(server, connection) != 0) {
+        // The TCP server closes fd when we fail, don't close it twice
+        connection->tcpClient.fd = -1;
+        http_server_connection_dispose_ptr(&connection);
+        return -1;
+    }
 
     return 0;
 }
@@ -6,10 +6,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 //-----------------Internal Functions-----------------
 
 void http_server_connection_task_work(void* context, uint64_t mon_time);
+void http_server_connection_dispatch(HTTPServerConnection* connection);
 
 //----------------------------------------------------
 
@@ -19,14 +21,16 @@ int http_server_connection_initiate(HTTPServerConnection* connection, int fd) {
     connection->method           = NULL;
     connection->request_path     = NULL;
     connection->host             = NULL;
-    connection->write_buffer     = NULL;
     connection->body             = NULL;
     connection->read_buffer_size = 0;
     connection->content_len      = 0;
-    connection->write_size       = 0;
-    connection->write_offset     = 0;
     connection->body_start       = 0;
     connection->state            = HTTP_SERVER_CONNECTION_STATE_RECEIVE;
+    connection->context          = NULL;
+    connection->onRequest        = NULL;
+    connection->onDispose        = NULL;
+
+    http_response_init(&connection->response);
 
     connection->task =
         smw_create_task(connection, http_server_connection_task_work);
@@ -59,33 +63,33 @@ int http_server_connection_initiate_ptr(int                    fd,
 
 void http_server_connection_set_callback(
     HTTPServerConnection* connection, void* context,
-    HttpServerConnectionOnRequest on_request) {
+    HttpServerConnectionOnRequest on_request,
+    HttpServerConnectionOnDispose on_dispose) {
     connection->context   = context;
     connection->onRequest = on_request;
+    connection->onDispose = on_dispose;
 }
 
 int http_server_connection_send(HTTPServerConnection* connection) {
-    if (!connection || !connection->write_buffer ||
-        connection->write_offset >= connection->write_size) {
+    if (!connection) {
         return 0;
     }
 
-    ssize_t sent =
-        tcp_client_write(&connection->tcpClient,
-                         connection->write_buffer + connection->write_offset,
-                         connection->write_size - connection->write_offset);
+    // Nothing was built, close rather than hang the client
+    if (!connection->response.finished) {
+        connection->state = HTTP_SERVER_CONNECTION_STATE_DISPOSE;
+        return -1;
+    }
 
-    if (sent > 0) {
-        connection->write_offset += sent;
-    } else if (sent < 0) {
-        if (errno != EAGAIN && errno != EWOULDBLOCK) {
-            connection->state = HTTP_SERVER_CONNECTION_STATE_DISPOSE;
-            return -1;
-        }
+    int result =
+        http_response_send(&connection->response, &connection->tcpClient);
+    if (result < 0) {
+        connection->state = HTTP_SERVER_CONNECTION_STATE_DISPOSE;
+        return -1;
     }
 
     // Finished sending
-    if (connection->write_offset >= connection->write_size) {
+    if (result == 1) {
         connection->state = HTTP_SERVER_CONNECTION_STATE_DISPOSE;
     }
 
@@ -103,8 +107,10 @@ int http_server_connection_receive(HTTPServerConnection* connection) {
     int bytes_read = tcp_client_read(&connection->tcpClient, chunk_buffer,
                                      sizeof(chunk_buffer));
 
+    // A client gone before its request was complete never gets an answer
     if (bytes_read < 0) {
-        return -1; // real error
+        connection->state = HTTP_SERVER_CONNECTION_STATE_DISPOSE;
+        return -1;
     } else if (bytes_read == 0) {
         return 0;
     }
@@ -112,6 +118,7 @@ int http_server_connection_receive(HTTPServerConnection* connection) {
     size_t   new_size   = connection->read_buffer_size + bytes_read;
     uint8_t* new_buffer = realloc(connection->read_buffer, new_size);
     if (!new_buffer) {
+        connection->state = HTTP_SERVER_CONNECTION_STATE_DISPOSE;
         return -1;
     }
 
@@ -120,9 +127,9 @@ int http_server_connection_receive(HTTPServerConnection* connection) {
            bytes_read);
     connection->read_buffer_size += bytes_read;
 
-    if (connection->body_start == 0) {
+    if (connection->body_start == 0 && connection->read_buffer_size >= 4) {
 
-        for (int i = 0; i <= connection->read_buffer_size - 4; i++) {
+        for (size_t i = 0; i <= connection->read_buffer_size - 4; i++) {
 
             // Checks if we have parsed all headers
             if (connection->read_buffer[i] == '\r' &&
@@ -138,6 +145,7 @@ int http_server_connection_receive(HTTPServerConnection* connection) {
                 int   header_end = i + 4;
                 char* headers    = malloc(header_end + 1);
                 if (!headers) {
+                    connection->state = HTTP_SERVER_CONNECTION_STATE_DISPOSE;
                     return -1;
                 }
 
@@ -176,12 +184,12 @@ int http_server_connection_receive(HTTPServerConnection* connection) {
         connection->body_start > 0) {
 
         if (connection->method && strcmp(connection->method, "GET") == 0) {
-            connection->state = HTTP_SERVER_CONNECTION_STATE_SEND;
-            connection->onRequest(connection->context);
+            http_server_connection_dispatch(connection);
             return 0;
         }
         connection->body = malloc(connection->content_len);
         if (!connection->body) {
+            connection->state = HTTP_SERVER_CONNECTION_STATE_DISPOSE;
             return -1;
         }
 
@@ -189,28 +197,96 @@ int http_server_connection_receive(HTTPServerConnection* connection) {
                connection->read_buffer + connection->body_start,
                connection->content_len);
 
-        connection->state = HTTP_SERVER_CONNECTION_STATE_SEND;
-        connection->onRequest(connection->context);
+        http_server_connection_dispatch(connection);
     }
 
     return 0;
 }
 
+void http_server_connection_dispatch(HTTPServerConnection* connection) {
+    // The state is left alone during the call so a retry can tell
+    int result = connection->onRequest(connection->context);
+    if (result == HTTP_SERVER_CONNECTION_PENDING) {
+        connection->state = HTTP_SERVER_CONNECTION_STATE_WAIT;
+        return;
+    }
+
+    // HEAD is answered like GET, without the body
+    if (connection->method && strcmp(connection->method, "HEAD") == 0) {
+        http_response_omit_body(&connection->response);
+    }
+    connection->state = HTTP_SERVER_CONNECTION_STATE_SEND;
+}
+
 void http_server_connection_task_work(void* context, uint64_t mon_time) {
     HTTPServerConnection* connection = (HTTPServerConnection*)context;
     switch (connection->state) {
     case HTTP_SERVER_CONNECTION_STATE_RECEIVE:
         http_server_connection_receive(connection);
         break;
+    case HTTP_SERVER_CONNECTION_STATE_WAIT:
+        http_server_connection_dispatch(connection);
+        break;
     case HTTP_SERVER_CONNECTION_STATE_SEND:
         http_server_connection_send(connection);
         break;
     case HTTP_SERVER_CONNECTION_STATE_DISPOSE:
         http_server_connection_dispose(connection);
+        // Hands the connection back to its owner, it must not be used after
+        if (connection->onDispose) {
+            connection->onDispose(connection->context);
+        } else {
+            http_server_connection_dispose_ptr(&connection);
+        }
         break;
     }
 }
 
+const char* http_server_connection_get_header(HTTPServerConnection* connection,
+                                              const char*           name,
+                                              size_t*               value_len) {
+    if (connection->body_start == 0 || name == NULL) {
+        return NULL;
+    }
+
+    const char* cur      = (const char*)connection->read_buffer;
+    const char* end      = cur + connection->body_start;
+    size_t      name_len = strlen(name);
+
+    // Skip the request line, then walk the header lines
+    const char* line_end = memchr(cur, '\n', end - cur);
+    while (line_end != NULL && line_end + 1 < end) {
+        cur      = line_end + 1;
+        line_end = memchr(cur, '\n', end - cur);
+        if (line_end == NULL) {
+            break;
+        }
+
+        if ((size_t)(line_end - cur) <= name_len || cur[name_len] != ':' ||
+            strncasecmp(cur, name, name_len) != 0) {
+            continue;
+        }
+
+        const char* value     = cur + name_len + 1;
+        const char* value_end = line_end;
+        while (value < value_end && (*value == ' ' || *value == '\t')) {
+            value++;
+        }
+        while (value_end > value &&
+               (value_end[-1] == '\r' || value_end[-1] == ' ' ||
+                value_end[-1] == '\t')) {
+            value_end--;
+        }
+
+        if (value_len) {
+            *value_len = value_end - value;
+        }
+        return value;
+    }
+
+    return NULL;
+}
+
 void http_server_connection_dispose(HTTPServerConnection* connection) {
     if (!connection) {
         return;
@@ -225,6 +301,9 @@ void http_server_connection_dispose(HTTPServerConnection* connection) {
     // Dispose TCP client
     tcp_client_dispose(&connection->tcpClient);
 
+    // Release response bodies first, they may point into the buffers below
+    http_response_dispose(&connection->response);
+
     // Free all dynamically allocated memory
     free(connection->read_buffer);
     connection->read_buffer = NULL;
@@ -241,12 +320,7 @@ void http_server_connection_dispose(HTTPServerConnection* connection) {
     free(connection->host);
     connection->host = NULL;
 
-    free(connection->write_buffer);
-    connection->write_buffer = NULL;
-
     connection->read_buffer_size = 0;
-    connection->write_size       = 0;
-    connection->write_offset     = 0;
     connection->body_start       = 0;
     connection->content_len      = 0;
 }
@@ -1,9 +1,17 @@
 /// OnRequest callback will send context with data fields from request.
-/// In this callback you can set the write_buffer with the response you want.
+/// In this callback you build the response you want in connection->response.
+/// OnRequest may instead return HTTP_SERVER_CONNECTION_PENDING when the
+/// response waits on something, such as a disk read, it is then called again
+/// on later passes of the loop until it returns anything else. The state is
+/// HTTP_SERVER_CONNECTION_STATE_WAIT during those later calls.
+/// OnDispose callback is called once the connection is closed. The receiver
+/// owns the connection and must release it with
+/// http_server_connection_dispose_ptr.
 #ifndef HTTP_SERVER_CONNECTION_H
 #define HTTP_SERVER_CONNECTION_H
 
 #include "../tcp_client.h"
+#include "http_response.h"
 #include "smw.h"
 
 #include <stddef.h>
@@ -17,11 +25,16 @@
 #define REQUEST_PATH_MAX_LEN 256
 #define HOST_MAX_LEN 256
 
+// OnRequest result asking to be called again later
+#define HTTP_SERVER_CONNECTION_PENDING 1
+
 typedef int (*HttpServerConnectionOnRequest)(void* context);
+typedef void (*HttpServerConnectionOnDispose)(void* context);
 
 typedef enum {
     HTTP_SERVER_CONNECTION_STATE_SEND,
     HTTP_SERVER_CONNECTION_STATE_RECEIVE,
+    HTTP_SERVER_CONNECTION_STATE_WAIT,
     HTTP_SERVER_CONNECTION_STATE_DISPOSE,
 } HttpServerConnectionState;
 
@@ -32,6 +45,7 @@ typedef struct {
     HttpServerConnectionState     state;
     void*                         context;
     HttpServerConnectionOnRequest onRequest;
+    HttpServerConnectionOnDispose onDispose;
 
     char*  method;
     char*  request_path;
@@ -44,9 +58,7 @@ typedef struct {
     uint8_t* body;
     size_t   body_start;
 
-    uint8_t* write_buffer;
-    size_t   write_size;
-    size_t   write_offset;
+    HttpResponse response;
 
 } HTTPServerConnection;
 
@@ -56,7 +68,15 @@ int http_server_connection_initiate_ptr(int                    fd,
 
 void http_server_connection_set_callback(
     HTTPServerConnection* connection, void* context,
-    HttpServerConnectionOnRequest on_request);
+    HttpServerConnectionOnRequest on_request,
+    HttpServerConnectionOnDispose on_dispose);
+
+/* Looks up a request header by name, ignoring case. Returns a pointer into the
+ * read buffer with the trimmed value length in value_len, or NULL if absent.
+ * The value is not NUL-terminated and lives as long as the connection. */
+const char* http_server_connection_get_header(HTTPServerConnection* connection,
+                                              const char*           name,
+                                              size_t*               value_len);
 
 void http_server_connection_dispose(HTTPServerConnection* connection);
 void http_server_connection_dispose_ptr(HTTPServerConnection** connection_ptr);
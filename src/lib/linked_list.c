@@ -2,6 +2,37 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+/* Free-list of released Nodes, chained through Node->front. Per thread so the
+ * pool never needs locking. */
+static _Thread_local Node*  g_node_pool      = NULL;
+static _Thread_local size_t g_node_pool_size = 0;
+
+static Node* node_acquire(void) {
+    Node* node = g_node_pool;
+    if (node == NULL) {
+        return calloc(1, sizeof(Node));
+    }
+
+    g_node_pool = node->front;
+    g_node_pool_size--;
+    memset(node, 0, sizeof(Node));
+    return node;
+}
+
+static void node_release(Node* node) {
+    if (g_node_pool_size >= LINKED_LIST_NODE_POOL_MAX) {
+        free(node);
+        return;
+    }
+
+    node->back  = NULL;
+    node->item  = NULL;
+    node->front = g_node_pool;
+    g_node_pool = node;
+    g_node_pool_size++;
+}
 
 LinkedList* linked_list_create() {
     LinkedList* new_list = calloc(
@@ -42,7 +73,7 @@ int linked_list_append(LinkedList* list, void* item) {
     if (list == NULL) {
         return 1;
     }
-    Node* new_node = calloc(1, sizeof(Node));
+    Node* new_node = node_acquire();
     if (new_node == NULL) {
         return 1;
     }
@@ -73,7 +104,7 @@ int linked_list_insert(LinkedList* list, size_t index, void* item) {
         return 1;
     }
 
-    Node* new_node = calloc(1, sizeof(Node));
+    Node* new_node = node_acquire();
     if (new_node == NULL) {
         return 1;
     }
@@ -124,7 +155,7 @@ int linked_list_remove(LinkedList* list, Node* item,
         free_function(item->item);
     }
 
-    free(item);
+    node_release(item);
 
     return 0;
 }
@@ -148,7 +179,7 @@ void linked_list_clear(LinkedList* list, void (*free_function)(void*)) {
         if (free_function != NULL) {
             free_function(cur->item);
         }
-        free(cur);
+        node_release(cur);
         cur = next;
     }
 
@@ -156,8 +187,76 @@ void linked_list_clear(LinkedList* list, void (*free_function)(void*)) {
     list->tail = NULL;
     list->size = 0;
 }
+
 void linked_list_dispose(LinkedList** list, void (*free_function)(void*)) {
     linked_list_clear(*list, free_function);
     free(*list);
     *list = NULL;
 }
+
+void linked_list_pool_clear(void) {
+    while (g_node_pool) {
+        Node* next = g_node_pool->front;
+        free(g_node_pool);
+        g_node_pool = next;
+    }
+    g_node_pool_size = 0;
+}
+
+void intrusive_list_init(IntrusiveList* list) {
+    list->head = NULL;
+    list->tail = NULL;
+    list->size = 0;
+}
+
+void intrusive_list_append(IntrusiveList* list, ListHook* hook) {
+    hook->front = NULL;
+    hook->back  = list->tail;
+
+    if (list->tail == NULL) {
+        list->head = hook;
+    } else {
+        list->tail->front = hook;
+    }
+    list->tail = hook;
+    list->size++;
+}
+
+void intrusive_list_prepend(IntrusiveList* list, ListHook* hook) {
+    hook->back  = NULL;
+    hook->front = list->head;
+
+    if (list->head == NULL) {
+        list->tail = hook;
+    } else {
+        list->head->back = hook;
+    }
+    list->head = hook;
+    list->size++;
+}
+
+void intrusive_list_remove(IntrusiveList* list, ListHook* hook) {
+    if (hook->back != NULL) {
+        hook->back->front = hook->front;
+    } else {
+        list->head = hook->front;
+    }
+
+    if (hook->front != NULL) {
+        hook->front->back = hook->back;
+    } else {
+        list->tail = hook->back;
+    }
+
+    hook->back  = NULL;
+    hook->front = NULL;
+    list->size--;
+}
+
+ListHook* intrusive_list_pop_front(IntrusiveList* list) {
+    ListHook* hook = list->head;
+    if (hook != NULL) {
+        intrusive_list_remove(list, hook);
+    }
+    return hook;
+}
@@ -3,6 +3,11 @@
 
 #include <stddef.h>
 
+/* Upper bound of released Nodes kept for reuse by each thread */
+#ifndef LINKED_LIST_NODE_POOL_MAX
+#    define LINKED_LIST_NODE_POOL_MAX 1024
+#endif
+
 typedef struct Node Node;
 struct Node {
     Node* back;
@@ -19,6 +24,40 @@ typedef struct {
 #define LinkedList_foreach(list, node)                                         \
     for (Node * (node) = (list)->head; (node) != NULL; (node) = (node)->front)
 
+/*
+  Intrusive variant
+    The ListHook is embedded in the owning struct instead of being allocated
+  separately, so appending never allocates and iterating never chases an extra
+  item pointer. The owner is recovered with IntrusiveList_entry. Example:
+
+    typedef struct { ListHook hook; int value; } Item;
+    IntrusiveList_foreach(&list, Item, hook, item) { item->value++; }
+*/
+typedef struct ListHook ListHook;
+struct ListHook {
+    ListHook* back;
+    ListHook* front;
+};
+
+typedef struct {
+    ListHook* head;
+    ListHook* tail;
+    size_t    size;
+} IntrusiveList;
+
+#define IntrusiveList_entry(hook, type, member)                                \
+    ((type*)((char*)(hook) - offsetof(type, member)))
+
+#define IntrusiveList_entry_or_null(hook, type, member)                        \
+    ((hook) != NULL ? IntrusiveList_entry(hook, type, member) : NULL)
+
+#define IntrusiveList_foreach(list, type, member, entry)                       \
+    for (type * (entry) =                                                      \
+             IntrusiveList_entry_or_null((list)->head, type, member);          \
+         (entry) != NULL;                                                      \
+         (entry) = IntrusiveList_entry_or_null((entry)->member.front, type,    \
+                                               member))
+
 /* Initializes a new empty LinkedList, and returns the pointer to it */
 LinkedList* linked_list_create();
 
@@ -69,4 +108,29 @@ void linked_list_clear(LinkedList* list, void (*free_function)(void*));
 */
 void linked_list_dispose(LinkedList** list, void (*free_function)(void*));
 
+/*
+  Release every Node kept in the calling thread's free-list pool
+    Nodes removed from any LinkedList are kept for reuse by later appends and
+  inserts instead of being returned to the allocator. Call this on shutdown.
+*/
+void linked_list_pool_clear(void);
+
+/* Initializes an empty IntrusiveList, for lists embedded in other structs */
+void intrusive_list_init(IntrusiveList* list);
+
+/* Links hook in as the last element of the list */
+void intrusive_list_append(IntrusiveList* list, ListHook* hook);
+
+/* Links hook in as the first element of the list */
+void intrusive_list_prepend(IntrusiveList* list, ListHook* hook);
+
+/*
+  Unlinks hook from the list
+    The owning struct is left untouched, releasing it is up to the caller.
+*/
+void intrusive_list_remove(IntrusiveList* list, ListHook* hook);
+
+/* Unlinks and returns the first hook, returns NULL if the list is empty */
+ListHook* intrusive_list_pop_front(IntrusiveList* list);
+
 #endif
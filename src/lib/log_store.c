@@ -0,0 +1,1205 @@
+#include "log_store.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define LOG_STORE_INDEX_MAGIC 0x5849574au   // "JWIX"
+#define LOG_STORE_SEGMENT_MAGIC 0x4753574au // "JWSG"
+#define LOG_STORE_RECORD_MAGIC 0x4352574au  // "JWRC"
+#define LOG_STORE_VERSION 1
+
+#define LOG_STORE_PATH_MAX 512
+#define LOG_STORE_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+struct LogStoreIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t clean; // Set by dispose, an unclean index is rebuilt on open
+    uint32_t reserved;
+    uint64_t capacity; // Slots, a power of two
+    uint64_t count;
+};
+
+struct LogStoreSlot {
+    uint64_t hash; // 0 marks an empty slot
+    uint32_t segment;
+    uint32_t offset;
+    int64_t  expires_at;
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t used; // Bytes in use, header included, moved past each record
+} SegmentHeader;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t crc; // CRC-32 of the rest of the header, the key and the value
+    uint32_t key_len;
+    uint32_t value_len;
+    int64_t  written_at;
+    int64_t  expires_at;
+} RecordHeader;
+
+#define SEGMENT_DATA_START LOG_STORE_ALIGN(sizeof(SegmentHeader))
+
+//-----------------Internal Functions-----------------
+
+static uint64_t         key_hash(const char* key, size_t len);
+static size_t           record_size(size_t key_len, size_t value_len);
+static uint32_t         record_crc(const RecordHeader* header);
+static const char*      record_key(const RecordHeader* header);
+static void             record_fill(const RecordHeader* header,
+                                    LogStoreRecord*     record);
+static SegmentHeader*   segment_header(const LogStoreSegment* segment);
+static int              segment_resident(const LogStoreSegment* segment,
+                                         size_t begin, size_t end);
+static LogStoreSegment* segment_find(LogStore* store, uint32_t id);
+static int              segment_open(LogStore* store, uint32_t id, int create,
+                                     LogStoreSegment* segment);
+static void             segment_close(LogStoreSegment* segment);
+static void             segment_release(LogStoreSegment*    segment,
+                                        const RecordHeader* header);
+static int              segment_add(LogStore* store);
+static void             segment_delete(LogStore* store, uint32_t id);
+static int              compare_ids(const void* a, const void* b);
+static int              segments_load(LogStore* store);
+static RecordHeader*    record_at(LogStore* store, const LogStoreSlot* slot,
+                                  LogStoreSegment** segment);
+static int record_append(LogStore* store, const char* key, size_t key_len,
+                         const void* value, size_t value_len,
+                         time_t written_at, time_t expires_at,
+                         uint32_t* segment_id, uint32_t* offset);
+static int index_open(LogStore* store);
+static int index_create(LogStore* store, uint64_t capacity);
+static int index_rebuild(LogStore* store);
+static LogStoreSlot* index_lookup(LogStore* store, uint64_t hash,
+                                  const char* key, size_t len);
+static int  index_set(LogStore* store, const char* key, size_t len,
+                      uint32_t segment_id, uint32_t offset, time_t expires_at);
+static void index_remove(LogStore* store, LogStoreSlot* slot);
+static void index_count_live(LogStore* store);
+static void index_sweep(LogStore* store, time_t now);
+static void evict_segment(LogStore* store);
+static int  evict_records(LogStore* store, size_t wanted);
+static void bloom_rebuild(LogStore* store);
+static int  bloom_may_contain(const LogStore* store, uint64_t hash);
+
+//----------------------------------------------------
+
+int log_store_initiate(LogStore* store, const char* dir, size_t segment_size) {
+    memset(store, 0, sizeof(LogStore));
+    store->index_fd        = -1;
+    store->next_segment_id = 1;
+    store->segment_size    = segment_size ? segment_size
+                                          : LOG_STORE_DEFAULT_SEGMENT_SIZE;
+
+    // Offsets are 32 bits
+    if (store->segment_size > UINT32_MAX ||
+        store->segment_size < SEGMENT_DATA_START + sizeof(RecordHeader)) {
+        return -1;
+    }
+
+    store->dir = strdup(dir);
+    if (store->dir == NULL) {
+        return -2;
+    }
+
+    mkdir(dir, 0755);
+
+    int result = segments_load(store);
+    if (result == 0) {
+        result = index_open(store);
+    }
+    if (result == 0 && store->segment_count == 0) {
+        result = segment_add(store);
+    }
+    if (result != 0) {
+        log_store_dispose(store);
+        return result;
+    }
+
+    index_count_live(store);
+    bloom_rebuild(store);
+    printf("[STORE] Opened %s: %zu keys in %zu segments\n", dir,
+           log_store_count(store), store->segment_count);
+
+    return 0;
+}
+
+int log_store_get(LogStore* store, const char* key, LogStoreRecord* record) {
+    size_t   len  = strlen(key);
+    uint64_t hash = key_hash(key, len);
+    if (!bloom_may_contain(store, hash)) {
+        store->bloom_skipped++;
+        return -1;
+    }
+
+    LogStoreSlot* slot = index_lookup(store, hash, key, len);
+    if (slot == NULL) {
+        store->bloom_false_positives++;
+        return -1;
+    }
+
+    LogStoreSegment* segment = NULL;
+    RecordHeader*    header  = record_at(store, slot, &segment);
+
+    // Bad bytes on disk read as a miss, the caller rewrites the key
+    if (record_crc(header) != header->crc) {
+        printf("[STORE] Checksum mismatch for %s, dropping it\n", key);
+        segment_release(segment, header);
+        index_remove(store, slot);
+        return -1;
+    }
+
+    record_fill(header, record);
+    return 0;
+}
+
+int log_store_read(const LogStore* store, const char* key,
+                   LogStoreRecord* record) {
+    // index_lookup and record_at only read, they just take it non-const
+    LogStore* mutable_store = (LogStore*)store;
+    size_t    len           = strlen(key);
+    uint64_t  hash          = key_hash(key, len);
+    if (!bloom_may_contain(store, hash)) {
+        return -1;
+    }
+
+    LogStoreSlot* slot = index_lookup(mutable_store, hash, key, len);
+    if (slot == NULL) {
+        return -1;
+    }
+
+    RecordHeader* header = record_at(mutable_store, slot, NULL);
+    if (record_crc(header) != header->crc) {
+        return -1;
+    }
+
+    record_fill(header, record);
+    return 0;
+}
+
+int log_store_resident(const LogStore* store, const char* key, int* fd,
+                       off_t* offset, size_t* len) {
+    // Walks the probe sequence like index_lookup, which would fault the
+    // record in while comparing keys
+    LogStore* mutable_store = (LogStore*)store;
+    size_t    key_len       = strlen(key);
+    uint64_t  hash          = key_hash(key, key_len);
+    uint64_t  mask          = store->index->capacity - 1;
+    if (!bloom_may_contain(store, hash)) {
+        return 1;
+    }
+
+    for (uint64_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        const LogStoreSlot* slot = &store->slots[pos];
+        if (slot->hash == 0) {
+            return 1;
+        }
+        if (slot->hash != hash) {
+            continue;
+        }
+
+        LogStoreSegment* segment = segment_find(mutable_store, slot->segment);
+        if (segment == NULL) {
+            continue;
+        }
+        // Bounded by the file, not by used: that lives in the segment's
+        // first page, which may not be in memory either
+        size_t size  = segment->size;
+        size_t begin = slot->offset;
+        size_t end   = begin + sizeof(RecordHeader);
+        if (end > size) {
+            continue;
+        }
+
+        if (segment_resident(segment, begin, end)) {
+            RecordHeader* header = (RecordHeader*)(segment->base + begin);
+            if (header->magic != LOG_STORE_RECORD_MAGIC) {
+                continue;
+            }
+            end = begin + record_size(header->key_len, header->value_len);
+            end = end < size ? end : size;
+            if (segment_resident(segment, begin, end)) {
+                if (header->key_len == key_len &&
+                    memcmp(record_key(header), key, key_len) == 0) {
+                    return 1;
+                }
+                continue;
+            }
+        } else {
+            end = begin + LOG_STORE_READ_AHEAD;
+            end = end < size ? end : size;
+        }
+
+        size_t page  = (size_t)sysconf(_SC_PAGESIZE);
+        size_t start = begin & ~(page - 1);
+        *fd          = dup(segment->fd);
+        if (*fd < 0) {
+            return -1;
+        }
+        *offset = (off_t)start;
+        *len    = end - start;
+        return 0;
+    }
+}
+
+void log_store_scan(const LogStore* store, size_t part, size_t parts,
+                    LogStoreScanCallback callback, void* context) {
+    LogStore* mutable_store = (LogStore*)store;
+    uint64_t  capacity      = store->index->capacity;
+    uint64_t  begin         = capacity * part / parts;
+    uint64_t  end           = capacity * (part + 1) / parts;
+
+    for (uint64_t i = begin; i < end; i++) {
+        const LogStoreSlot* slot = &store->slots[i];
+        if (slot->hash == 0) {
+            continue;
+        }
+
+        RecordHeader* header = record_at(mutable_store, slot, NULL);
+        if (header == NULL || record_crc(header) != header->crc) {
+            continue;
+        }
+
+        LogStoreRecord record;
+        record_fill(header, &record);
+        if (callback(record_key(header), header->key_len, &record, context)) {
+            return;
+        }
+    }
+}
+
+int log_store_put(LogStore* store, const char* key, const void* value,
+                  size_t value_len, time_t expires_at) {
+    size_t   len = strlen(key);
+    uint32_t segment_id, offset;
+
+    int result = record_append(store, key, len, value, value_len, time(NULL),
+                               expires_at, &segment_id, &offset);
+    if (result == 0) {
+        result = index_set(store, key, len, segment_id, offset, expires_at);
+    }
+    if (result == 0) {
+        segment_find(store, segment_id)->live += record_size(len, value_len);
+    }
+    return result;
+}
+
+void log_store_set_limits(LogStore* store, size_t max_bytes,
+                          size_t max_entries) {
+    store->max_bytes   = max_bytes;
+    store->max_entries = max_entries;
+}
+
+int log_store_compact_step(LogStore* store, time_t now) {
+    if (store->bloom_removed * 4 > store->bloom.count ||
+        store->bloom.capacity != store->index->capacity) {
+        bloom_rebuild(store);
+    }
+    index_sweep(store, now);
+
+    // Over a limit the oldest data goes, compacting it would be wasted work
+    if (store->max_bytes && store->segment_count > 1 &&
+        log_store_disk_size(store) > store->max_bytes) {
+        evict_segment(store);
+        return 1;
+    }
+    if (store->max_entries && log_store_count(store) > store->max_entries) {
+        return evict_records(store,
+                             log_store_count(store) - store->max_entries) > 0;
+    }
+
+    // The emptiest sealed segment, the last one is still appended to
+    size_t victim       = store->segment_count;
+    size_t victim_ratio = LOG_STORE_COMPACT_LIVE_PERCENT;
+    for (size_t i = 0; i + 1 < store->segment_count; i++) {
+        const LogStoreSegment* segment = &store->segments[i];
+        size_t payload = segment_header(segment)->used - SEGMENT_DATA_START;
+        size_t ratio   = payload ? segment->live * 100 / payload : 0;
+        if (ratio < victim_ratio) {
+            victim       = i;
+            victim_ratio = ratio;
+        }
+    }
+    if (victim == store->segment_count) {
+        return 0;
+    }
+
+    // Appending may grow the segment array, keep a copy of the mapping
+    LogStoreSegment source = store->segments[victim];
+    size_t          used   = segment_header(&source)->used;
+    size_t          moved  = 0;
+
+    for (size_t offset = SEGMENT_DATA_START; offset < used;) {
+        RecordHeader* header = (RecordHeader*)(source.base + offset);
+        if (header->magic != LOG_STORE_RECORD_MAGIC) {
+            break;
+        }
+        size_t size = record_size(header->key_len, header->value_len);
+
+        const char*   key  = record_key(header);
+        LogStoreSlot* slot = index_lookup(
+            store, key_hash(key, header->key_len), key, header->key_len);
+        if (slot && slot->segment == source.id && slot->offset == offset) {
+            uint32_t segment_id, new_offset;
+            int      result = record_append(
+                store, key, header->key_len,
+                (const uint8_t*)(header + 1) + header->key_len,
+                header->value_len, (time_t)header->written_at,
+                (time_t)header->expires_at, &segment_id, &new_offset);
+            if (result != 0) {
+                return result;
+            }
+
+            // record_append never touches the index, slot is still valid
+            slot->segment = segment_id;
+            slot->offset  = new_offset;
+            segment_find(store, segment_id)->live += size;
+            moved++;
+        }
+
+        offset += size;
+    }
+
+    printf("[STORE] Compacted segment %u: %zu records moved, %zu%% live\n",
+           source.id, moved, victim_ratio);
+    segment_delete(store, source.id);
+    store->compacted_segments++;
+    return 1;
+}
+
+size_t log_store_take_dirty(LogStore* store, int* fds, size_t max) {
+    size_t count = 0;
+    for (size_t i = 0; i < store->segment_count && count < max; i++) {
+        LogStoreSegment* segment = &store->segments[i];
+        if (!segment->dirty) {
+            continue;
+        }
+
+        int fd = dup(segment->fd);
+        if (fd >= 0) {
+            fds[count++]   = fd;
+            segment->dirty = 0;
+        }
+    }
+    return count;
+}
+
+size_t log_store_count(const LogStore* store) {
+    return store->index ? (size_t)store->index->count : 0;
+}
+
+size_t log_store_disk_size(const LogStore* store) {
+    size_t total = store->index_size;
+    for (size_t i = 0; i < store->segment_count; i++) {
+        total += segment_header(&store->segments[i])->used;
+    }
+    return total;
+}
+
+void log_store_dispose(LogStore* store) {
+    for (size_t i = 0; i < store->segment_count; i++) {
+        msync(store->segments[i].base, store->segments[i].size, MS_SYNC);
+        segment_close(&store->segments[i]);
+    }
+    free(store->segments);
+    store->segments      = NULL;
+    store->segment_count = 0;
+
+    if (store->index) {
+        // Only now does the index match the segments on disk
+        store->index->clean = 1;
+        msync(store->index, store->index_size, MS_SYNC);
+        munmap(store->index, store->index_size);
+        store->index = NULL;
+        store->slots = NULL;
+    }
+    if (store->index_fd >= 0) {
+        close(store->index_fd);
+        store->index_fd = -1;
+    }
+
+    bloom_filter_dispose(&store->bloom);
+
+    free(store->dir);
+    store->dir = NULL;
+}
+
+/* ============= Internal Functions Implementation ============= */
+
+/**
+ * 64-bit FNV-1a, 0 is reserved for empty slots
+ */
+static uint64_t key_hash(const char* key, size_t len) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 1099511628211ull;
+    }
+    return hash ? hash : 1;
+}
+
+static size_t record_size(size_t key_len, size_t value_len) {
+    return LOG_STORE_ALIGN(sizeof(RecordHeader) + key_len + value_len);
+}
+
+static uint32_t record_crc(const RecordHeader* header) {
+    const uint8_t* start = (const uint8_t*)&header->key_len;
+    size_t         len   = sizeof(RecordHeader) -
+                   offsetof(RecordHeader, key_len) + header->key_len +
+                   header->value_len;
+    return (uint32_t)crc32(0L, start, (uInt)len);
+}
+
+static const char* record_key(const RecordHeader* header) {
+    return (const char*)(header + 1);
+}
+
+static void record_fill(const RecordHeader* header, LogStoreRecord* record) {
+    record->value      = (const uint8_t*)(header + 1) + header->key_len;
+    record->value_len  = header->value_len;
+    record->written_at = (time_t)header->written_at;
+    record->expires_at = (time_t)header->expires_at;
+}
+
+static SegmentHeader* segment_header(const LogStoreSegment* segment) {
+    return (SegmentHeader*)segment->base;
+}
+
+/**
+ * Returns 1 if every page of [begin, end) of the segment is in memory
+ */
+static int segment_resident(const LogStoreSegment* segment, size_t begin,
+                            size_t end) {
+    size_t        page = (size_t)sysconf(_SC_PAGESIZE);
+    unsigned char pages[16];
+
+    begin &= ~(page - 1);
+    while (begin < end) {
+        size_t count = (end - begin + page - 1) / page;
+        count        = count < sizeof(pages) ? count : sizeof(pages);
+        if (mincore(segment->base + begin, count * page, pages) != 0) {
+            return 0;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if ((pages[i] & 1) == 0) {
+                return 0;
+            }
+        }
+        begin += count * page;
+    }
+    return 1;
+}
+
+static LogStoreSegment* segment_find(LogStore* store, uint32_t id) {
+    size_t low = 0, high = store->segment_count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (store->segments[mid].id < id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < store->segment_count && store->segments[low].id == id) {
+        return &store->segments[low];
+    }
+    return NULL;
+}
+
+static int segment_open(LogStore* store, uint32_t id, int create,
+                        LogStoreSegment* segment) {
+    char path[LOG_STORE_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/segment-%08u.log", store->dir, id);
+
+    int fd = open(path, O_RDWR | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (fd < 0) {
+        printf("[STORE] Failed to open %s\n", path);
+        return -1;
+    }
+
+    // New segments are sparse files of the full size, mapped once
+    struct stat st;
+    if ((create && ftruncate(fd, (off_t)store->segment_size) != 0) ||
+        fstat(fd, &st) != 0 || (size_t)st.st_size < SEGMENT_DATA_START) {
+        close(fd);
+        return -1;
+    }
+
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    segment->id    = id;
+    segment->fd    = fd;
+    segment->base  = base;
+    segment->size  = (size_t)st.st_size;
+    segment->live  = 0;
+    segment->dirty = create;
+
+    SegmentHeader* header = segment_header(segment);
+    if (create) {
+        header->magic   = LOG_STORE_SEGMENT_MAGIC;
+        header->version = LOG_STORE_VERSION;
+        header->id      = id;
+        header->used    = SEGMENT_DATA_START;
+    } else if (header->magic != LOG_STORE_SEGMENT_MAGIC ||
+               header->version != LOG_STORE_VERSION || header->id != id ||
+               header->used < SEGMENT_DATA_START ||
+               header->used > segment->size) {
+        printf("[STORE] Ignoring damaged segment %s\n", path);
+        segment_close(segment);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * A record of the segment is no longer referenced by the index
+ */
+static void segment_release(LogStoreSegment*    segment,
+                            const RecordHeader* header) {
+    size_t size = record_size(header->key_len, header->value_len);
+    segment->live = segment->live > size ? segment->live - size : 0;
+}
+
+static void segment_close(LogStoreSegment* segment) {
+    if (segment->base) {
+        munmap(segment->base, segment->size);
+        segment->base = NULL;
+    }
+    if (segment->fd >= 0) {
+        close(segment->fd);
+        segment->fd = -1;
+    }
+}
+
+/**
+ * Starts a new segment after the last one, which is sealed from then on
+ */
+static int segment_add(LogStore* store) {
+    uint32_t id = store->next_segment_id++;
+
+    LogStoreSegment* segments =
+        realloc(store->segments,
+                (store->segment_count + 1) * sizeof(LogStoreSegment));
+    if (segments == NULL) {
+        return -2;
+    }
+    store->segments = segments;
+
+    if (segment_open(store, id, 1, &segments[store->segment_count]) != 0) {
+        return -1;
+    }
+    store->segment_count++;
+    return 0;
+}
+
+static void segment_delete(LogStore* store, uint32_t id) {
+    LogStoreSegment* segment = segment_find(store, id);
+    if (segment == NULL) {
+        return;
+    }
+
+    char path[LOG_STORE_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/segment-%08u.log", store->dir, id);
+
+    segment_close(segment);
+    unlink(path);
+
+    size_t index = segment - store->segments;
+    memmove(segment, segment + 1,
+            (store->segment_count - index - 1) * sizeof(LogStoreSegment));
+    store->segment_count--;
+}
+
+static int compare_ids(const void* a, const void* b) {
+    uint32_t left = *(const uint32_t*)a, right = *(const uint32_t*)b;
+    return left < right ? -1 : left > right;
+}
+
+/**
+ * Maps every segment in the directory, oldest first
+ */
+static int segments_load(LogStore* store) {
+    DIR* dir = opendir(store->dir);
+    if (dir == NULL) {
+        printf("[STORE] Cannot open directory %s\n", store->dir);
+        return -1;
+    }
+
+    uint32_t*      ids      = NULL;
+    size_t         count    = 0;
+    size_t         capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        uint32_t id;
+        char     suffix[8];
+        if (sscanf(entry->d_name, "segment-%8u.%7s", &id, suffix) != 2 ||
+            strcmp(suffix, "log") != 0) {
+            continue;
+        }
+
+        if (count == capacity) {
+            capacity      = capacity ? capacity * 2 : 16;
+            uint32_t* tmp = realloc(ids, capacity * sizeof(uint32_t));
+            if (tmp == NULL) {
+                free(ids);
+                closedir(dir);
+                return -2;
+            }
+            ids = tmp;
+        }
+        ids[count++] = id;
+
+        // Damaged segments stay on disk, never reuse their ids
+        if (id >= store->next_segment_id) {
+            store->next_segment_id = id + 1;
+        }
+    }
+    closedir(dir);
+
+    if (count > 1) {
+        qsort(ids, count, sizeof(uint32_t), compare_ids);
+    }
+
+    store->segments = calloc(count ? count : 1, sizeof(LogStoreSegment));
+    if (store->segments == NULL) {
+        free(ids);
+        return -2;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (segment_open(store, ids[i], 0,
+                         &store->segments[store->segment_count]) == 0) {
+            store->segment_count++;
+        }
+    }
+
+    free(ids);
+    return 0;
+}
+
+/**
+ * Resolves a slot to its record, NULL if the slot points outside the data
+ * written so far
+ */
+static RecordHeader* record_at(LogStore* store, const LogStoreSlot* slot,
+                               LogStoreSegment** segment) {
+    LogStoreSegment* found = segment_find(store, slot->segment);
+    if (found == NULL ||
+        slot->offset + sizeof(RecordHeader) > segment_header(found)->used) {
+        return NULL;
+    }
+
+    RecordHeader* header = (RecordHeader*)(found->base + slot->offset);
+    if (header->magic != LOG_STORE_RECORD_MAGIC ||
+        slot->offset + record_size(header->key_len, header->value_len) >
+            segment_header(found)->used) {
+        return NULL;
+    }
+
+    if (segment) {
+        *segment = found;
+    }
+    return header;
+}
+
+/**
+ * Writes a record at the end of the last segment, starting a new one if it
+ * does not fit. The segment header only counts the record once it is whole,
+ * so a crash mid-write leaves nothing behind.
+ */
+static int record_append(LogStore* store, const char* key, size_t key_len,
+                         const void* value, size_t value_len,
+                         time_t written_at, time_t expires_at,
+                         uint32_t* segment_id, uint32_t* offset) {
+    size_t size = record_size(key_len, value_len);
+    if (SEGMENT_DATA_START + size > store->segment_size) {
+        return -1;
+    }
+
+    LogStoreSegment* segment = &store->segments[store->segment_count - 1];
+    if (segment_header(segment)->used + size > segment->size) {
+        int result = segment_add(store);
+        if (result != 0) {
+            return result;
+        }
+        segment = &store->segments[store->segment_count - 1];
+    }
+
+    SegmentHeader* segment_head = segment_header(segment);
+    RecordHeader*  header = (RecordHeader*)(segment->base + segment_head->used);
+
+    header->key_len    = (uint32_t)key_len;
+    header->value_len  = (uint32_t)value_len;
+    header->written_at = (int64_t)written_at;
+    header->expires_at = (int64_t)expires_at;
+    memcpy(header + 1, key, key_len);
+    memcpy((uint8_t*)(header + 1) + key_len, value, value_len);
+    header->crc   = record_crc(header);
+    header->magic = LOG_STORE_RECORD_MAGIC;
+
+    *segment_id = segment->id;
+    *offset     = (uint32_t)segment_head->used;
+
+    segment_head->used += size;
+    segment->dirty      = 1;
+    return 0;
+}
+
+/**
+ * Maps index.map, rebuilding it from the segments when it is missing, was
+ * not closed cleanly or does not match this version
+ */
+static int index_open(LogStore* store) {
+    char path[LOG_STORE_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/index.map", store->dir);
+
+    int         fd = open(path, O_RDWR);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 &&
+        (size_t)st.st_size >= sizeof(LogStoreIndexHeader)) {
+        void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd, 0);
+        if (base != MAP_FAILED) {
+            LogStoreIndexHeader* header = base;
+            size_t               expected =
+                sizeof(LogStoreIndexHeader) +
+                header->capacity * sizeof(LogStoreSlot);
+
+            if (header->magic == LOG_STORE_INDEX_MAGIC &&
+                header->version == LOG_STORE_VERSION && header->clean &&
+                header->capacity > 0 &&
+                (header->capacity & (header->capacity - 1)) == 0 &&
+                expected == (size_t)st.st_size) {
+                store->index_fd   = fd;
+                store->index      = header;
+                store->slots      = (LogStoreSlot*)(header + 1);
+                store->index_size = expected;
+
+                // Cleared until dispose, a crash then forces a rebuild
+                header->clean = 0;
+                return 0;
+            }
+            munmap(base, (size_t)st.st_size);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    return index_rebuild(store);
+}
+
+/**
+ * Builds an empty index of capacity slots in a temporary file and renames it
+ * over index.map. The old mapping is kept for the caller to copy from.
+ */
+static int index_create(LogStore* store, uint64_t capacity) {
+    char tmp_path[LOG_STORE_PATH_MAX];
+    char path[LOG_STORE_PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s/index.tmp", store->dir);
+    snprintf(path, sizeof(path), "%s/index.map", store->dir);
+
+    size_t size =
+        sizeof(LogStoreIndexHeader) + capacity * sizeof(LogStoreSlot);
+
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("[STORE] Failed to create %s\n", tmp_path);
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    LogStoreIndexHeader* header = base;
+    header->magic               = LOG_STORE_INDEX_MAGIC;
+    header->version             = LOG_STORE_VERSION;
+    header->clean               = 0;
+    header->capacity            = capacity;
+    header->count               = 0;
+
+    if (rename(tmp_path, path) != 0) {
+        munmap(base, size);
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    LogStoreIndexHeader* old_index = store->index;
+    LogStoreSlot*        old_slots = store->slots;
+    size_t               old_size  = store->index_size;
+    int                  old_fd    = store->index_fd;
+
+    store->index        = header;
+    store->slots        = (LogStoreSlot*)(header + 1);
+    store->index_size   = size;
+    store->index_fd     = fd;
+    store->sweep_cursor = 0;
+
+    // Move the entries over from the old table, if any
+    if (old_index) {
+        for (uint64_t i = 0; i < old_index->capacity; i++) {
+            const LogStoreSlot* slot = &old_slots[i];
+            if (slot->hash == 0) {
+                continue;
+            }
+
+            uint64_t mask = capacity - 1;
+            uint64_t pos  = slot->hash & mask;
+            while (store->slots[pos].hash != 0) {
+                pos = (pos + 1) & mask;
+            }
+            store->slots[pos] = *slot;
+            header->count++;
+        }
+        munmap(old_index, old_size);
+        close(old_fd);
+    }
+
+    return 0;
+}
+
+/**
+ * Replays every record in every segment, later records win
+ */
+static int index_rebuild(LogStore* store) {
+    int result = index_create(store, LOG_STORE_INITIAL_INDEX_CAPACITY);
+    if (result != 0) {
+        return result;
+    }
+
+    size_t records = 0;
+    for (size_t i = 0; i < store->segment_count; i++) {
+        LogStoreSegment* segment = &store->segments[i];
+        size_t           used    = segment_header(segment)->used;
+
+        for (size_t offset = SEGMENT_DATA_START; offset < used;) {
+            RecordHeader* header = (RecordHeader*)(segment->base + offset);
+            size_t        size   = offset + sizeof(RecordHeader) <= used
+                                       ? record_size(header->key_len,
+                                                     header->value_len)
+                                       : 0;
+            if (size == 0 || offset + size > used ||
+                header->magic != LOG_STORE_RECORD_MAGIC ||
+                record_crc(header) != header->crc) {
+                printf("[STORE] Segment %u damaged at %zu, skipping rest\n",
+                       segment->id, offset);
+
+                // New records overwrite a torn tail, behind it the next
+                // rebuild would skip them as well
+                if (i + 1 == store->segment_count) {
+                    segment_header(segment)->used = offset;
+                }
+                break;
+            }
+
+            result = index_set(store, record_key(header), header->key_len,
+                               segment->id, (uint32_t)offset,
+                               (time_t)header->expires_at);
+            if (result != 0) {
+                return result;
+            }
+
+            records++;
+            offset += size;
+        }
+    }
+
+    // Expired records may have been dropped from the old index already, and
+    // an expired newest record also hides the older ones it replaced
+    time_t   now      = time(NULL);
+    uint64_t capacity = store->index->capacity;
+    for (uint64_t i = 0; i < capacity;) {
+        LogStoreSlot* slot = &store->slots[i];
+        if (slot->hash != 0 && slot->expires_at <= (int64_t)now) {
+            index_remove(store, slot); // Something else moved into slot i
+        } else {
+            i++;
+        }
+    }
+
+    printf("[STORE] Rebuilt index from %zu records, %zu live\n", records,
+           log_store_count(store));
+    return 0;
+}
+
+static LogStoreSlot* index_lookup(LogStore* store, uint64_t hash,
+                                  const char* key, size_t len) {
+    uint64_t mask = store->index->capacity - 1;
+    for (uint64_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        LogStoreSlot* slot = &store->slots[pos];
+        if (slot->hash == 0) {
+            return NULL;
+        }
+        if (slot->hash != hash) {
+            continue;
+        }
+
+        // Full key check, two keys may share a hash
+        RecordHeader* header = record_at(store, slot, NULL);
+        if (header && header->key_len == len &&
+            memcmp(record_key(header), key, len) == 0) {
+            return slot;
+        }
+    }
+}
+
+/**
+ * Points key at a record, replacing the slot of an older one. The replaced
+ * record no longer counts as live.
+ */
+static int index_set(LogStore* store, const char* key, size_t len,
+                     uint32_t segment_id, uint32_t offset, time_t expires_at) {
+    uint64_t hash = key_hash(key, len);
+
+    LogStoreSlot* slot = index_lookup(store, hash, key, len);
+    if (slot) {
+        LogStoreSegment* old_segment = NULL;
+        RecordHeader*    old         = record_at(store, slot, &old_segment);
+        if (old) {
+            segment_release(old_segment, old);
+        }
+    } else {
+        if ((store->index->count + 1) * 4 > store->index->capacity * 3) {
+            int result = index_create(store, store->index->capacity * 2);
+            if (result != 0) {
+                return result;
+            }
+            bloom_rebuild(store);
+        }
+
+        uint64_t mask = store->index->capacity - 1;
+        uint64_t pos  = hash & mask;
+        while (store->slots[pos].hash != 0) {
+            pos = (pos + 1) & mask;
+        }
+        slot       = &store->slots[pos];
+        slot->hash = hash;
+        store->index->count++;
+        if (store->bloom.blocks) {
+            bloom_filter_add(&store->bloom, hash);
+        }
+    }
+
+    slot->segment    = segment_id;
+    slot->offset     = offset;
+    slot->expires_at = (int64_t)expires_at;
+    return 0;
+}
+
+/**
+ * Backward-shift deletion, keeps linear probing chains intact without
+ * tombstones
+ */
+static void index_remove(LogStore* store, LogStoreSlot* slot) {
+    uint64_t mask = store->index->capacity - 1;
+    uint64_t hole = (uint64_t)(slot - store->slots);
+
+    for (uint64_t pos = (hole + 1) & mask; store->slots[pos].hash != 0;
+         pos          = (pos + 1) & mask) {
+        uint64_t home = store->slots[pos].hash & mask;
+
+        // Move the entry back if the hole lies between its home and it
+        if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+            store->slots[hole] = store->slots[pos];
+            hole               = pos;
+        }
+    }
+
+    memset(&store->slots[hole], 0, sizeof(LogStoreSlot));
+    store->index->count--;
+    store->bloom_removed++;
+}
+
+/**
+ * Sums up the live bytes of every segment and drops slots pointing at
+ * records that no longer exist
+ */
+static void index_count_live(LogStore* store) {
+    for (size_t i = 0; i < store->segment_count; i++) {
+        store->segments[i].live = 0;
+    }
+
+    for (uint64_t i = 0; i < store->index->capacity;) {
+        LogStoreSlot* slot = &store->slots[i];
+        if (slot->hash == 0) {
+            i++;
+            continue;
+        }
+
+        LogStoreSegment* segment = NULL;
+        RecordHeader*    header  = record_at(store, slot, &segment);
+        if (header == NULL) {
+            index_remove(store, slot); // Something else moved into slot i
+            continue;
+        }
+
+        segment->live += record_size(header->key_len, header->value_len);
+        i++;
+    }
+}
+
+/**
+ * Drops expired entries from a window of the index, so a full pass costs
+ * nothing noticeable on any single step
+ */
+static void index_sweep(LogStore* store, time_t now) {
+    uint64_t capacity = store->index->capacity;
+    uint64_t checked  = 0;
+
+    while (checked < LOG_STORE_SWEEP_SLOTS && checked < capacity) {
+        uint64_t      pos  = store->sweep_cursor % capacity;
+        LogStoreSlot* slot = &store->slots[pos];
+
+        if (slot->hash != 0 && slot->expires_at <= (int64_t)now) {
+            LogStoreSegment* segment = NULL;
+            RecordHeader*    header  = record_at(store, slot, &segment);
+            if (header) {
+                segment_release(segment, header);
+            }
+            index_remove(store, slot);
+            store->expired_records++;
+        } else {
+            store->sweep_cursor = (pos + 1) % capacity;
+        }
+        checked++;
+    }
+}
+
+/**
+ * Deletes the oldest segment along with every key still pointing into it
+ */
+static void evict_segment(LogStore* store) {
+    LogStoreSegment* segment = &store->segments[0];
+    size_t           used    = segment_header(segment)->used;
+    size_t           evicted = 0;
+
+    for (size_t offset = SEGMENT_DATA_START; offset < used;) {
+        RecordHeader* header = (RecordHeader*)(segment->base + offset);
+        if (header->magic != LOG_STORE_RECORD_MAGIC) {
+            break;
+        }
+
+        const char*   key  = record_key(header);
+        LogStoreSlot* slot = index_lookup(
+            store, key_hash(key, header->key_len), key, header->key_len);
+        if (slot && slot->segment == segment->id && slot->offset == offset) {
+            index_remove(store, slot);
+            evicted++;
+        }
+
+        offset += record_size(header->key_len, header->value_len);
+    }
+
+    printf("[STORE] Evicted segment %u over the size limit: %zu records\n",
+           segment->id, evicted);
+    store->evicted_records += evicted;
+    store->evicted_segments++;
+    segment_delete(store, segment->id);
+}
+
+/**
+ * Drops up to wanted keys in write order, resuming where the last call
+ * stopped. Their segments are reclaimed by compaction later. Returns the
+ * number of keys dropped.
+ */
+static int evict_records(LogStore* store, size_t wanted) {
+    LogStoreSegment* segment = segment_find(store, store->evict_segment);
+    size_t           offset  = store->evict_offset;
+    if (segment == NULL) {
+        segment = &store->segments[0];
+        offset  = SEGMENT_DATA_START;
+    }
+
+    size_t evicted = 0;
+    for (size_t checked = 0;
+         evicted < wanted && checked < LOG_STORE_EVICT_RECORDS; checked++) {
+        size_t        used   = segment_header(segment)->used;
+        RecordHeader* header = (RecordHeader*)(segment->base + offset);
+
+        if (offset >= used || header->magic != LOG_STORE_RECORD_MAGIC) {
+            // Everything up to the end of the store has been looked at
+            if (segment == &store->segments[store->segment_count - 1]) {
+                break;
+            }
+            segment++;
+            offset = SEGMENT_DATA_START;
+            continue;
+        }
+
+        const char*   key  = record_key(header);
+        LogStoreSlot* slot = index_lookup(
+            store, key_hash(key, header->key_len), key, header->key_len);
+        if (slot && slot->segment == segment->id && slot->offset == offset) {
+            segment_release(segment, header);
+            index_remove(store, slot);
+            evicted++;
+        }
+
+        offset += record_size(header->key_len, header->value_len);
+    }
+
+    store->evict_segment = segment->id;
+    store->evict_offset  = offset;
+
+    if (evicted > 0) {
+        printf("[STORE] Evicted %zu records over the key limit\n", evicted);
+        store->evicted_records += evicted;
+    }
+    return (int)evicted;
+}
+
+/**
+ * Builds the key filter afresh from the hashes kept in the index slots, no
+ * record is read. Sized for the index's capacity, so it is rebuilt whenever
+ * the index grows.
+ */
+static void bloom_rebuild(LogStore* store) {
+    bloom_filter_dispose(&store->bloom);
+    store->bloom_removed = 0;
+
+    // Without a filter every lookup goes to the index, still correct
+    if (bloom_filter_initiate(&store->bloom, store->index->capacity,
+                              LOG_STORE_BLOOM_BITS_PER_KEY) != 0) {
+        return;
+    }
+
+    for (uint64_t i = 0; i < store->index->capacity; i++) {
+        if (store->slots[i].hash != 0) {
+            bloom_filter_add(&store->bloom, store->slots[i].hash);
+        }
+    }
+}
+
+static int bloom_may_contain(const LogStore* store, uint64_t hash) {
+    return store->bloom.blocks == NULL ||
+           bloom_filter_may_contain(&store->bloom, hash);
+}
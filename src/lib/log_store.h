@@ -0,0 +1,183 @@
+/// Append-only key/value store on disk. Records go into fixed-size segment
+/// files, each mapped into memory, and are located through a hash index that
+/// is itself a mapped file. Reads return a pointer straight into the mapped
+/// segment, nothing is copied or parsed. Every record carries a CRC-32 so
+/// torn or corrupted records read as missing. Superseded and expired records
+/// are reclaimed by compaction, which copies what is still live out of the
+/// emptiest sealed segment and deletes the segment file. Optional limits on
+/// disk size and key count are enforced by evicting the oldest records first.
+/// A Bloom filter of the stored keys answers most lookups of absent keys
+/// without probing the index.
+///
+/// Files in the store directory:
+///   index.map            Hash index, rebuilt from the segments when it was
+///                        not closed cleanly
+///   segment-NNNNNNNN.log Segments, the highest id is the one appended to
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include "bloom_filter.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#ifndef LOG_STORE_DEFAULT_SEGMENT_SIZE
+#    define LOG_STORE_DEFAULT_SEGMENT_SIZE (8u << 20)
+#endif
+
+// Slots in a new index, doubled whenever it is three quarters full
+#ifndef LOG_STORE_INITIAL_INDEX_CAPACITY
+#    define LOG_STORE_INITIAL_INDEX_CAPACITY 1024
+#endif
+
+// Sealed segments with less live data than this percentage get compacted
+#ifndef LOG_STORE_COMPACT_LIVE_PERCENT
+#    define LOG_STORE_COMPACT_LIVE_PERCENT 50
+#endif
+
+// Index slots checked for expired records per compaction step
+#ifndef LOG_STORE_SWEEP_SLOTS
+#    define LOG_STORE_SWEEP_SLOTS 4096
+#endif
+
+// Key filter bits per index slot, rebuilt when a quarter of the keys it
+// holds were removed since or the index grew
+#ifndef LOG_STORE_BLOOM_BITS_PER_KEY
+#    define LOG_STORE_BLOOM_BITS_PER_KEY 10
+#endif
+
+// Records looked at per compaction step while over the key limit
+#ifndef LOG_STORE_EVICT_RECORDS
+#    define LOG_STORE_EVICT_RECORDS 4096
+#endif
+
+// Bytes log_store_resident asks for when not even a record's header is in
+// memory, enough for the header and a typical value
+#ifndef LOG_STORE_READ_AHEAD
+#    define LOG_STORE_READ_AHEAD 8192
+#endif
+
+typedef struct LogStoreIndexHeader LogStoreIndexHeader;
+typedef struct LogStoreSlot        LogStoreSlot;
+
+typedef struct {
+    uint32_t id;
+    int      fd;
+    uint8_t* base; // Whole file mapped, starts with the segment header
+    size_t   size;
+    size_t   live;  // Bytes of records the index still points at
+    int      dirty; // Appended to since log_store_take_dirty last saw it
+} LogStoreSegment;
+
+typedef struct {
+    char*  dir;
+    size_t segment_size;
+
+    int                  index_fd;
+    LogStoreIndexHeader* index; // Mapped index.map, slots follow the header
+    LogStoreSlot*        slots;
+    size_t               index_size;
+    size_t               sweep_cursor;
+
+    // Sorted by id, the last one is appended to
+    LogStoreSegment* segments;
+    size_t           segment_count;
+    uint32_t         next_segment_id;
+
+    // Limits, 0 for none, and where key eviction continues
+    size_t   max_bytes;
+    size_t   max_entries;
+    uint32_t evict_segment;
+    size_t   evict_offset;
+
+    uint64_t compacted_segments;
+    uint64_t expired_records;
+    uint64_t evicted_records;
+    uint64_t evicted_segments;
+
+    // Keys in the index, missing ones may only be reported present.
+    // log_store_get counts the misses it answered alone and the false
+    // positives it had to probe the index for.
+    BloomFilter bloom;
+    size_t      bloom_removed; // Keys removed since the filter was built
+    uint64_t    bloom_skipped;
+    uint64_t    bloom_false_positives;
+} LogStore;
+
+typedef struct {
+    const void* value; // Points into the mapped segment
+    size_t      value_len;
+    time_t      written_at;
+    time_t      expires_at;
+} LogStoreRecord;
+
+/* Called by log_store_scan for each key, return non-zero to stop the scan */
+typedef int (*LogStoreScanCallback)(const char* key, size_t key_len,
+                                    const LogStoreRecord* record,
+                                    void*                 context);
+
+/* Opens or creates the store in dir. segment_size 0 picks the default.
+ * Returns 0 on success, -1 on I/O errors and -2 on allocation failure */
+int log_store_initiate(LogStore* store, const char* dir, size_t segment_size);
+
+/* Finds the newest record for key. The value stays valid until the next
+ * log_store_compact_step or log_store_dispose. Returns 0 if found, -1 if
+ * missing or failing its checksum. */
+int log_store_get(LogStore* store, const char* key, LogStoreRecord* record);
+
+/* Same as log_store_get, but never changes the store: a record failing its
+ * checksum is reported missing and left for log_store_get to drop. Safe to
+ * call from several threads while nothing writes to the store. */
+int log_store_read(const LogStore* store, const char* key,
+                   LogStoreRecord* record);
+
+/* Tells whether reading key would fault pages in from disk, checking the
+ * mapped record with mincore without touching it. Returns 1 if the record is
+ * in memory or there is none and 0 if part of it is not: *fd is then a
+ * duplicate descriptor of its segment, for the caller to close, and *offset
+ * and *len the page-aligned range to read so a later log_store_get finds it
+ * in the page cache. Returns -1 on errors. */
+int log_store_resident(const LogStore* store, const char* key, int* fd,
+                       off_t* offset, size_t* len);
+
+/* Calls callback for every key in slice part of parts equal slices of the
+ * index, so several threads can scan one slice each. Records failing their
+ * checksum are skipped. Nothing may write to the store meanwhile. */
+void log_store_scan(const LogStore* store, size_t part, size_t parts,
+                    LogStoreScanCallback callback, void* context);
+
+/* Appends a record for key, replacing any older one. expires_at is when
+ * compaction may drop it. */
+int log_store_put(LogStore* store, const char* key, const void* value,
+                  size_t value_len, time_t expires_at);
+
+/* Caps the store at max_bytes of segment and index files and max_entries
+ * keys, 0 leaves either unlimited. Compaction steps enforce them, oldest
+ * records first: whole sealed segments while over max_bytes, single records
+ * while over max_entries. The segment being appended to is never deleted, so
+ * max_bytes should span several segments. */
+void log_store_set_limits(LogStore* store, size_t max_bytes,
+                          size_t max_entries);
+
+/* Rebuilds the key filter if it went stale, drops expired index entries,
+ * then evicts down to the limits or compacts at most one segment. Returns 1
+ * if anything was evicted or compacted, 0 if there was nothing to do and
+ * negative on error. */
+int log_store_compact_step(LogStore* store, time_t now);
+
+/* Hands out duplicates of the descriptors of segments appended to since the
+ * last call, at most max, for another thread to fdatasync and close. A
+ * duplicate stays valid even if compaction deletes its segment meanwhile.
+ * The index needs no syncing, it is rebuilt after a crash. Returns the
+ * number of descriptors stored in fds. */
+size_t log_store_take_dirty(LogStore* store, int* fds, size_t max);
+
+/* Number of keys and bytes of segment files on disk */
+size_t log_store_count(const LogStore* store);
+size_t log_store_disk_size(const LogStore* store);
+
+void log_store_dispose(LogStore* store);
+
+#endif // LOG_STORE_H
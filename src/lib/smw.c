@@ -9,77 +9,75 @@ Smw g_smw;
 
 int smw_init() {
     memset(&g_smw, 0, sizeof(g_smw));
-    g_smw.tasks = linked_list_create();
-    if (!g_smw.tasks) {
-        return -1;
-    }
+    intrusive_list_init(&g_smw.tasks);
+    intrusive_list_init(&g_smw.pool);
     return 0;
 }
 
 SmwTask* smw_create_task(void* context,
                          void (*callback)(void* context, uint64_t mon_time)) {
-    if (!g_smw.tasks) {
-        return NULL;
-    }
-
-    SmwTask* task = malloc(sizeof(SmwTask));
-    if (!task) {
-        return NULL;
+    SmwTask*  task = NULL;
+    ListHook* hook = intrusive_list_pop_front(&g_smw.pool);
+    if (hook) {
+        task = IntrusiveList_entry(hook, SmwTask, hook);
+    } else {
+        task = malloc(sizeof(SmwTask));
+        if (!task) {
+            return NULL;
+        }
     }
 
     task->context  = context;
     task->callback = callback;
 
-    if (linked_list_append(g_smw.tasks, task) != 0) {
-        free(task);
-        return NULL;
-    }
+    intrusive_list_append(&g_smw.tasks, &task->hook);
 
     return task;
 }
 
 void smw_destroy_task(SmwTask* task) {
-    if (!g_smw.tasks || !task) {
+    // A destroyed task has no callback and sits in the pool, removing it from
+    // the task list again would corrupt both
+    if (!task || !task->callback) {
         return;
     }
 
-    Node* node = g_smw.tasks->head;
-    while (node) {
-        Node* next = node->front;
-        if (node->item == task) {
-            linked_list_remove(g_smw.tasks, node, free);
-            break;
-        }
-        node = next;
+    // Tasks may destroy themselves or others from inside smw_work
+    if (g_smw.next == &task->hook) {
+        g_smw.next = task->hook.front;
     }
-}
 
-void smw_work(uint64_t mon_time) {
-    if (!g_smw.tasks) {
-        return;
+    intrusive_list_remove(&g_smw.tasks, &task->hook);
+
+    task->context  = NULL;
+    task->callback = NULL;
+    if (g_smw.pool.size < SMW_TASK_POOL_MAX) {
+        intrusive_list_append(&g_smw.pool, &task->hook);
+    } else {
+        free(task);
     }
+}
 
-    Node* node = g_smw.tasks->head;
-    while (node) {
-        Node*    next = node->front; // Save next node before callback
-        SmwTask* task = (SmwTask*)node->item;
-        if (task && task->callback) {
+void smw_work(uint64_t mon_time) {
+    g_smw.next = g_smw.tasks.head;
+    while (g_smw.next) {
+        SmwTask* task = IntrusiveList_entry(g_smw.next, SmwTask, hook);
+        g_smw.next    = task->hook.front;
+        if (task->callback) {
             task->callback(task->context, mon_time);
         }
-        node = next;
     }
 }
 
-int smw_get_task_count() {
-    if (!g_smw.tasks) {
-        return 0;
-    }
-    return (int)g_smw.tasks->size;
-}
+int smw_get_task_count() { return (int)g_smw.tasks.size; }
 
 void smw_dispose() {
-    if (!g_smw.tasks) {
-        return;
+    ListHook* hook = NULL;
+    while ((hook = intrusive_list_pop_front(&g_smw.tasks)) != NULL) {
+        free(IntrusiveList_entry(hook, SmwTask, hook));
+    }
+    while ((hook = intrusive_list_pop_front(&g_smw.pool)) != NULL) {
+        free(IntrusiveList_entry(hook, SmwTask, hook));
     }
-    linked_list_dispose(&g_smw.tasks, free);
+    g_smw.next = NULL;
 }
@@ -9,14 +9,22 @@
 #    define SMW_MAX_TASKS 16
 #endif
 
+// Destroyed tasks kept for reuse, connections create one task each
+#ifndef SMW_TASK_POOL_MAX
+#    define SMW_TASK_POOL_MAX 256
+#endif
+
 typedef struct {
-    void* context;
+    ListHook hook; // Embedded so smw_work walks tasks without extra loads
+    void*    context;
     void (*callback)(void* context, uint64_t mon_time);
 
 } SmwTask;
 
 typedef struct {
-    LinkedList* tasks;
+    IntrusiveList tasks;
+    IntrusiveList pool; // Destroyed tasks kept for reuse
+    ListHook*     next; // Next task to run, moved on if it gets destroyed
 } Smw;
 
 extern Smw g_smw;
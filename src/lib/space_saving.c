@@ -0,0 +1,121 @@
+#include "space_saving.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//-----------------Internal Functions-----------------
+
+static int counter_compare(const void* a, const void* b);
+
+//----------------------------------------------------
+
+int space_saving_initiate(SpaceSaving* sketch, size_t capacity) {
+    sketch->counters = calloc(capacity, sizeof(SpaceSavingCounter));
+    if (sketch->counters == NULL) {
+        return -2;
+    }
+
+    sketch->capacity = capacity;
+    sketch->size     = 0;
+    sketch->total    = 0;
+
+    return 0;
+}
+
+void space_saving_increment(SpaceSaving* sketch, uint64_t key) {
+    if (sketch->capacity == 0) {
+        return;
+    }
+
+    sketch->total++;
+
+    // Capacities stay small (tens of keys), a scan beats keeping a heap and
+    // an index in sync
+    SpaceSavingCounter* min = NULL;
+    for (size_t i = 0; i < sketch->size; i++) {
+        SpaceSavingCounter* counter = &sketch->counters[i];
+        if (counter->key == key) {
+            counter->count++;
+            return;
+        }
+        if (min == NULL || counter->count < min->count) {
+            min = counter;
+        }
+    }
+
+    SpaceSavingCounter* counter;
+    if (sketch->size < sketch->capacity) {
+        counter        = &sketch->counters[sketch->size++];
+        counter->count = 1;
+        counter->error = 0;
+    } else {
+        counter        = min;
+        counter->error = min->count;
+        counter->count = min->count + 1;
+    }
+
+    counter->key = key;
+}
+
+size_t space_saving_top(const SpaceSaving* sketch, SpaceSavingCounter* out,
+                        size_t max) {
+    size_t count = sketch->size < max ? sketch->size : max;
+    if (count == 0) {
+        return 0;
+    }
+
+    if (count == sketch->size) {
+        memcpy(out, sketch->counters, count * sizeof(SpaceSavingCounter));
+        qsort(out, count, sizeof(SpaceSavingCounter), counter_compare);
+        return count;
+    }
+
+    SpaceSavingCounter* sorted =
+        malloc(sketch->size * sizeof(SpaceSavingCounter));
+    if (sorted == NULL) {
+        return 0;
+    }
+
+    memcpy(sorted, sketch->counters, sketch->size * sizeof(SpaceSavingCounter));
+    qsort(sorted, sketch->size, sizeof(SpaceSavingCounter), counter_compare);
+    memcpy(out, sorted, count * sizeof(SpaceSavingCounter));
+    free(sorted);
+
+    return count;
+}
+
+void space_saving_decay(SpaceSaving* sketch) {
+    size_t kept = 0;
+    for (size_t i = 0; i < sketch->size; i++) {
+        SpaceSavingCounter counter = sketch->counters[i];
+        counter.count /= 2;
+        counter.error /= 2;
+
+        // Keys that went quiet free their counter
+        if (counter.count > 0) {
+            sketch->counters[kept++] = counter;
+        }
+    }
+
+    sketch->size = kept;
+    sketch->total /= 2;
+}
+
+void space_saving_dispose(SpaceSaving* sketch) {
+    free(sketch->counters);
+    sketch->counters = NULL;
+    sketch->capacity = 0;
+    sketch->size     = 0;
+}
+
+/* ============= Internal Functions Implementation ============= */
+
+static int counter_compare(const void* a, const void* b) {
+    const SpaceSavingCounter* left  = a;
+    const SpaceSavingCounter* right = b;
+
+    if (left->count != right->count) {
+        return left->count < right->count ? 1 : -1;
+    }
+    return 0;
+}
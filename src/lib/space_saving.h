@@ -0,0 +1,38 @@
+/// Space-Saving heavy-hitter sketch. Tracks the most frequent keys of a
+/// stream in a fixed number of counters: a key without a counter takes over
+/// the smallest one, inheriting its count as the error bound. Any key seen
+/// more often than total/capacity is guaranteed to hold a counter.
+#ifndef SPACE_SAVING_H
+#define SPACE_SAVING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t key;
+    uint64_t count; // Upper bound of the key's true count
+    uint64_t error; // count - error is a lower bound
+} SpaceSavingCounter;
+
+typedef struct {
+    SpaceSavingCounter* counters;
+    size_t              capacity;
+    size_t              size;
+    uint64_t            total; // Increments since the last decay
+} SpaceSaving;
+
+int space_saving_initiate(SpaceSaving* sketch, size_t capacity);
+
+/* Counts one occurrence of key, any 64-bit identifier of what is counted */
+void space_saving_increment(SpaceSaving* sketch, uint64_t key);
+
+/* Copies up to max counters, highest count first, returns how many */
+size_t space_saving_top(const SpaceSaving* sketch, SpaceSavingCounter* out,
+                        size_t max);
+
+/* Halves every count so the sketch follows recent traffic */
+void space_saving_decay(SpaceSaving* sketch);
+
+void space_saving_dispose(SpaceSaving* sketch);
+
+#endif // SPACE_SAVING_H
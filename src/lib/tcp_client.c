@@ -84,8 +84,20 @@ int tcp_client_write(TCPClient* c, const uint8_t* buf, size_t len) {
     return send(c->fd, buf, len, MSG_NOSIGNAL);
 }
 
+ssize_t tcp_client_writev(TCPClient* c, const struct iovec* iov, int iovcnt) {
+    // sendmsg instead of writev so a closed peer can't raise SIGPIPE
+    struct msghdr msg = {0};
+    msg.msg_iov       = (struct iovec*)iov;
+    msg.msg_iovlen    = iovcnt;
+
+    return sendmsg(c->fd, &msg, MSG_NOSIGNAL);
+}
+
 int tcp_client_read(TCPClient* c, uint8_t* buf, size_t len) {
     int n = recv(c->fd, buf, len, 0); // or MSG_DONTWAIT
+    if (n == 0 && len > 0) {
+        return TCP_CLIENT_CLOSED; // nothing more will come
+    }
     if (n < 0) {
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
             return 0; // no data available right now
@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 typedef struct {
@@ -18,9 +19,18 @@ int tcp_client_initiate(TCPClient* c, int fd);
 
 int tcp_client_connect(TCPClient* c, const char* host, const char* port);
 
+// tcp_client_read result once the peer has closed its end
+#define TCP_CLIENT_CLOSED -2
+
 int tcp_client_write(TCPClient* c, const uint8_t* buf, size_t len);
+
+/* Returns the bytes read, 0 if none are available yet, TCP_CLIENT_CLOSED
+ * if the peer closed the connection and -1 on error */
 int tcp_client_read(TCPClient* c, uint8_t* buf, size_t len);
 
+/* Gathers iovcnt buffers into one send, same semantics as writev */
+ssize_t tcp_client_writev(TCPClient* c, const struct iovec* iov, int iovcnt);
+
 void tcp_client_disconnect(TCPClient* c);
 
 void tcp_client_dispose(TCPClient* c);
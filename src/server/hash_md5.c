@@ -8,7 +8,6 @@
 
 #include "hash_md5.h"
 
-#include <stdio.h>
 #include <string.h>
 
 /* ========================================================================
@@ -39,6 +38,82 @@ typedef struct {
     (a) = (((a) << (s)) | (((a) & 0xffffffff) >> (32 - (s))));                 \
     (a) += (b);
 
+/* The 64 steps on the working state a, b, c, d. X1(n) reads word n of the
+ * block for the first time, X(n) after that. Shared by the scalar body and
+ * the multi-lane one, where the same operators act on vectors. */
+#define MD5_ROUNDS(a, b, c, d, X1, X)                                          \
+    /* Round 1 */                                                              \
+    STEP(F, a, b, c, d, X1(0), 0xd76aa478, 7)                                  \
+    STEP(F, d, a, b, c, X1(1), 0xe8c7b756, 12)                                 \
+    STEP(F, c, d, a, b, X1(2), 0x242070db, 17)                                 \
+    STEP(F, b, c, d, a, X1(3), 0xc1bdceee, 22)                                 \
+    STEP(F, a, b, c, d, X1(4), 0xf57c0faf, 7)                                  \
+    STEP(F, d, a, b, c, X1(5), 0x4787c62a, 12)                                 \
+    STEP(F, c, d, a, b, X1(6), 0xa8304613, 17)                                 \
+    STEP(F, b, c, d, a, X1(7), 0xfd469501, 22)                                 \
+    STEP(F, a, b, c, d, X1(8), 0x698098d8, 7)                                  \
+    STEP(F, d, a, b, c, X1(9), 0x8b44f7af, 12)                                 \
+    STEP(F, c, d, a, b, X1(10), 0xffff5bb1, 17)                                \
+    STEP(F, b, c, d, a, X1(11), 0x895cd7be, 22)                                \
+    STEP(F, a, b, c, d, X1(12), 0x6b901122, 7)                                 \
+    STEP(F, d, a, b, c, X1(13), 0xfd987193, 12)                                \
+    STEP(F, c, d, a, b, X1(14), 0xa679438e, 17)                                \
+    STEP(F, b, c, d, a, X1(15), 0x49b40821, 22)                                \
+                                                                               \
+    /* Round 2 */                                                              \
+    STEP(G, a, b, c, d, X(1), 0xf61e2562, 5)                                   \
+    STEP(G, d, a, b, c, X(6), 0xc040b340, 9)                                   \
+    STEP(G, c, d, a, b, X(11), 0x265e5a51, 14)                                 \
+    STEP(G, b, c, d, a, X(0), 0xe9b6c7aa, 20)                                  \
+    STEP(G, a, b, c, d, X(5), 0xd62f105d, 5)                                   \
+    STEP(G, d, a, b, c, X(10), 0x02441453, 9)                                  \
+    STEP(G, c, d, a, b, X(15), 0xd8a1e681, 14)                                 \
+    STEP(G, b, c, d, a, X(4), 0xe7d3fbc8, 20)                                  \
+    STEP(G, a, b, c, d, X(9), 0x21e1cde6, 5)                                   \
+    STEP(G, d, a, b, c, X(14), 0xc33707d6, 9)                                  \
+    STEP(G, c, d, a, b, X(3), 0xf4d50d87, 14)                                  \
+    STEP(G, b, c, d, a, X(8), 0x455a14ed, 20)                                  \
+    STEP(G, a, b, c, d, X(13), 0xa9e3e905, 5)                                  \
+    STEP(G, d, a, b, c, X(2), 0xfcefa3f8, 9)                                   \
+    STEP(G, c, d, a, b, X(7), 0x676f02d9, 14)                                  \
+    STEP(G, b, c, d, a, X(12), 0x8d2a4c8a, 20)                                 \
+                                                                               \
+    /* Round 3 */                                                              \
+    STEP(H, a, b, c, d, X(5), 0xfffa3942, 4)                                   \
+    STEP(H2, d, a, b, c, X(8), 0x8771f681, 11)                                 \
+    STEP(H, c, d, a, b, X(11), 0x6d9d6122, 16)                                 \
+    STEP(H2, b, c, d, a, X(14), 0xfde5380c, 23)                                \
+    STEP(H, a, b, c, d, X(1), 0xa4beea44, 4)                                   \
+    STEP(H2, d, a, b, c, X(4), 0x4bdecfa9, 11)                                 \
+    STEP(H, c, d, a, b, X(7), 0xf6bb4b60, 16)                                  \
+    STEP(H2, b, c, d, a, X(10), 0xbebfbc70, 23)                                \
+    STEP(H, a, b, c, d, X(13), 0x289b7ec6, 4)                                  \
+    STEP(H2, d, a, b, c, X(0), 0xeaa127fa, 11)                                 \
+    STEP(H, c, d, a, b, X(3), 0xd4ef3085, 16)                                  \
+    STEP(H2, b, c, d, a, X(6), 0x04881d05, 23)                                 \
+    STEP(H, a, b, c, d, X(9), 0xd9d4d039, 4)                                   \
+    STEP(H2, d, a, b, c, X(12), 0xe6db99e5, 11)                                \
+    STEP(H, c, d, a, b, X(15), 0x1fa27cf8, 16)                                 \
+    STEP(H2, b, c, d, a, X(2), 0xc4ac5665, 23)                                 \
+                                                                               \
+    /* Round 4 */                                                              \
+    STEP(I, a, b, c, d, X(0), 0xf4292244, 6)                                   \
+    STEP(I, d, a, b, c, X(7), 0x432aff97, 10)                                  \
+    STEP(I, c, d, a, b, X(14), 0xab9423a7, 15)                                 \
+    STEP(I, b, c, d, a, X(5), 0xfc93a039, 21)                                  \
+    STEP(I, a, b, c, d, X(12), 0x655b59c3, 6)                                  \
+    STEP(I, d, a, b, c, X(3), 0x8f0ccc92, 10)                                  \
+    STEP(I, c, d, a, b, X(10), 0xffeff47d, 15)                                 \
+    STEP(I, b, c, d, a, X(1), 0x85845dd1, 21)                                  \
+    STEP(I, a, b, c, d, X(8), 0x6fa87e4f, 6)                                   \
+    STEP(I, d, a, b, c, X(15), 0xfe2ce6e0, 10)                                 \
+    STEP(I, c, d, a, b, X(6), 0xa3014314, 15)                                  \
+    STEP(I, b, c, d, a, X(13), 0x4e0811a1, 21)                                 \
+    STEP(I, a, b, c, d, X(4), 0xf7537e82, 6)                                   \
+    STEP(I, d, a, b, c, X(11), 0xbd3af235, 10)                                 \
+    STEP(I, c, d, a, b, X(2), 0x2ad7d2bb, 15)                                  \
+    STEP(I, b, c, d, a, X(9), 0xeb86d391, 21)
+
 /* Platform-specific optimizations for reading data */
 #if defined(__i386__) || defined(__x86_64__) || defined(__vax__)
 #    define SET(n) (*(MD5_u32plus*)&ptr[(n) * 4])
@@ -71,77 +146,7 @@ static const void* body(MD5_CTX* ctx, const void* data, unsigned long size) {
         saved_c = c;
         saved_d = d;
 
-        /* Round 1 */
-        STEP(F, a, b, c, d, SET(0), 0xd76aa478, 7)
-        STEP(F, d, a, b, c, SET(1), 0xe8c7b756, 12)
-        STEP(F, c, d, a, b, SET(2), 0x242070db, 17)
-        STEP(F, b, c, d, a, SET(3), 0xc1bdceee, 22)
-        STEP(F, a, b, c, d, SET(4), 0xf57c0faf, 7)
-        STEP(F, d, a, b, c, SET(5), 0x4787c62a, 12)
-        STEP(F, c, d, a, b, SET(6), 0xa8304613, 17)
-        STEP(F, b, c, d, a, SET(7), 0xfd469501, 22)
-        STEP(F, a, b, c, d, SET(8), 0x698098d8, 7)
-        STEP(F, d, a, b, c, SET(9), 0x8b44f7af, 12)
-        STEP(F, c, d, a, b, SET(10), 0xffff5bb1, 17)
-        STEP(F, b, c, d, a, SET(11), 0x895cd7be, 22)
-        STEP(F, a, b, c, d, SET(12), 0x6b901122, 7)
-        STEP(F, d, a, b, c, SET(13), 0xfd987193, 12)
-        STEP(F, c, d, a, b, SET(14), 0xa679438e, 17)
-        STEP(F, b, c, d, a, SET(15), 0x49b40821, 22)
-
-        /* Round 2 */
-        STEP(G, a, b, c, d, GET(1), 0xf61e2562, 5)
-        STEP(G, d, a, b, c, GET(6), 0xc040b340, 9)
-        STEP(G, c, d, a, b, GET(11), 0x265e5a51, 14)
-        STEP(G, b, c, d, a, GET(0), 0xe9b6c7aa, 20)
-        STEP(G, a, b, c, d, GET(5), 0xd62f105d, 5)
-        STEP(G, d, a, b, c, GET(10), 0x02441453, 9)
-        STEP(G, c, d, a, b, GET(15), 0xd8a1e681, 14)
-        STEP(G, b, c, d, a, GET(4), 0xe7d3fbc8, 20)
-        STEP(G, a, b, c, d, GET(9), 0x21e1cde6, 5)
-        STEP(G, d, a, b, c, GET(14), 0xc33707d6, 9)
-        STEP(G, c, d, a, b, GET(3), 0xf4d50d87, 14)
-        STEP(G, b, c, d, a, GET(8), 0x455a14ed, 20)
-        STEP(G, a, b, c, d, GET(13), 0xa9e3e905, 5)
-        STEP(G, d, a, b, c, GET(2), 0xfcefa3f8, 9)
-        STEP(G, c, d, a, b, GET(7), 0x676f02d9, 14)
-        STEP(G, b, c, d, a, GET(12), 0x8d2a4c8a, 20)
-
-        /* Round 3 */
-        STEP(H, a, b, c, d, GET(5), 0xfffa3942, 4)
-        STEP(H2, d, a, b, c, GET(8), 0x8771f681, 11)
-        STEP(H, c, d, a, b, GET(11), 0x6d9d6122, 16)
-        STEP(H2, b, c, d, a, GET(14), 0xfde5380c, 23)
-        STEP(H, a, b, c, d, GET(1), 0xa4beea44, 4)
-        STEP(H2, d, a, b, c, GET(4), 0x4bdecfa9, 11)
-        STEP(H, c, d, a, b, GET(7), 0xf6bb4b60, 16)
-        STEP(H2, b, c, d, a, GET(10), 0xbebfbc70, 23)
-        STEP(H, a, b, c, d, GET(13), 0x289b7ec6, 4)
-        STEP(H2, d, a, b, c, GET(0), 0xeaa127fa, 11)
-        STEP(H, c, d, a, b, GET(3), 0xd4ef3085, 16)
-        STEP(H2, b, c, d, a, GET(6), 0x04881d05, 23)
-        STEP(H, a, b, c, d, GET(9), 0xd9d4d039, 4)
-        STEP(H2, d, a, b, c, GET(12), 0xe6db99e5, 11)
-        STEP(H, c, d, a, b, GET(15), 0x1fa27cf8, 16)
-        STEP(H2, b, c, d, a, GET(2), 0xc4ac5665, 23)
-
-        /* Round 4 */
-        STEP(I, a, b, c, d, GET(0), 0xf4292244, 6)
-        STEP(I, d, a, b, c, GET(7), 0x432aff97, 10)
-        STEP(I, c, d, a, b, GET(14), 0xab9423a7, 15)
-        STEP(I, b, c, d, a, GET(5), 0xfc93a039, 21)
-        STEP(I, a, b, c, d, GET(12), 0x655b59c3, 6)
-        STEP(I, d, a, b, c, GET(3), 0x8f0ccc92, 10)
-        STEP(I, c, d, a, b, GET(10), 0xffeff47d, 15)
-        STEP(I, b, c, d, a, GET(1), 0x85845dd1, 21)
-        STEP(I, a, b, c, d, GET(8), 0x6fa87e4f, 6)
-        STEP(I, d, a, b, c, GET(15), 0xfe2ce6e0, 10)
-        STEP(I, c, d, a, b, GET(6), 0xa3014314, 15)
-        STEP(I, b, c, d, a, GET(13), 0x4e0811a1, 21)
-        STEP(I, a, b, c, d, GET(4), 0xf7537e82, 6)
-        STEP(I, d, a, b, c, GET(11), 0xbd3af235, 10)
-        STEP(I, c, d, a, b, GET(2), 0x2ad7d2bb, 15)
-        STEP(I, b, c, d, a, GET(9), 0xeb86d391, 21)
+        MD5_ROUNDS(a, b, c, d, SET, GET)
 
         a += saved_a;
         b += saved_b;
@@ -252,6 +257,212 @@ static void MD5_Final(unsigned char* result, MD5_CTX* ctx) {
     memset(ctx, 0, sizeof(*ctx));
 }
 
+/* ========================================================================
+ * MULTI-LANE IMPLEMENTATION
+ *
+ * Hashes several independent messages at once, one per lane of a vector
+ * register: 4 lanes with SSE2, 8 with AVX2, picked at run time. Each lane
+ * walks its own message block by block and takes the next message as soon
+ * as it is done, so messages of different lengths keep every lane busy.
+ * ======================================================================== */
+
+#define MD5_MAX_LANES 8
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) &&         \
+    !defined(HASH_MD5_NO_SIMD)
+#    define MD5_LANES_X86 1
+#endif
+
+/* Takes state[r * lanes + lane] of 4 words and words[n * lanes + lane] of
+ * 16 words, updating the state of every lane with one block */
+typedef void (*MD5_LanesCompress)(uint32_t* state, const uint32_t* words);
+
+typedef struct {
+    const unsigned char* next;    /* Next full block of the message */
+    size_t               full;    /* Full blocks left at next */
+    const unsigned char* pad;     /* Next block of tail */
+    size_t               padded;  /* Blocks left at pad after those */
+    size_t               message; /* Index of the message, SIZE_MAX if idle */
+    unsigned char        tail[128]; /* Last bytes, padding and length */
+} MD5_Lane;
+
+#ifdef MD5_LANES_X86
+
+typedef uint32_t MD5_Vec4 __attribute__((vector_size(16)));
+typedef uint32_t MD5_Vec8 __attribute__((vector_size(32)));
+
+#    define LANE_WORD(n) (w[(n)])
+
+/* Defines a compress function running the rounds on vector type vec */
+#    define MD5_LANES_COMPRESS(name, vec, isa)                                 \
+        __attribute__((target(isa))) static void name(uint32_t*       state,  \
+                                                      const uint32_t* words) { \
+            vec a, b, c, d, w[16];                                             \
+            memcpy(&a, state, sizeof(vec));                                    \
+            memcpy(&b, state + sizeof(vec) / 4, sizeof(vec));                  \
+            memcpy(&c, state + sizeof(vec) / 2, sizeof(vec));                  \
+            memcpy(&d, state + sizeof(vec) * 3 / 4, sizeof(vec));              \
+            memcpy(w, words, sizeof(w));                                       \
+                                                                               \
+            vec saved_a = a, saved_b = b, saved_c = c, saved_d = d;            \
+            MD5_ROUNDS(a, b, c, d, LANE_WORD, LANE_WORD)                       \
+            a += saved_a;                                                      \
+            b += saved_b;                                                      \
+            c += saved_c;                                                      \
+            d += saved_d;                                                      \
+                                                                               \
+            memcpy(state, &a, sizeof(vec));                                    \
+            memcpy(state + sizeof(vec) / 4, &b, sizeof(vec));                  \
+            memcpy(state + sizeof(vec) / 2, &c, sizeof(vec));                  \
+            memcpy(state + sizeof(vec) * 3 / 4, &d, sizeof(vec));              \
+        }
+
+MD5_LANES_COMPRESS(md5_compress_sse2, MD5_Vec4, "sse2")
+MD5_LANES_COMPRESS(md5_compress_avx2, MD5_Vec8, "avx2")
+
+#endif /* MD5_LANES_X86 */
+
+/* Set by hash_md5_many_set_backend */
+static HashMd5ManyBackend g_many_backend = HASH_MD5_MANY_AUTO;
+
+static int md5_many_supported(HashMd5ManyBackend backend) {
+    switch (backend) {
+    case HASH_MD5_MANY_AUTO:
+    case HASH_MD5_MANY_SCALAR:
+        return 1;
+#ifdef MD5_LANES_X86
+    case HASH_MD5_MANY_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case HASH_MD5_MANY_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return 0;
+    }
+}
+
+static HashMd5ManyBackend md5_many_resolve(void) {
+    if (g_many_backend != HASH_MD5_MANY_AUTO) {
+        return g_many_backend;
+    }
+    if (md5_many_supported(HASH_MD5_MANY_AVX2)) {
+        return HASH_MD5_MANY_AVX2;
+    }
+    if (md5_many_supported(HASH_MD5_MANY_SSE2)) {
+        return HASH_MD5_MANY_SSE2;
+    }
+    return HASH_MD5_MANY_SCALAR;
+}
+
+#ifdef MD5_LANES_X86
+
+static uint32_t md5_load_le32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+/* Puts message into lane with the initial state */
+static void md5_lane_start(MD5_Lane* lane, uint32_t* state, size_t lanes,
+                           size_t index, const unsigned char* data,
+                           size_t size, size_t message) {
+    size_t rest = size % 64;
+
+    lane->next    = data;
+    lane->full    = size / 64;
+    lane->pad     = lane->tail;
+    lane->padded  = rest < 56 ? 1 : 2;
+    lane->message = message;
+
+    /* Same padding as MD5_Final */
+    memcpy(lane->tail, data + (size - rest), rest);
+    lane->tail[rest] = 0x80;
+    memset(&lane->tail[rest + 1], 0, lane->padded * 64 - rest - 1 - 8);
+
+    unsigned char* length = &lane->tail[lane->padded * 64 - 8];
+    uint64_t       bits   = (uint64_t)size << 3;
+    for (int i = 0; i < 8; i++) {
+        length[i] = (unsigned char)(bits >> (i * 8));
+    }
+
+    state[0 * lanes + index] = 0x67452301;
+    state[1 * lanes + index] = 0xefcdab89;
+    state[2 * lanes + index] = 0x98badcfe;
+    state[3 * lanes + index] = 0x10325476;
+}
+
+static void md5_many_lanes(const void* const* data, const size_t* sizes,
+                           size_t count, unsigned char* output, size_t lanes,
+                           MD5_LanesCompress compress) {
+    static const unsigned char idle[64];
+
+    uint32_t state[4 * MD5_MAX_LANES] = {0};
+    uint32_t words[16 * MD5_MAX_LANES];
+    MD5_Lane lane[MD5_MAX_LANES];
+    size_t   next   = 0;
+    size_t   active = 0;
+
+    for (size_t i = 0; i < lanes; i++) {
+        lane[i].message = SIZE_MAX;
+        if (next < count) {
+            md5_lane_start(&lane[i], state, lanes, i, data[next], sizes[next],
+                           next);
+            next++;
+            active++;
+        }
+    }
+
+    while (active > 0) {
+        /* Transpose: word n of every lane's block next to each other */
+        for (size_t i = 0; i < lanes; i++) {
+            const unsigned char* block = idle;
+            if (lane[i].message != SIZE_MAX) {
+                block = lane[i].full ? lane[i].next : lane[i].pad;
+            }
+            for (size_t n = 0; n < 16; n++) {
+                words[n * lanes + i] = md5_load_le32(block + n * 4);
+            }
+        }
+
+        compress(state, words);
+
+        for (size_t i = 0; i < lanes; i++) {
+            MD5_Lane* current = &lane[i];
+            if (current->message == SIZE_MAX) {
+                continue;
+            }
+            if (current->full) {
+                current->next += 64;
+                current->full--;
+                continue;
+            }
+            current->pad += 64;
+            if (--current->padded > 0) {
+                continue;
+            }
+
+            unsigned char* result = output + current->message * 16;
+            for (size_t r = 0; r < 4; r++) {
+                uint32_t word     = state[r * lanes + i];
+                result[r * 4]     = (unsigned char)word;
+                result[r * 4 + 1] = (unsigned char)(word >> 8);
+                result[r * 4 + 2] = (unsigned char)(word >> 16);
+                result[r * 4 + 3] = (unsigned char)(word >> 24);
+            }
+
+            current->message = SIZE_MAX;
+            if (next < count) {
+                md5_lane_start(current, state, lanes, i, data[next],
+                               sizes[next], next);
+                next++;
+            } else {
+                active--;
+            }
+        }
+    }
+}
+
+#endif /* MD5_LANES_X86 */
+
 /* ========================================================================
  * WRAPPER FUNCTIONS FOR EASY INTEGRATION
  * ======================================================================== */
@@ -276,8 +487,10 @@ int hash_md5_binary_to_string(const unsigned char* binary, char* output,
     }
 
     /* Convert binary to hex string */
+    static const char hex[] = "0123456789abcdef";
     for (int i = 0; i < HASH_MD5_BINARY_LENGTH; i++) {
-        snprintf(&output[i * 2], 3, "%02x", (unsigned int)binary[i]);
+        output[i * 2]     = hex[binary[i] >> 4];
+        output[i * 2 + 1] = hex[binary[i] & 0x0f];
     }
     output[HASH_MD5_STRING_LENGTH - 1] = '\0';
 
@@ -300,3 +513,55 @@ int hash_md5_string(const void* data, size_t data_size, char* output,
     /* Convert to hex string */
     return hash_md5_binary_to_string(binary, output, output_size);
 }
+
+int hash_md5_binary_many(const void* const* data, const size_t* sizes,
+                         size_t count, unsigned char* output) {
+    if (count == 0) {
+        return 0;
+    }
+    if (!data || !sizes || !output) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!data[i]) {
+            return -1;
+        }
+    }
+
+#ifdef MD5_LANES_X86
+    /* A single message would leave every other lane idle */
+    HashMd5ManyBackend backend = md5_many_resolve();
+    if (count > 1 && backend == HASH_MD5_MANY_AVX2) {
+        md5_many_lanes(data, sizes, count, output, 8, md5_compress_avx2);
+        return 0;
+    }
+    if (count > 1 && backend == HASH_MD5_MANY_SSE2) {
+        md5_many_lanes(data, sizes, count, output, 4, md5_compress_sse2);
+        return 0;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++) {
+        hash_md5_binary(data[i], sizes[i], output + i * HASH_MD5_BINARY_LENGTH);
+    }
+    return 0;
+}
+
+const char* hash_md5_many_backend(void) {
+    switch (md5_many_resolve()) {
+    case HASH_MD5_MANY_AVX2:
+        return "avx2";
+    case HASH_MD5_MANY_SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+int hash_md5_many_set_backend(HashMd5ManyBackend backend) {
+    if (!md5_many_supported(backend)) {
+        return -1;
+    }
+    g_many_backend = backend;
+    return 0;
+}
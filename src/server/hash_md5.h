@@ -63,4 +63,45 @@ int hash_md5_binary(const void* data, size_t data_size, unsigned char* output);
 int hash_md5_binary_to_string(const unsigned char* binary, char* output,
                               size_t output_size);
 
+/**
+ * Calculate the MD5 of many independent messages at once
+ *
+ * Messages are hashed side by side in the lanes of SSE2 or AVX2 registers,
+ * whichever the CPU has, one at a time without either. Results are the same
+ * as hash_md5_binary gives for each message.
+ *
+ * @param data Messages to hash
+ * @param sizes Size of each message in bytes
+ * @param count Number of messages
+ * @param output Buffer for count binary hashes, HASH_MD5_BINARY_LENGTH bytes
+ * each, in the order of data
+ * @return 0 on success, -1 on error
+ */
+int hash_md5_binary_many(const void* const* data, const size_t* sizes,
+                         size_t count, unsigned char* output);
+
+/* Implementations of hash_md5_binary_many */
+typedef enum {
+    HASH_MD5_MANY_AUTO, /* The widest this CPU has */
+    HASH_MD5_MANY_SCALAR,
+    HASH_MD5_MANY_SSE2,
+    HASH_MD5_MANY_AVX2,
+} HashMd5ManyBackend;
+
+/**
+ * Name of the implementation hash_md5_binary_many uses on this CPU
+ *
+ * @return "avx2", "sse2" or "scalar"
+ */
+const char* hash_md5_many_backend(void);
+
+/**
+ * Make hash_md5_binary_many use one implementation, so tests and benchmarks
+ * can compare them on a CPU that has several
+ *
+ * @param backend Implementation to use, HASH_MD5_MANY_AUTO to pick again
+ * @return 0 on success, -1 if this CPU or build lacks it
+ */
+int hash_md5_many_set_backend(HashMd5ManyBackend backend);
+
 #endif /* HASH_MD5_H */
@@ -1,3 +1,5 @@
+#include "linked_list.h"
+#include "open_meteo_handler.h"
 #include "smw.h"
 #include "utils.h"
 #include "weather_server.h"
@@ -17,6 +19,7 @@ int main() {
     setrlimit(RLIMIT_NOFILE, &rlim);
     printf("[MAIN] FD limit: %lu\n", rlim.rlim_cur);
     smw_init();
+    open_meteo_handler_init();
 
     WeatherServer server;
     weather_server_initiate(&server);
@@ -26,8 +29,10 @@ int main() {
     }
 
     weather_server_dispose(&server);
+    open_meteo_handler_cleanup();
 
     smw_dispose();
+    linked_list_pool_clear();
 
     return 0;
 }
\ No newline at end of file
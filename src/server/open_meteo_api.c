@@ -2,27 +2,130 @@
 
 #include "open_meteo_api.h"
 
+#include "bloom_filter.h"
+#include "circuit_breaker.h"
+#include "curl_pool.h"
+#include "file_io.h"
 #include "hash_md5.h"
+#include "linked_list.h"
+#include "log_store.h"
+#include "smw.h"
+#include "weather_key.h"
+#include "weather_record.h"
 
+#include <ctype.h>
 #include <curl/curl.h>
+#include <dirent.h>
 #include <jansson.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 
 /* ============= Configuration ============= */
 
 #define API_BASE_URL "https://api.open-meteo.com/v1/forecast"
 #define DEFAULT_CACHE_DIR "./cache"
 #define DEFAULT_CACHE_TTL 900 /* 15 minutes */
+#define DEFAULT_KEEP_RAW_JSON true
+#define DEFAULT_CACHE_MAX_BYTES (256u << 20)
+#define DEFAULT_CACHE_MAX_ENTRIES 0 /* Bytes are the limit that matters */
+#define DEFAULT_WARMUP_THREADS 4
+#define DEFAULT_WARMUP_BUDGET_MS 2000
+#define WARMUP_MAX_THREADS 64
+#define DEFAULT_CACHE_FSYNC WEATHER_FSYNC_PERIODIC
+#define DEFAULT_CACHE_FSYNC_PERIOD_MS 1000
+#define FLUSH_MAX_FILES 64 /* Segment files queued for the flusher at once */
+#define DEFAULT_CACHE_READ_DEPTH 64
+#define CACHE_READ_SLOTS 64 /* Locations with disk reads in flight at once */
+#define DEFAULT_STALE_WHILE_REVALIDATE 60
+#define DEFAULT_STALE_IF_ERROR 3600
+#define DEFAULT_NEGATIVE_TTL 30
+#define DEFAULT_REJECTED_TTL 600
+#define DEFAULT_CACHE_TTL_JITTER 10 /* Percent */
+#define DEFAULT_XFETCH_BETA 1.0
+#define DEFAULT_TTL_PERCENT_MIN 50
+#define DEFAULT_TTL_PERCENT_MAX 300
+#define DEFAULT_CACHE_TTL_MAX 3600
+#define DEFAULT_PREFETCH_TOP_K 32
+#define DEFAULT_PREFETCH_LEAD 30
+#define DEFAULT_PREFETCH_BUDGET 60 /* Upstream requests per minute */
+#define FETCH_DURATION_WEIGHT 0.2 /* Weight of the newest fetch in the mean */
+#define UPSTREAM_LATE_TTL 60 /* Retry delay when a boundary passed already */
+#define REFRESH_TIMEOUT 10L /* Seconds, same as the blocking fetch */
+#define STORE_COMPACT_PERIOD_MS 5000
+#define STORE_SEGMENTS_PER_LIMIT 8 /* Size eviction frees 1/8 at a time */
+#define STORE_MIN_SEGMENT_SIZE (1u << 20)
+#define LEGACY_MIGRATION_BATCH 256 /* Old cache files converted per tick */
+#define DEFAULT_COMPRESSION_LEVEL 6
+#define DEFAULT_COMPRESSION_MIN_SIZE 256 /* Below this gzip barely helps */
+#define DEFAULT_UPSTREAM_HANDLES 8
+#define DEFAULT_UPSTREAM_HTTP2 true
+#define DEFAULT_UPSTREAM_MAX_IN_FLIGHT 32
+#define DEFAULT_UPSTREAM_ERROR_PERCENT 50
+#define DEFAULT_UPSTREAM_LATENCY_MS 5000 /* Half the fetch timeout */
+#define DEFAULT_UPSTREAM_OPEN_MS 5000
+
+/* Upstream JSON is stored under the record's key plus this suffix, the
+ * same name the old per-coordinate cache files had */
+#define RAW_JSON_KEY_SUFFIX ".json"
+#define RAW_JSON_KEY_LENGTH                                                    \
+    (HASH_MD5_STRING_LENGTH + sizeof(RAW_JSON_KEY_SUFFIX) - 1)
+
+/* Key old cache files kept the entry's ttl_percent under */
+#define LEGACY_TTL_PERCENT_KEY "_ttl_percent"
+
+/* Volatility thresholds, Open-Meteo units: km/h, mm and hPa */
+#define CALM_WIND_SPEED 20.0
+#define STRONG_WIND_SPEED 40.0
+#define HEAVY_PRECIPITATION 4.0 /* Per interval */
+#define STEADY_PRESSURE_TREND 1.0 /* Per hour */
 
 /* ============= Global State ============= */
 
-static WeatherConfig g_config = {.cache_dir = DEFAULT_CACHE_DIR,
-                                 .cache_ttl = DEFAULT_CACHE_TTL,
-                                 .use_cache = true};
+/* What open_meteo_api_default_config hands out */
+static const WeatherConfig DEFAULT_CONFIG = {
+    .cache_dir              = DEFAULT_CACHE_DIR,
+    .cache_ttl              = DEFAULT_CACHE_TTL,
+    .use_cache              = true,
+    .keep_raw_json          = DEFAULT_KEEP_RAW_JSON,
+    .cache_max_bytes        = DEFAULT_CACHE_MAX_BYTES,
+    .cache_max_entries      = DEFAULT_CACHE_MAX_ENTRIES,
+    .cache_fsync            = DEFAULT_CACHE_FSYNC,
+    .cache_fsync_period_ms  = DEFAULT_CACHE_FSYNC_PERIOD_MS,
+    .cache_read_depth       = DEFAULT_CACHE_READ_DEPTH,
+    .warmup_threads         = DEFAULT_WARMUP_THREADS,
+    .warmup_budget_ms       = DEFAULT_WARMUP_BUDGET_MS,
+    .stale_while_revalidate = DEFAULT_STALE_WHILE_REVALIDATE,
+    .stale_if_error         = DEFAULT_STALE_IF_ERROR,
+    .negative_ttl           = DEFAULT_NEGATIVE_TTL,
+    .rejected_ttl           = DEFAULT_REJECTED_TTL,
+    .cache_ttl_jitter       = DEFAULT_CACHE_TTL_JITTER,
+    .ttl_policy             = open_meteo_api_ttl_policy_volatility,
+    .ttl_percent_min        = DEFAULT_TTL_PERCENT_MIN,
+    .ttl_percent_max        = DEFAULT_TTL_PERCENT_MAX,
+    .cache_ttl_max          = DEFAULT_CACHE_TTL_MAX,
+    .xfetch_beta            = DEFAULT_XFETCH_BETA,
+    .prefetch_top_k         = DEFAULT_PREFETCH_TOP_K,
+    .prefetch_lead          = DEFAULT_PREFETCH_LEAD,
+    .prefetch_budget        = DEFAULT_PREFETCH_BUDGET,
+    .compression_level      = DEFAULT_COMPRESSION_LEVEL,
+    .compression_min_size   = DEFAULT_COMPRESSION_MIN_SIZE,
+    .upstream_url           = API_BASE_URL,
+    .upstream_handles       = DEFAULT_UPSTREAM_HANDLES,
+    .upstream_http2         = DEFAULT_UPSTREAM_HTTP2,
+    .upstream_max_in_flight = DEFAULT_UPSTREAM_MAX_IN_FLIGHT,
+    .upstream_error_percent = DEFAULT_UPSTREAM_ERROR_PERCENT,
+    .upstream_latency_ms    = DEFAULT_UPSTREAM_LATENCY_MS,
+    .upstream_open_ms       = DEFAULT_UPSTREAM_OPEN_MS};
+
+/* Copied from the caller's in open_meteo_api_init */
+static WeatherConfig g_config = {0};
 
 /* ============= Internal Structures ============= */
 
@@ -31,19 +134,160 @@ typedef struct {
     size_t size;
 } MemoryChunk;
 
+/* A background refresh in flight on the shared multi handle */
+typedef struct {
+    ListHook    hook; /* Position in g_refresh.jobs */
+    CURL*       curl;
+    MemoryChunk chunk;
+    char*       url;
+    WeatherKey  key;
+    char        cache_key[HASH_MD5_STRING_LENGTH];
+    float       latitude;
+    float       longitude;
+} RefreshJob;
+
+/* Moving average of upstream fetch durations in seconds, XFetch's delta */
+static double g_fetch_seconds = 0.0;
+
+/* Curl handles for upstream, kept with their connections between fetches */
+static CurlPool g_upstream;
+static int      g_upstream_ready = 0;
+
+/* Decides whether upstream is asked at all, and how many requests at once */
+static CircuitBreaker g_breaker;
+
+static struct {
+    CURLM*                   multi;
+    SmwTask*                 task;
+    IntrusiveList            jobs;
+    OpenMeteoRefreshCallback callback;
+} g_refresh = {0};
+
+/* On-disk cache, segments and index live in cache_dir */
+static LogStore g_store;
+static int      g_store_ready = 0;
+
+static struct {
+    SmwTask* task;
+    uint64_t next_run;
+    uint64_t next_flush;
+} g_compaction = {0};
+
+/* Background thread syncing written segments to disk. The store hands it
+ * duplicated descriptors, so it never touches the store itself. */
+static struct {
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+    int             fds[FLUSH_MAX_FILES];
+    size_t          count;
+    int             running;
+    int             stop;
+    uint64_t        synced; /* Files synced, read with __atomic_load_n */
+} g_flusher = {.lock = PTHREAD_MUTEX_INITIALIZER,
+               .wake = PTHREAD_COND_INITIALIZER};
+
+/* One disk read started by open_meteo_api_cache_ready */
+typedef struct {
+    int     fd; /* Duplicate of the segment's, closed when done */
+    int*    pending;
+    uint8_t buffer[];
+} CacheRead;
+
+/* Reads bringing the store's pages for uncached locations into memory. A
+ * slot is reused once its reads are done, whether or not the request that
+ * started them came back for it. */
+static struct {
+    FileIo io;
+    int    ready;
+    struct {
+        WeatherKey key;
+        int        pending; /* Reads still in flight */
+    } slots[CACHE_READ_SLOTS];
+} g_reads = {0};
+
+/* Conversion of cache files left by versions before the store, NULL dir once
+ * every file has been looked at. files holds the keys of the files found at
+ * startup, so a miss only looks for a file when there may be one. */
+static struct {
+    DIR*        dir;
+    BloomFilter files;
+    size_t      migrated;
+} g_legacy = {0};
+
+/* A location found by the warm-up scan */
+typedef struct {
+    char   key[HASH_MD5_STRING_LENGTH];
+    time_t fetched_at;
+} WarmCandidate;
+
+/* One warm-up thread: first scans its slice of the store, then renders
+ * candidates claimed from the shared list */
+typedef struct {
+    pthread_t thread;
+    size_t    part;
+    size_t    parts;
+    uint64_t  deadline;
+
+    WarmCandidate* candidates;
+    size_t         count;
+    size_t         capacity;
+    int            failed;
+
+    /* Render phase, shared by all threads */
+    const WarmCandidate* chosen;
+    OpenMeteoWarmEntry*  entries;
+    size_t               chosen_count;
+    size_t*              next;
+} WarmWorker;
+
 /* ============= Internal Functions ============= */
 
 static size_t write_callback(void* contents, size_t size, size_t nmemb,
                              void* userp);
-static char*  generate_cache_filepath(float lat, float lon);
-static int    is_cache_valid(const char* filepath, int ttl_seconds);
-static int    load_weather_from_cache(const char* filepath, WeatherData** data);
-static int   save_raw_json_to_cache(const char* filepath, const char* json_str);
+static int    generate_cache_key(float lat, float lon, char* key);
+static void   raw_json_key(const char* key, char* out);
+static void   record_fetch_duration(CURL* curl);
+static int    load_weather_from_cache(const char* key, WeatherData** data);
+static int    save_weather_to_cache(const char* key, const WeatherData* data,
+                                    const char* raw_json);
+static int    migrate_legacy_file(const char* key);
+static void   migrate_legacy_batch(void);
+static int    cache_read_start(const char* key, int* pending);
+static void   cache_read_done(void* context, ssize_t result);
+static void   flusher_start(void);
+static void   flusher_request(void);
+static void   flusher_stop(void);
+static void*  flusher_work(void* context);
+static void   legacy_open(void);
+static void   legacy_close(void);
+static int    legacy_key(const char* name, char* key);
+static int    legacy_may_exist(const char* key);
+static uint64_t legacy_hash(const char* key);
+static uint64_t monotonic_ms(void);
+static int   warm_up_scan_record(const char* key, size_t key_len,
+                                 const LogStoreRecord* record, void* context);
+static void* warm_up_scan(void* context);
+static void* warm_up_render(void* context);
+static void  warm_up_run(WarmWorker* workers, size_t count,
+                         void* (*work)(void*));
+static int   compare_candidates(const void* a, const void* b);
+static void  apply_ttl_policy(WeatherData* data, const WeatherData* previous);
 static int   fetch_weather_from_api(Location* location, WeatherData** data);
 static char* build_api_url(float lat, float lon);
+static CURL* upstream_acquire(void);
+static void  upstream_release(CURL* curl);
+static int   upstream_admit(void);
+static void  upstream_record(CURL* curl, CURLcode code, long http_code);
 static int   parse_weather_json(const char* json_str, WeatherData* data,
                                 float lat, float lon);
 static const char* get_wind_direction_name(int degrees);
+static int         parse_coordinate(const char* value, float* out);
+static time_t      parse_upstream_time(const char* value);
+static void        refresh_task_work(void* context, uint64_t mon_time);
+static void        refresh_job_finish(RefreshJob* job, CURLcode code);
+static void        refresh_job_free(RefreshJob* job);
+static void        compaction_task_work(void* context, uint64_t mon_time);
 
 /* ============= Weather Code Descriptions ============= */
 
@@ -139,45 +383,181 @@ int open_meteo_api_init(WeatherConfig* config) {
 #endif
     }
 
+    if (g_config.use_cache) {
+        /* Size eviction drops a whole segment, keep that a fraction */
+        size_t segment_size = 0;
+        if (g_config.cache_max_bytes > 0) {
+            segment_size = g_config.cache_max_bytes / STORE_SEGMENTS_PER_LIMIT;
+            if (segment_size < STORE_MIN_SEGMENT_SIZE) {
+                segment_size = STORE_MIN_SEGMENT_SIZE;
+            } else if (segment_size > LOG_STORE_DEFAULT_SEGMENT_SIZE) {
+                segment_size = LOG_STORE_DEFAULT_SEGMENT_SIZE;
+            }
+        }
+
+        /* Every location has a record, and its JSON when that is kept */
+        size_t keys_per_location = g_config.keep_raw_json ? 2 : 1;
+        size_t max_keys          = g_config.cache_max_entries > 0
+                                       ? (size_t)g_config.cache_max_entries *
+                                    keys_per_location
+                                       : 0;
+
+        if (log_store_initiate(&g_store, g_config.cache_dir, segment_size) ==
+            0) {
+            log_store_set_limits(&g_store, g_config.cache_max_bytes, max_keys);
+            g_store_ready     = 1;
+            g_compaction.task = smw_create_task(NULL, compaction_task_work);
+            legacy_open();
+            flusher_start();
+
+            if (g_config.cache_read_depth > 0 &&
+                file_io_initiate(&g_reads.io, g_config.cache_read_depth, 0) ==
+                    0) {
+                g_reads.ready = 1;
+            }
+        } else {
+            fprintf(stderr, "[METEO] Cache store unavailable, not caching\n");
+        }
+    }
+
     /* Initialize curl globally */
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
+    if (!g_config.upstream_url) {
+        g_config.upstream_url = API_BASE_URL;
+    }
+    if (curl_pool_initiate(&g_upstream,
+                           g_config.upstream_handles > 0
+                               ? (size_t)g_config.upstream_handles
+                               : 0,
+                           g_config.upstream_ca_file,
+                           g_config.upstream_http2) == 0) {
+        g_upstream_ready = 1;
+    } else {
+        fprintf(stderr, "[METEO] Upstream pool unavailable, not reusing "
+                        "connections\n");
+    }
+
+    /* Starts at what the pool keeps, then follows what upstream serves */
+    circuit_breaker_initiate(&g_breaker,
+                             g_config.upstream_handles > 0
+                                 ? (unsigned)g_config.upstream_handles
+                                 : DEFAULT_UPSTREAM_HANDLES,
+                             g_config.upstream_max_in_flight > 0
+                                 ? (unsigned)g_config.upstream_max_in_flight
+                                 : DEFAULT_UPSTREAM_MAX_IN_FLIGHT);
+    circuit_breaker_set_thresholds(&g_breaker, g_config.upstream_error_percent,
+                                   g_config.upstream_latency_ms,
+                                   g_config.upstream_open_ms);
+
+    /* XFetch draws from random() */
+    srandom((unsigned)time(NULL) ^ (unsigned)getpid());
+
     printf("[METEO] API initialized\n");
     printf("[METEO] Cache dir: %s\n", g_config.cache_dir);
     printf("[METEO] Cache TTL: %d seconds\n", g_config.cache_ttl);
     printf("[METEO] Cache enabled: %s\n", g_config.use_cache ? "yes" : "no");
+    printf("[METEO] Keep raw JSON: %s\n",
+           g_config.keep_raw_json ? "yes" : "no");
+    printf("[METEO] Cache limits: %zu bytes, %d locations (0 = none)\n",
+           g_config.cache_max_bytes, g_config.cache_max_entries);
+    printf("[METEO] Cache fsync: %s\n",
+           g_config.cache_fsync == WEATHER_FSYNC_ALWAYS     ? "every write"
+           : g_config.cache_fsync == WEATHER_FSYNC_PERIODIC ? "periodic"
+                                                            : "never");
+    printf("[METEO] Cache reads: %s, %d in flight\n",
+           g_reads.ready ? file_io_backend_name(&g_reads.io) : "synchronous",
+           g_config.cache_read_depth);
+    printf("[METEO] Warm-up: %d threads, %d ms budget\n",
+           g_config.warmup_threads, g_config.warmup_budget_ms);
+    printf("[METEO] Stale-while-revalidate: %d seconds\n",
+           g_config.stale_while_revalidate);
+    printf("[METEO] Stale-if-error: %d seconds\n", g_config.stale_if_error);
+    printf("[METEO] Negative TTL: %d seconds, rejected: %d seconds\n",
+           g_config.negative_ttl, g_config.rejected_ttl);
+    printf("[METEO] TTL jitter: %d%%, XFetch beta: %.2f\n",
+           g_config.cache_ttl_jitter, g_config.xfetch_beta);
+    printf("[METEO] TTL policy: %s, %d-%d%%, max %d seconds\n",
+           g_config.ttl_policy ? "on" : "off", g_config.ttl_percent_min,
+           g_config.ttl_percent_max, g_config.cache_ttl_max);
+    printf("[METEO] Prefetch: top %d, %ds lead, %d requests/min\n",
+           g_config.prefetch_top_k, g_config.prefetch_lead,
+           g_config.prefetch_budget);
+    printf("[METEO] Compression: level %d, min %zu bytes\n",
+           g_config.compression_level, g_config.compression_min_size);
+    printf("[METEO] Upstream: %s, %d pooled handles, HTTP/2 %s\n",
+           g_config.upstream_url, g_config.upstream_handles,
+           g_config.upstream_http2 ? "on" : "off");
+    printf("[METEO] Upstream breaker: %d%% errors, %d ms latency, %d ms open, "
+           "max %d in flight\n",
+           g_config.upstream_error_percent, g_config.upstream_latency_ms,
+           g_config.upstream_open_ms, (int)g_breaker.limit_max);
 
     return 0;
 }
 
+void open_meteo_api_default_config(WeatherConfig* config) {
+    *config = DEFAULT_CONFIG;
+}
+
+const WeatherConfig* open_meteo_api_get_config(void) { return &g_config; }
+
 int open_meteo_api_get_current(Location* location, WeatherData** data) {
     if (!location || !data) {
         fprintf(stderr, "[METEO] Invalid parameters\n");
         return -1;
     }
 
-    /* Generate cache filepath using MD5 */
-    char* cache_file =
-        generate_cache_filepath(location->latitude, location->longitude);
-    if (!cache_file) {
-        fprintf(stderr, "[METEO] Failed to generate cache filepath\n");
+    /* Records in the store are keyed by an MD5 of the coordinates */
+    char cache_key[HASH_MD5_STRING_LENGTH];
+    if (generate_cache_key(location->latitude, location->longitude,
+                           cache_key) != 0) {
         return -2;
     }
 
-    printf("[METEO] Cache file: %s\n", cache_file);
-
-    /* Check cache validity */
-    if (g_config.use_cache && is_cache_valid(cache_file, g_config.cache_ttl)) {
-        printf("[METEO] Cache HIT - loading from file\n");
+    printf("[METEO] Cache key: %s\n", cache_key);
 
-        int result = load_weather_from_cache(cache_file, data);
-        free(cache_file);
+    /* Check cache validity, the entry's own data decides its TTL */
+    time_t       age    = 0;
+    WeatherData* cached = NULL;
+    int          ttl    = g_config.cache_ttl;
 
-        if (result == 0) {
-            return 0; /* Success - loaded from cache */
+    if (g_config.use_cache) {
+        /* An old cache file not converted yet is converted now */
+        if (load_weather_from_cache(cache_key, &cached) != 0 &&
+            (!legacy_may_exist(cache_key) ||
+             migrate_legacy_file(cache_key) != 0 ||
+             load_weather_from_cache(cache_key, &cached) != 0)) {
+            cached = NULL;
         }
+    }
+    if (cached) {
+        time_t now = time(NULL);
+        age = now > cached->fetched_at ? now - cached->fetched_at : 0;
+        ttl = open_meteo_api_entry_ttl(cached, location->latitude,
+                                       location->longitude);
+    }
+
+    if (cached && age <= ttl) {
+        printf("[METEO] Cache HIT - loaded from store\n");
+
+        cached->cache_status = WEATHER_CACHE_HIT;
+        *data                = cached;
 
-        fprintf(stderr, "[METEO] Cache load failed, fetching from API\n");
+        if (open_meteo_api_should_refresh_early(age, ttl)) {
+            printf("[METEO] Refreshing early (%lds of %ds)\n", (long)age, ttl);
+            open_meteo_api_refresh_async(location);
+        }
+        return 0; /* Success - loaded from cache */
+    } else if (cached && age <= ttl + g_config.stale_while_revalidate) {
+        /* Answer now with the stale entry, refresh behind it */
+        printf("[METEO] Cache STALE (%lds old) - refreshing in background\n",
+               (long)age);
+
+        cached->cache_status = WEATHER_CACHE_STALE;
+        *data                = cached;
+        open_meteo_api_refresh_async(location);
+        return 0;
     } else {
         if (g_config.use_cache) {
             printf("[METEO] Cache MISS - fetching from API\n");
@@ -191,13 +571,33 @@ int open_meteo_api_get_current(Location* location, WeatherData** data) {
 
     if (result != 0) {
         fprintf(stderr, "[METEO] API fetch failed\n");
-        free(cache_file);
-        return -3;
+
+        /* An old answer beats an error while within stale_if_error */
+        if (cached && age <= ttl + g_config.stale_if_error) {
+            printf("[METEO] Serving stale cache (%lds old) after error\n",
+                   (long)age);
+            cached->cache_status = WEATHER_CACHE_STALE_ERROR;
+            *data                = cached;
+            return 0;
+        }
+
+        open_meteo_api_free_current(cached);
+        if (result == OPEN_METEO_API_ERROR_REJECTED ||
+            result == OPEN_METEO_API_ERROR_UNAVAILABLE) {
+            return result;
+        }
+        return OPEN_METEO_API_ERROR_UPSTREAM;
     }
 
-    /* Save RAW JSON to cache (preserves original API structure) */
+    /* The entry being replaced shows how fast conditions change */
+    apply_ttl_policy(*data, cached);
+    open_meteo_api_free_current(cached);
+    (*data)->cache_status = WEATHER_CACHE_MISS;
+
+    /* Save the record, and upstream's JSON to answer with */
     if (g_config.use_cache && (*data)->_raw_json_cache) {
-        if (save_raw_json_to_cache(cache_file, (*data)->_raw_json_cache) == 0) {
+        if (save_weather_to_cache(cache_key, *data,
+                                  (*data)->_raw_json_cache) == 0) {
             printf("[METEO] Saved to cache\n");
         } else {
             fprintf(stderr, "[METEO] Failed to save cache\n");
@@ -208,7 +608,186 @@ int open_meteo_api_get_current(Location* location, WeatherData** data) {
         (*data)->_raw_json_cache = NULL;
     }
 
-    free(cache_file);
+    return 0;
+}
+
+int open_meteo_api_entry_ttl(const WeatherData* data, float lat, float lon) {
+    int percent = data->ttl_percent > 0 ? data->ttl_percent : 100;
+    int base    = g_config.cache_ttl * percent / 100;
+    int spread  = base * g_config.cache_ttl_jitter / 100;
+
+    if (data->interval > 0 && data->timestamp > 0) {
+        /* New values appear when the next interval starts */
+        time_t boundary = data->timestamp + data->interval;
+        base            = (int)(boundary - data->fetched_at);
+        if (base <= 0) {
+            /* Upstream has not published the next interval yet */
+            base = UPSTREAM_LATE_TTL;
+        } else if (base > data->interval) {
+            base = data->interval;
+        }
+
+        /* Nothing new exists before the boundary, so volatile entries can
+         * only drop the jitter, while calm ones skip into the next interval */
+        spread = data->interval * g_config.cache_ttl_jitter / 100;
+        if (percent < 100) {
+            spread = spread * percent / 100;
+        } else if (boundary > data->fetched_at) {
+            base += data->interval * (percent - 100) / 100;
+        }
+    }
+
+    if (g_config.cache_ttl_max > 0 && base > g_config.cache_ttl_max) {
+        base = g_config.cache_ttl_max;
+    }
+
+    if (spread <= 0) {
+        return base;
+    }
+
+    /* Derived from the entry itself so every check agrees on its TTL */
+    char key[96];
+    int  len = snprintf(key, sizeof(key), "%.6f,%.6f,%lld", lat, lon,
+                        (long long)data->fetched_at);
+
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619u;
+    }
+
+    /* Boundary entries only move later, never before new data exists */
+    if (data->interval > 0 && data->timestamp > 0) {
+        return base + (int)(hash % (spread + 1));
+    }
+    return base - spread + (int)(hash % (2 * spread + 1));
+}
+
+int open_meteo_api_ttl_policy_volatility(const WeatherData* data,
+                                         const WeatherData* previous) {
+    int code = data->weather_code;
+
+    /* Thunderstorms, heavy rain, snow and showers change within minutes */
+    if (code >= 95 || code == 65 || code == 67 || code == 75 || code == 82 ||
+        code == 86 || data->precipitation >= HEAVY_PRECIPITATION) {
+        return 50;
+    }
+    if (data->windspeed >= STRONG_WIND_SPEED) {
+        return 75;
+    }
+
+    /* Only dry weather (clear to overcast, fog) in light wind counts as calm */
+    int dry = code <= 3 || code == 45 || code == 48;
+    if (!dry || data->windspeed >= CALM_WIND_SPEED) {
+        return 100;
+    }
+    if (!previous) {
+        return 150;
+    }
+
+    if (previous->weather_code != code) {
+        return 100;
+    }
+
+    /* A falling or rising barometer announces a change */
+    double hours = (double)(data->timestamp - previous->timestamp) / 3600.0;
+    double trend = data->pressure - previous->pressure;
+    if (hours > 1.0) {
+        trend /= hours;
+    }
+    if (fabs(trend) >= STEADY_PRESSURE_TREND) {
+        return 100;
+    }
+
+    return 200;
+}
+
+int open_meteo_api_should_refresh_early(time_t age, int ttl) {
+    if (g_config.xfetch_beta <= 0.0 || g_fetch_seconds <= 0.0) {
+        return 0;
+    }
+
+    /* XFetch: refresh once age - delta * beta * ln(rand) reaches the TTL */
+    double random_unit = (random() + 1.0) / ((double)RAND_MAX + 1.0);
+    double early = -g_fetch_seconds * g_config.xfetch_beta * log(random_unit);
+
+    return (double)age + early >= (double)ttl;
+}
+
+void open_meteo_api_set_refresh_callback(OpenMeteoRefreshCallback callback) {
+    g_refresh.callback = callback;
+}
+
+int open_meteo_api_refresh_async(const Location* location) {
+    if (!location) {
+        return -1;
+    }
+
+    WeatherKey key = weather_key_make(location->latitude, location->longitude);
+    if (key == WEATHER_KEY_INVALID) {
+        return -2;
+    }
+
+    /* One refresh per location is enough */
+    IntrusiveList_foreach(&g_refresh.jobs, RefreshJob, hook, running) {
+        if (running->key == key) {
+            return 1;
+        }
+    }
+
+    if (!g_refresh.multi) {
+        g_refresh.multi = curl_multi_init();
+        if (!g_refresh.multi) {
+            return -3;
+        }
+        if (g_upstream_ready) {
+            curl_pool_setup_multi(&g_upstream, g_refresh.multi);
+        }
+    }
+
+    /* The entry being refreshed is still served, so this can wait */
+    if (!upstream_admit()) {
+        return 2;
+    }
+
+    RefreshJob* job = calloc(1, sizeof(RefreshJob));
+    if (!job) {
+        circuit_breaker_cancel(&g_breaker);
+        return -4;
+    }
+
+    job->key        = key;
+    job->latitude   = location->latitude;
+    job->longitude  = location->longitude;
+    job->url        = build_api_url(location->latitude, location->longitude);
+    job->curl       = upstream_acquire();
+    if (!job->url || !job->curl ||
+        weather_key_store_name(key, job->cache_key) != 0) {
+        circuit_breaker_cancel(&g_breaker);
+        refresh_job_free(job);
+        return -5;
+    }
+
+    curl_easy_setopt(job->curl, CURLOPT_URL, job->url);
+    curl_easy_setopt(job->curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(job->curl, CURLOPT_WRITEDATA, (void*)&job->chunk);
+    curl_easy_setopt(job->curl, CURLOPT_USERAGENT, "weatherio/1.0");
+    curl_easy_setopt(job->curl, CURLOPT_TIMEOUT, REFRESH_TIMEOUT);
+    curl_easy_setopt(job->curl, CURLOPT_PRIVATE, job);
+
+    if (curl_multi_add_handle(g_refresh.multi, job->curl) != CURLM_OK) {
+        circuit_breaker_cancel(&g_breaker);
+        refresh_job_free(job);
+        return -6;
+    }
+
+    if (!g_refresh.task) {
+        g_refresh.task = smw_create_task(NULL, refresh_task_work);
+    }
+
+    intrusive_list_append(&g_refresh.jobs, &job->hook);
+    printf("[METEO] Background refresh started: %s\n", job->url);
+
     return 0;
 }
 
@@ -224,6 +803,38 @@ void open_meteo_api_free_current(WeatherData* data) {
 }
 
 void open_meteo_api_cleanup(void) {
+    ListHook* hook;
+    while ((hook = intrusive_list_pop_front(&g_refresh.jobs)) != NULL) {
+        refresh_job_free(IntrusiveList_entry(hook, RefreshJob, hook));
+    }
+    if (g_refresh.task) {
+        smw_destroy_task(g_refresh.task);
+        g_refresh.task = NULL;
+    }
+    if (g_refresh.multi) {
+        curl_multi_cleanup(g_refresh.multi);
+        g_refresh.multi = NULL;
+    }
+    if (g_upstream_ready) {
+        curl_pool_dispose(&g_upstream);
+        g_upstream_ready = 0;
+    }
+
+    if (g_compaction.task) {
+        smw_destroy_task(g_compaction.task);
+        g_compaction.task = NULL;
+    }
+    legacy_close();
+    if (g_reads.ready) {
+        file_io_dispose(&g_reads.io);
+        g_reads.ready = 0;
+    }
+    flusher_stop();
+    if (g_store_ready) {
+        log_store_dispose(&g_store);
+        g_store_ready = 0;
+    }
+
     curl_global_cleanup();
     printf("[METEO] API cleaned up\n");
 }
@@ -248,20 +859,25 @@ char* open_meteo_api_build_json_response(WeatherData* data, float lat,
         return NULL;
     }
 
-    // Try loading cached JSON first
-    char*   cache_file = generate_cache_filepath(lat, lon);
-    json_t* root       = NULL;
+    // Try the stored upstream JSON first, only read when a body is built
+    char           cache_key[HASH_MD5_STRING_LENGTH];
+    char           json_key[RAW_JSON_KEY_LENGTH];
+    LogStoreRecord record;
+    json_t*        root = NULL;
 
-    if (cache_file) {
-        json_error_t error;
-        root = json_load_file(cache_file, 0, &error);
+    if (g_store_ready && g_config.keep_raw_json &&
+        generate_cache_key(lat, lon, cache_key) == 0) {
+        raw_json_key(cache_key, json_key);
 
-        if (!root) {
-            fprintf(stderr, "[METEO] Cache miss or invalid cache: %s\n",
-                    error.text);
-        }
+        if (log_store_read(&g_store, json_key, &record) == 0) {
+            json_error_t error;
+            root = json_loadb(record.value, record.value_len, 0, &error);
 
-        free(cache_file);
+            if (!root) {
+                fprintf(stderr, "[METEO] Invalid cached JSON: %s\n",
+                        error.text);
+            }
+        }
     }
 
     // Build JSON manually if cache fails
@@ -333,6 +949,237 @@ char* open_meteo_api_build_json_response(WeatherData* data, float lat,
     return json_str;
 }
 
+int open_meteo_api_cache_ready(float lat, float lon) {
+    WeatherKey key = weather_key_make(lat, lon);
+    if (!g_store_ready || !g_reads.ready || key == WEATHER_KEY_INVALID) {
+        return 1;
+    }
+
+    size_t slot = CACHE_READ_SLOTS;
+    for (size_t i = 0; i < CACHE_READ_SLOTS; i++) {
+        if (g_reads.slots[i].key == key) {
+            if (g_reads.slots[i].pending > 0) {
+                return 0;
+            }
+            /* Done, the pages are in memory now */
+            g_reads.slots[i].key = WEATHER_KEY_INVALID;
+            return 1;
+        }
+        if (slot == CACHE_READ_SLOTS && g_reads.slots[i].pending == 0) {
+            slot = i;
+        }
+    }
+
+    /* Every slot busy, read synchronously instead */
+    if (slot == CACHE_READ_SLOTS) {
+        return 1;
+    }
+
+    char store_key[HASH_MD5_STRING_LENGTH];
+    if (weather_key_store_name(key, store_key) != 0) {
+        return 1;
+    }
+
+    int* pending = &g_reads.slots[slot].pending;
+    int  started = cache_read_start(store_key, pending);
+    if (g_config.keep_raw_json) {
+        char json_key[RAW_JSON_KEY_LENGTH];
+        raw_json_key(store_key, json_key);
+        started += cache_read_start(json_key, pending);
+    }
+    if (started == 0) {
+        return 1;
+    }
+
+    g_reads.slots[slot].key = key;
+    return 0;
+}
+
+int open_meteo_api_warm_up(size_t max_entries, OpenMeteoWarmEntry** entries) {
+    *entries = NULL;
+    if (!g_store_ready || g_config.warmup_threads <= 0 || max_entries == 0) {
+        return 0;
+    }
+
+    size_t threads = g_config.warmup_threads < WARMUP_MAX_THREADS
+                         ? (size_t)g_config.warmup_threads
+                         : WARMUP_MAX_THREADS;
+    uint64_t started = monotonic_ms();
+
+    WarmWorker workers[WARMUP_MAX_THREADS];
+    memset(workers, 0, sizeof(workers));
+    for (size_t i = 0; i < threads; i++) {
+        workers[i].part     = i;
+        workers[i].parts    = threads;
+        workers[i].deadline = started + (uint64_t)g_config.warmup_budget_ms;
+    }
+
+    /* jansson seeds its hash tables on first use, do it before the threads */
+    json_object_seed(0);
+
+    /* Phase one: every thread checks its slice of the index */
+    warm_up_run(workers, threads, warm_up_scan);
+
+    int    result = 0;
+    size_t found  = 0;
+    for (size_t i = 0; i < threads; i++) {
+        found += workers[i].count;
+        result = workers[i].failed ? -2 : result;
+    }
+
+    WarmCandidate* chosen = found ? malloc(found * sizeof(*chosen)) : NULL;
+    if (found && !chosen) {
+        result = -2;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < threads; i++) {
+        if (chosen) {
+            memcpy(chosen + count, workers[i].candidates,
+                   workers[i].count * sizeof(*chosen));
+            count += workers[i].count;
+        }
+        free(workers[i].candidates);
+        workers[i].candidates = NULL;
+    }
+    if (result != 0) {
+        free(chosen);
+        return result;
+    }
+
+    /* Recently fetched locations are the ones still being asked for */
+    if (count > max_entries) {
+        qsort(chosen, count, sizeof(*chosen), compare_candidates);
+        count = max_entries;
+    }
+
+    /* Phase two: render responses, the expensive part, in parallel */
+    OpenMeteoWarmEntry* loaded = count ? calloc(count, sizeof(*loaded)) : NULL;
+    size_t              next   = 0;
+    if (count && !loaded) {
+        free(chosen);
+        return -2;
+    }
+    for (size_t i = 0; i < threads; i++) {
+        workers[i].chosen       = chosen;
+        workers[i].entries      = loaded;
+        workers[i].chosen_count = count;
+        workers[i].next         = &next;
+    }
+    warm_up_run(workers, threads, warm_up_render);
+    free(chosen);
+
+    /* Drop what failed or was cut off by the budget */
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (loaded[i].body) {
+            loaded[kept++] = loaded[i];
+        } else {
+            open_meteo_api_free_current(loaded[i].data);
+        }
+    }
+
+    uint64_t elapsed = monotonic_ms() - started;
+    printf("[METEO] Warm-up: %zu of %zu cached locations in %llu ms "
+           "(%.0f/s, %zu threads)%s\n",
+           kept, found, (unsigned long long)elapsed,
+           elapsed ? kept * 1000.0 / elapsed : (double)kept, threads,
+           elapsed >= (uint64_t)g_config.warmup_budget_ms ? ", out of time"
+                                                          : "");
+
+    if (kept == 0) {
+        free(loaded);
+        loaded = NULL;
+    }
+    *entries = loaded;
+    return (int)kept;
+}
+
+char* open_meteo_api_cache_stats_json(void) {
+    json_t* root = json_object();
+    if (!root) {
+        return NULL;
+    }
+
+    json_object_set_new(root, "enabled", json_boolean(g_store_ready));
+    json_object_set_new(root, "max_bytes",
+                        json_integer((json_int_t)g_config.cache_max_bytes));
+    json_object_set_new(root, "max_entries",
+                        json_integer(g_config.cache_max_entries));
+    json_object_set_new(
+        root, "files_synced",
+        json_integer((json_int_t)__atomic_load_n(&g_flusher.synced,
+                                                 __ATOMIC_RELAXED)));
+    json_object_set_new(root, "legacy_files_converted",
+                        json_integer((json_int_t)g_legacy.migrated));
+    json_object_set_new(root, "read_backend",
+                        json_string(g_reads.ready
+                                        ? file_io_backend_name(&g_reads.io)
+                                        : "synchronous"));
+    json_object_set_new(root, "reads_completed",
+                        json_integer((json_int_t)g_reads.io.completed));
+
+    /* Every upstream request past the first few should reuse a connection */
+    json_object_set_new(root, "upstream_requests",
+                        json_integer((json_int_t)g_upstream.requests));
+    json_object_set_new(root, "upstream_connections",
+                        json_integer((json_int_t)g_upstream.connections));
+    json_object_set_new(root, "upstream_circuit",
+                        json_string(circuit_breaker_state_name(
+                            g_breaker.state)));
+    json_object_set_new(root, "upstream_in_flight",
+                        json_integer(g_breaker.in_flight));
+    json_object_set_new(root, "upstream_limit",
+                        json_real(g_breaker.limit));
+    json_object_set_new(root, "upstream_error_rate",
+                        json_real(g_breaker.error_rate));
+    json_object_set_new(root, "upstream_latency_ms",
+                        json_real(g_breaker.latency_ms));
+    json_object_set_new(root, "upstream_circuit_opened",
+                        json_integer((json_int_t)g_breaker.opened));
+    json_object_set_new(root, "upstream_rejected",
+                        json_integer((json_int_t)g_breaker.rejected));
+
+    if (g_store_ready) {
+        json_object_set_new(
+            root, "disk_bytes",
+            json_integer((json_int_t)log_store_disk_size(&g_store)));
+        json_object_set_new(
+            root, "keys", json_integer((json_int_t)log_store_count(&g_store)));
+        json_object_set_new(root, "segments",
+                            json_integer((json_int_t)g_store.segment_count));
+        json_object_set_new(root, "expired_records",
+                            json_integer((json_int_t)g_store.expired_records));
+        json_object_set_new(root, "evicted_records",
+                            json_integer((json_int_t)g_store.evicted_records));
+        json_object_set_new(
+            root, "evicted_segments",
+            json_integer((json_int_t)g_store.evicted_segments));
+        json_object_set_new(
+            root, "compacted_segments",
+            json_integer((json_int_t)g_store.compacted_segments));
+
+        /* Observed: share of absent keys the filter failed to rule out */
+        uint64_t absent = g_store.bloom_skipped + g_store.bloom_false_positives;
+        json_object_set_new(
+            root, "bloom_bytes",
+            json_integer((json_int_t)bloom_filter_memory(&g_store.bloom)));
+        json_object_set_new(
+            root, "bloom_false_positive_rate",
+            json_real(bloom_filter_false_positive_rate(&g_store.bloom)));
+        json_object_set_new(
+            root, "bloom_observed_false_positive_rate",
+            json_real(absent ? (double)g_store.bloom_false_positives /
+                                   (double)absent
+                             : 0.0));
+        json_object_set_new(root, "bloom_skipped_lookups",
+                            json_integer((json_int_t)g_store.bloom_skipped));
+    }
+
+    char* json_str = json_dumps(root, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+    json_decref(root);
+    return json_str;
+}
+
 int open_meteo_api_parse_query(const char* query, float* lat, float* lon) {
     if (!query || !lat || !lon) {
         return -1;
@@ -348,24 +1195,24 @@ int open_meteo_api_parse_query(const char* query, float* lat, float* lon) {
 
     while (token != NULL) {
         if (strncmp(token, "lat=", 4) == 0) {
-            *lat      = atof(token + 4);
-            found_lat = 1;
+            found_lat = parse_coordinate(token + 4, lat);
         } else if (strncmp(token, "lon=", 4) == 0 ||
                    strncmp(token, "long=", 5) == 0) {
-            char* value = strchr(token, '=');
-            if (value) {
-                *lon      = atof(value + 1);
-                found_lon = 1;
-            }
+            found_lon = parse_coordinate(strchr(token, '=') + 1, lon);
         }
         token = strtok(NULL, "&");
     }
 
-    if (found_lat && found_lon) {
-        return 0;
+    if (!found_lat || !found_lon) {
+        return -1;
+    }
+
+    /* Upstream rejects these anyway, no need to ask it */
+    if (*lat < -90.0f || *lat > 90.0f || *lon < -180.0f || *lon > 180.0f) {
+        return -2;
     }
 
-    return -1;
+    return 0;
 }
 
 int open_meteo_api_get_city_name(float lat, float lon, char* city_name,
@@ -383,6 +1230,21 @@ int open_meteo_api_get_city_name(float lat, float lon, char* city_name,
 
 /* ============= Internal Functions Implementation ============= */
 
+/**
+ * Parses a whole query value as a finite number, returns 1 on success
+ */
+static int parse_coordinate(const char* value, float* out) {
+    char*  end    = NULL;
+    double parsed = strtod(value, &end);
+
+    if (end == value || *end != '\0' || !isfinite(parsed)) {
+        return 0;
+    }
+
+    *out = (float)parsed;
+    return 1;
+}
+
 /**
  * CURL write callback for receiving data
  */
@@ -406,196 +1268,217 @@ static size_t write_callback(void* contents, size_t size, size_t nmemb,
 }
 
 /**
- * Generate cache filepath using MD5 hash of coordinates
- * Caller must free the returned string
+ * Store key for coordinates, see weather_key_store_name. key must hold
+ * HASH_MD5_STRING_LENGTH bytes.
  */
-static char* generate_cache_filepath(float lat, float lon) {
-    /* Create unique key from coordinates */
-    char cache_key[256];
-    int  key_len =
-        snprintf(cache_key, sizeof(cache_key), "weather_%.6f_%.6f", lat, lon);
-
-    if (key_len < 0 || key_len >= (int)sizeof(cache_key)) {
+static int generate_cache_key(float lat, float lon, char* key) {
+    if (weather_key_store_name(weather_key_make(lat, lon), key) != 0) {
         fprintf(stderr, "[METEO] Failed to create cache key\n");
-        return NULL;
+        return -1;
     }
 
-    /* Calculate MD5 hash */
-    char hash[HASH_MD5_STRING_LENGTH];
-    if (hash_md5_string(cache_key, strlen(cache_key), hash, sizeof(hash)) !=
-        0) {
-        fprintf(stderr, "[METEO] Failed to calculate MD5 hash\n");
-        return NULL;
+    return 0;
+}
+
+/**
+ * Store key of the upstream JSON kept next to the record under key. out must
+ * hold RAW_JSON_KEY_LENGTH bytes.
+ */
+static void raw_json_key(const char* key, char* out) {
+    snprintf(out, RAW_JSON_KEY_LENGTH, "%s" RAW_JSON_KEY_SUFFIX, key);
+}
+
+/**
+ * Starts reading key's record into the page cache if it is not in memory,
+ * counting the read in *pending. Returns 1 if a read was started.
+ */
+static int cache_read_start(const char* key, int* pending) {
+    int    fd     = -1;
+    off_t  offset = 0;
+    size_t len    = 0;
+    if (log_store_resident(&g_store, key, &fd, &offset, &len) != 0) {
+        return 0;
     }
 
-    /* Build full filepath: cache_dir/hash.json */
-    char* filepath = malloc(512);
-    if (!filepath) {
-        fprintf(stderr, "[METEO] Failed to allocate memory for filepath\n");
-        return NULL;
+    CacheRead* job = malloc(sizeof(CacheRead) + len);
+    if (!job) {
+        close(fd);
+        return 0;
     }
+    job->fd      = fd;
+    job->pending = pending;
 
-    snprintf(filepath, 512, "%s/%s.json", g_config.cache_dir, hash);
+    if (file_io_read(&g_reads.io, fd, job->buffer, len, offset,
+                     cache_read_done, job) != 0) {
+        close(fd);
+        free(job);
+        return 0;
+    }
 
-    return filepath;
+    (*pending)++;
+    return 1;
 }
 
 /**
- * Check if cache file exists and is not expired
+ * The data itself is not needed, only that the kernel now caches its pages
  */
-static int is_cache_valid(const char* filepath, int ttl_seconds) {
-    struct stat file_stat;
-
-    /* Check if file exists */
-    if (stat(filepath, &file_stat) != 0) {
-        return 0; /* File doesn't exist */
+static void cache_read_done(void* context, ssize_t result) {
+    CacheRead* job = (CacheRead*)context;
+    if (result < 0) {
+        fprintf(stderr, "[METEO] Cache read failed: %s\n",
+                strerror((int)-result));
     }
 
-    /* Check if file is recent enough */
-    time_t now = time(NULL);
-    double age = difftime(now, file_stat.st_mtime);
+    (*job->pending)--;
+    close(job->fd);
+    free(job);
+}
 
-    if (age > ttl_seconds) {
-        return 0; /* Cache expired */
+/**
+ * Folds a finished transfer's duration into the moving average
+ */
+static void record_fetch_duration(CURL* curl) {
+    double seconds = 0.0;
+    if (curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &seconds) != CURLE_OK ||
+        seconds <= 0.0) {
+        return;
     }
 
-    return 1; /* Cache is valid */
+    if (g_fetch_seconds <= 0.0) {
+        g_fetch_seconds = seconds;
+    } else {
+        g_fetch_seconds = (1.0 - FETCH_DURATION_WEIGHT) * g_fetch_seconds +
+                          FETCH_DURATION_WEIGHT * seconds;
+    }
 }
 
 /**
- * Load weather data from cache file
+ * Load weather data from its binary record, no parsing involved
  */
-static int load_weather_from_cache(const char* filepath, WeatherData** data) {
-    json_error_t error;
-    json_t*      root = json_load_file(filepath, 0, &error);
-
-    if (!root) {
-        fprintf(stderr, "[METEO] Failed to load cache: %s\n", error.text);
+static int load_weather_from_cache(const char* key, WeatherData** data) {
+    LogStoreRecord record;
+    if (!g_store_ready || log_store_get(&g_store, key, &record) != 0) {
         return -1;
     }
 
-    /* Allocate weather data */
-    *data = (WeatherData*)calloc(1, sizeof(WeatherData));
-    if (!*data) {
-        json_decref(root);
+    WeatherData* loaded = (WeatherData*)calloc(1, sizeof(WeatherData));
+    if (!loaded) {
         return -2;
     }
 
-    /* Get current weather and units from Open-Meteo API format */
-    json_t* current       = json_object_get(root, "current");
-    json_t* current_units = json_object_get(root, "current_units");
-
-    if (!current || !current_units) {
-        fprintf(stderr,
-                "[METEO] Cache file missing 'current' or 'current_units'\n");
-        json_decref(root);
-        free(*data);
+    /* Decoded straight out of the mapped segment */
+    int result = weather_record_decode(record.value, record.value_len, loaded);
+    if (result != 0) {
+        fprintf(stderr, "[METEO] Unreadable cache record %s (%d)\n", key,
+                result);
+        free(loaded);
         return -3;
     }
 
-    /* Extract values from API format */
-    json_t* temp           = json_object_get(current, "temperature_2m");
-    json_t* temp_unit      = json_object_get(current_units, "temperature_2m");
-    json_t* windspeed      = json_object_get(current, "wind_speed_10m");
-    json_t* windspeed_unit = json_object_get(current_units, "wind_speed_10m");
-    json_t* winddirection  = json_object_get(current, "wind_direction_10m");
-    json_t* winddirection_unit =
-        json_object_get(current_units, "wind_direction_10m");
-    json_t* precipitation = json_object_get(current, "precipitation");
-    json_t* precipitation_unit =
-        json_object_get(current_units, "precipitation");
-    json_t* humidity     = json_object_get(current, "relative_humidity_2m");
-    json_t* pressure     = json_object_get(current, "surface_pressure");
-    json_t* weather_code = json_object_get(current, "weather_code");
-    json_t* is_day       = json_object_get(current, "is_day");
-    json_t* time_str     = json_object_get(current, "time");
-
-    /* Copy values */
-    if (temp)
-        (*data)->temperature = json_real_value(temp);
-    if (temp_unit)
-        strncpy((*data)->temperature_unit, json_string_value(temp_unit),
-                sizeof((*data)->temperature_unit) - 1);
-    if (windspeed)
-        (*data)->windspeed = json_real_value(windspeed);
-    if (windspeed_unit)
-        strncpy((*data)->windspeed_unit, json_string_value(windspeed_unit),
-                sizeof((*data)->windspeed_unit) - 1);
-    if (winddirection)
-        (*data)->winddirection = json_integer_value(winddirection);
-    if (winddirection_unit)
-        strncpy((*data)->winddirection_unit,
-                json_string_value(winddirection_unit),
-                sizeof((*data)->winddirection_unit) - 1);
-    if (precipitation)
-        (*data)->precipitation = json_real_value(precipitation);
-    if (precipitation_unit)
-        strncpy((*data)->precipitation_unit,
-                json_string_value(precipitation_unit),
-                sizeof((*data)->precipitation_unit) - 1);
-    if (humidity)
-        (*data)->humidity = json_real_value(humidity);
-    if (pressure)
-        (*data)->pressure = json_real_value(pressure);
-    if (weather_code)
-        (*data)->weather_code = json_integer_value(weather_code);
-    if (is_day)
-        (*data)->is_day = json_integer_value(is_day);
-
-    /* Parse timestamp */
-    if (time_str) {
-        /* For now, use current time - could parse ISO string if needed */
-        (*data)->timestamp = time(NULL);
-    }
-
-    /* Get location from API response */
-    json_t* latitude  = json_object_get(root, "latitude");
-    json_t* longitude = json_object_get(root, "longitude");
-
-    if (latitude)
-        (*data)->latitude = json_real_value(latitude);
-    if (longitude)
-        (*data)->longitude = json_real_value(longitude);
-
     /* Get city name based on coordinates */
-    open_meteo_api_get_city_name((*data)->latitude, (*data)->longitude,
-                                 (*data)->city_name,
-                                 sizeof((*data)->city_name));
+    open_meteo_api_get_city_name(loaded->latitude, loaded->longitude,
+                                 loaded->city_name, sizeof(loaded->city_name));
 
-    json_decref(root);
+    *data = loaded;
     return 0;
 }
 
 /**
- * Save raw JSON response from API to cache file
- * This preserves the original API structure (current/current_units or
- * hourly/hourly_units)
+ * Append the binary record for data to the store, with upstream's JSON next
+ * to it when keep_raw_json is set. The JSON goes first so a record is never
+ * paired with older JSON. Both are kept as long as they may still be served
+ * or compared against, stale grace windows included.
  */
-static int save_raw_json_to_cache(const char* filepath, const char* json_str) {
-    if (!filepath || !json_str) {
+static int save_weather_to_cache(const char* key, const WeatherData* data,
+                                 const char* raw_json) {
+    if (!key || !data || !g_store_ready) {
         return -1;
     }
 
-    /* Parse JSON to validate and format it */
-    json_error_t error;
-    json_t*      json = json_loadb(json_str, strlen(json_str), 0, &error);
-    if (json == NULL) {
-        fprintf(stderr, "[METEO] Invalid JSON to cache: %s\n", error.text);
-        return -2;
+    int grace = g_config.stale_while_revalidate > g_config.stale_if_error
+                    ? g_config.stale_while_revalidate
+                    : g_config.stale_if_error;
+    time_t expires_at =
+        data->fetched_at +
+        open_meteo_api_entry_ttl(data, data->latitude, data->longitude) +
+        grace;
+
+    if (g_config.keep_raw_json && raw_json) {
+        char json_key[RAW_JSON_KEY_LENGTH];
+        raw_json_key(key, json_key);
+        if (log_store_put(&g_store, json_key, raw_json, strlen(raw_json),
+                          expires_at) != 0) {
+            fprintf(stderr, "[METEO] Failed to store JSON for %s\n", key);
+            return -2;
+        }
     }
 
-    /* Save with proper formatting (2-space indent, preserve order) */
-    if (json_dump_file(json, filepath, JSON_INDENT(2) | JSON_PRESERVE_ORDER) !=
+    uint8_t record[WEATHER_RECORD_SIZE];
+    weather_record_encode(data, record);
+    if (log_store_put(&g_store, key, record, sizeof(record), expires_at) !=
         0) {
-        fprintf(stderr, "[METEO] Failed to save JSON to file: %s\n", filepath);
-        json_decref(json);
+        fprintf(stderr, "[METEO] Failed to store record for %s\n", key);
         return -3;
     }
 
-    json_decref(json);
+    if (g_config.cache_fsync == WEATHER_FSYNC_ALWAYS) {
+        flusher_request();
+    }
     return 0;
 }
 
+/**
+ * Converts the cache file the versions before the store kept for key, named
+ * <key>.json in cache_dir, into a record and deletes it. The file's mtime is
+ * when it was fetched. Returns 0 if converted, -1 if there is no such file.
+ */
+static int migrate_legacy_file(const char* key) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s" RAW_JSON_KEY_SUFFIX,
+             g_config.cache_dir, key);
+
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return -1;
+    }
+
+    json_error_t error;
+    json_t*      root   = json_load_file(path, 0, &error);
+    int          result = -2;
+
+    if (root) {
+        /* The file kept the entry's TTL scale, the record has its own field */
+        json_t* ttl_percent = json_object_get(root, LEGACY_TTL_PERCENT_KEY);
+        int     percent     = ttl_percent && json_is_integer(ttl_percent)
+                                  ? (int)json_integer_value(ttl_percent)
+                                  : 100;
+        json_object_del(root, LEGACY_TTL_PERCENT_KEY);
+
+        float latitude  = json_real_value(json_object_get(root, "latitude"));
+        float longitude = json_real_value(json_object_get(root, "longitude"));
+        char* raw_json  = json_dumps(root, JSON_COMPACT | JSON_PRESERVE_ORDER);
+        json_decref(root);
+
+        WeatherData data = {0};
+        if (raw_json &&
+            parse_weather_json(raw_json, &data, latitude, longitude) == 0) {
+            data.fetched_at  = st.st_mtime;
+            data.ttl_percent = percent;
+            result = save_weather_to_cache(key, &data, raw_json) == 0 ? 0 : -3;
+        }
+        free(raw_json);
+    } else {
+        fprintf(stderr, "[METEO] Unreadable old cache file %s: %s\n", path,
+                error.text);
+    }
+
+    if (result == 0) {
+        g_legacy.migrated++;
+    }
+    /* A file that did not convert would only be retried forever */
+    unlink(path);
+    return result;
+}
 /**
  * Build API URL with parameters
  */
@@ -611,11 +1494,77 @@ static char* build_api_url(float lat, float lon) {
              "apparent_temperature,is_day,precipitation,weather_code,"
              "surface_pressure,wind_speed_10m,wind_direction_10m"
              "&timezone=GMT",
-             API_BASE_URL, lat, lon);
+             g_config.upstream_url, lat, lon);
 
     return url;
 }
 
+/**
+ * Upstream handle from the pool, or a one-off one if the pool failed to
+ * start. Give it back with upstream_release.
+ */
+static CURL* upstream_acquire(void) {
+    if (g_upstream_ready) {
+        return curl_pool_acquire(&g_upstream);
+    }
+
+    CURL* curl = curl_easy_init();
+    if (curl && g_config.upstream_ca_file) {
+        curl_easy_setopt(curl, CURLOPT_CAINFO, g_config.upstream_ca_file);
+    }
+    return curl;
+}
+
+static void upstream_release(CURL* curl) {
+    if (g_upstream_ready) {
+        curl_pool_release(&g_upstream, curl);
+    } else {
+        curl_easy_cleanup(curl);
+    }
+}
+
+/**
+ * Asks the breaker whether an upstream request may start now. Every
+ * admitted request ends in upstream_record or circuit_breaker_cancel.
+ */
+static int upstream_admit(void) {
+    CircuitState before   = g_breaker.state;
+    int          admitted = circuit_breaker_acquire(&g_breaker, monotonic_ms());
+
+    if (g_breaker.state != before) {
+        printf("[METEO] Upstream circuit %s, probing\n",
+               circuit_breaker_state_name(g_breaker.state));
+    }
+    return admitted;
+}
+
+/**
+ * Feeds a finished request to the breaker. Only what says upstream is
+ * unwell counts as failure: no answer, 5xx and 429. Other 4xx are answers
+ * about the coordinates.
+ */
+static void upstream_record(CURL* curl, CURLcode code, long http_code) {
+    double seconds = 0.0;
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &seconds);
+
+    int success = code == CURLE_OK && http_code < 500 && http_code != 429;
+
+    CircuitState before = g_breaker.state;
+    circuit_breaker_release(&g_breaker, monotonic_ms(), success,
+                            seconds * 1000.0);
+
+    if (g_breaker.state == CIRCUIT_OPEN && before != CIRCUIT_OPEN) {
+        fprintf(stderr,
+                "[METEO] Upstream circuit opened: %.0f%% errors, %.0f ms, "
+                "retrying in %llu ms\n",
+                g_breaker.error_rate * 100.0, g_breaker.latency_ms,
+                (unsigned long long)(g_breaker.open_until - monotonic_ms()));
+    } else if (g_breaker.state == CIRCUIT_CLOSED && before != CIRCUIT_CLOSED) {
+        printf("[METEO] Upstream circuit closed, limit %.0f in flight\n",
+               g_breaker.limit);
+    }
+}
+
 /**
  * Parse weather JSON from API response
  */
@@ -686,11 +1635,21 @@ static int parse_weather_json(const char* json_str, WeatherData* data,
         data->is_day = json_integer_value(is_day);
 
     /* Parse timestamp (convert ISO string to Unix timestamp) */
-    if (time_str) {
-        /* For simplicity, use current time */
-        data->timestamp = time(NULL);
+    json_t* interval = json_object_get(current, "interval");
+    data->timestamp  = time(NULL);
+    if (time_str && json_is_string(time_str)) {
+        time_t parsed = parse_upstream_time(json_string_value(time_str));
+        if (parsed > 0) {
+            data->timestamp = parsed;
+        }
+    }
+    if (interval && json_is_integer(interval)) {
+        data->interval = (int)json_integer_value(interval);
     }
 
+    data->fetched_at  = time(NULL);
+    data->ttl_percent = 100;
+
     /* Set location */
     data->latitude  = lat;
     data->longitude = lon;
@@ -709,17 +1668,31 @@ static int fetch_weather_from_api(Location* location, WeatherData** data) {
     CURLcode    res;
     MemoryChunk chunk = {0};
 
+    /* Fail at once rather than wait on an upstream known to be failing */
+    if (!upstream_admit()) {
+        if (g_breaker.state == CIRCUIT_CLOSED) {
+            printf("[METEO] Upstream at its limit of %u, not fetching\n",
+                   g_breaker.in_flight);
+        } else {
+            printf("[METEO] Upstream circuit %s, not fetching\n",
+                   circuit_breaker_state_name(g_breaker.state));
+        }
+        return OPEN_METEO_API_ERROR_UNAVAILABLE;
+    }
+
     /* Build API URL */
     char* url = build_api_url(location->latitude, location->longitude);
     if (!url) {
+        circuit_breaker_cancel(&g_breaker);
         return -1;
     }
 
     printf("[METEO] Fetching: %s\n", url);
 
-    /* Initialize curl */
-    curl = curl_easy_init();
+    /* Take a pooled handle, likely with a connection ready */
+    curl = upstream_acquire();
     if (!curl) {
+        circuit_breaker_cancel(&g_breaker);
         free(url);
         return -2;
     }
@@ -734,9 +1707,13 @@ static int fetch_weather_from_api(Location* location, WeatherData** data) {
     /* Perform request */
     res = curl_easy_perform(curl);
 
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    upstream_record(curl, res, http_code);
+
     if (res != CURLE_OK) {
         fprintf(stderr, "[METEO] CURL error: %s\n", curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
+        upstream_release(curl);
         free(url);
         if (chunk.data)
             free(chunk.data);
@@ -744,18 +1721,20 @@ static int fetch_weather_from_api(Location* location, WeatherData** data) {
     }
 
     /* Check HTTP status */
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
     if (http_code != 200) {
         fprintf(stderr, "[METEO] HTTP error: %ld\n", http_code);
-        curl_easy_cleanup(curl);
+        upstream_release(curl);
         free(url);
         if (chunk.data)
             free(chunk.data);
-        return -4;
+        /* 4xx means the request itself is bad, asking again will not help */
+        return http_code >= 400 && http_code < 500
+                   ? OPEN_METEO_API_ERROR_REJECTED
+                   : OPEN_METEO_API_ERROR_UPSTREAM;
     }
 
-    curl_easy_cleanup(curl);
+    record_fetch_duration(curl);
+    upstream_release(curl);
     free(url);
 
     /* Allocate weather data */
@@ -786,3 +1765,479 @@ static int fetch_weather_from_api(Location* location, WeatherData** data) {
     printf("[METEO] Successfully fetched weather data\n");
     return 0;
 }
+
+/**
+ * Parses Open-Meteo's "2025-01-31T14:15" (GMT, we request timezone=GMT),
+ * returns 0 if the value does not parse
+ */
+static time_t parse_upstream_time(const char* value) {
+    struct tm tm = {0};
+    if (!value || sscanf(value, "%4d-%2d-%2dT%2d:%2d:%2d", &tm.tm_year,
+                         &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min,
+                         &tm.tm_sec) < 5) {
+        return 0;
+    }
+
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+
+    return timegm(&tm);
+}
+
+/**
+ * Drives the background refreshes, never blocks
+ */
+static void refresh_task_work(void* context, uint64_t mon_time) {
+    (void)context;
+    (void)mon_time;
+
+    int running = 0;
+    curl_multi_perform(g_refresh.multi, &running);
+
+    CURLMsg* msg;
+    int      queued = 0;
+    while ((msg = curl_multi_info_read(g_refresh.multi, &queued)) != NULL) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        RefreshJob* job = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&job);
+        if (job) {
+            refresh_job_finish(job, msg->data.result);
+        }
+    }
+
+    /* Nothing left to drive, the task comes back with the next refresh */
+    if (g_refresh.jobs.size == 0 && g_refresh.task) {
+        smw_destroy_task(g_refresh.task);
+        g_refresh.task = NULL;
+    }
+}
+
+/**
+ * Validates and stores a finished refresh, then tells the listener
+ */
+static void refresh_job_finish(RefreshJob* job, CURLcode code) {
+    long http_code = 0;
+    curl_easy_getinfo(job->curl, CURLINFO_RESPONSE_CODE, &http_code);
+    upstream_record(job->curl, code, http_code);
+
+    int result = -1;
+    if (code != CURLE_OK) {
+        fprintf(stderr, "[METEO] Background refresh failed: %s\n",
+                curl_easy_strerror(code));
+    } else if (http_code != 200) {
+        fprintf(stderr, "[METEO] Background refresh HTTP error: %ld\n",
+                http_code);
+    } else if (job->chunk.data) {
+        record_fetch_duration(job->curl);
+
+        /* Only replace the cache file with data that parses */
+        WeatherData check = {0};
+        if (parse_weather_json(job->chunk.data, &check, job->latitude,
+                               job->longitude) == 0) {
+            WeatherData* previous = NULL;
+            if (load_weather_from_cache(job->cache_key, &previous) != 0) {
+                previous = NULL;
+            }
+            apply_ttl_policy(&check, previous);
+            open_meteo_api_free_current(previous);
+
+            if (save_weather_to_cache(job->cache_key, &check,
+                                      job->chunk.data) == 0) {
+                printf("[METEO] Background refresh saved to cache\n");
+                result = 0;
+            }
+        }
+    }
+
+    intrusive_list_remove(&g_refresh.jobs, &job->hook);
+
+    float latitude  = job->latitude;
+    float longitude = job->longitude;
+    refresh_job_free(job);
+
+    if (g_refresh.callback) {
+        g_refresh.callback(latitude, longitude, result);
+    }
+}
+
+/**
+ * Runs the configured TTL policy on freshly fetched data and stores the
+ * clamped result in it
+ */
+static void apply_ttl_policy(WeatherData* data, const WeatherData* previous) {
+    int percent = 100;
+    if (g_config.ttl_policy) {
+        percent = g_config.ttl_policy(data, previous);
+        if (percent < g_config.ttl_percent_min) {
+            percent = g_config.ttl_percent_min;
+        } else if (percent > g_config.ttl_percent_max) {
+            percent = g_config.ttl_percent_max;
+        }
+    }
+
+    if (percent != 100) {
+        printf("[METEO] TTL policy: weather code %d, TTL at %d%%\n",
+               data->weather_code, percent);
+    }
+    data->ttl_percent = percent;
+}
+
+/**
+ * Reclaims expired and superseded records a segment at a time
+ */
+static void compaction_task_work(void* context, uint64_t mon_time) {
+    (void)context;
+
+    if (g_config.cache_fsync == WEATHER_FSYNC_PERIODIC &&
+        mon_time >= g_compaction.next_flush) {
+        g_compaction.next_flush =
+            mon_time + (uint64_t)g_config.cache_fsync_period_ms;
+        flusher_request();
+    }
+
+    if (mon_time < g_compaction.next_run) {
+        return;
+    }
+    g_compaction.next_run = mon_time + STORE_COMPACT_PERIOD_MS;
+
+    if (log_store_compact_step(&g_store, time(NULL)) < 0) {
+        fprintf(stderr, "[METEO] Cache compaction failed\n");
+    }
+
+    if (g_legacy.dir) {
+        migrate_legacy_batch();
+    }
+}
+
+/**
+ * Starts the flusher thread unless nothing is ever synced. Without it writes
+ * are still safe, just left to the kernel.
+ */
+static void flusher_start(void) {
+    if (g_config.cache_fsync == WEATHER_FSYNC_NONE) {
+        return;
+    }
+
+    g_flusher.stop = 0;
+    if (pthread_create(&g_flusher.thread, NULL, flusher_work, NULL) == 0) {
+        g_flusher.running = 1;
+    } else {
+        fprintf(stderr, "[METEO] Cache flusher not started, not syncing\n");
+    }
+}
+
+/**
+ * Queues every segment written since the last request. Only waits for the
+ * lock, which the flusher never holds while syncing.
+ */
+static void flusher_request(void) {
+    if (!g_flusher.running) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_flusher.lock);
+    size_t taken =
+        log_store_take_dirty(&g_store, g_flusher.fds + g_flusher.count,
+                             FLUSH_MAX_FILES - g_flusher.count);
+    g_flusher.count += taken;
+    if (taken > 0) {
+        pthread_cond_signal(&g_flusher.wake);
+    }
+    pthread_mutex_unlock(&g_flusher.lock);
+}
+
+/**
+ * Lets the flusher finish what is queued and joins it
+ */
+static void flusher_stop(void) {
+    if (!g_flusher.running) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_flusher.lock);
+    g_flusher.stop = 1;
+    pthread_cond_signal(&g_flusher.wake);
+    pthread_mutex_unlock(&g_flusher.lock);
+
+    pthread_join(g_flusher.thread, NULL);
+    g_flusher.running = 0;
+    printf("[METEO] Cache flusher stopped, %llu files synced\n",
+           (unsigned long long)g_flusher.synced);
+}
+
+static void* flusher_work(void* context) {
+    (void)context;
+
+    int fds[FLUSH_MAX_FILES];
+    for (;;) {
+        pthread_mutex_lock(&g_flusher.lock);
+        while (g_flusher.count == 0 && !g_flusher.stop) {
+            pthread_cond_wait(&g_flusher.wake, &g_flusher.lock);
+        }
+        size_t count = g_flusher.count;
+        int    stop  = g_flusher.stop;
+        memcpy(fds, g_flusher.fds, count * sizeof(int));
+        g_flusher.count = 0;
+        pthread_mutex_unlock(&g_flusher.lock);
+
+        /* Mapped pages are file pages, syncing the file writes them out */
+        for (size_t i = 0; i < count; i++) {
+            if (fdatasync(fds[i]) != 0) {
+                fprintf(stderr, "[METEO] Cache fsync failed\n");
+            }
+            close(fds[i]);
+            __atomic_fetch_add(&g_flusher.synced, 1, __ATOMIC_RELAXED);
+        }
+
+        if (stop && count == 0) {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * Converts the next few old cache files, so an upgraded server empties its
+ * cache directory without stalling on it
+ */
+static void migrate_legacy_batch(void) {
+    for (int i = 0; i < LEGACY_MIGRATION_BATCH; i++) {
+        struct dirent* entry = readdir(g_legacy.dir);
+        if (!entry) {
+            if (g_legacy.migrated > 0) {
+                printf("[METEO] Converted %zu old cache files\n",
+                       g_legacy.migrated);
+            }
+            legacy_close();
+            return;
+        }
+
+        char key[HASH_MD5_STRING_LENGTH];
+        if (legacy_key(entry->d_name, key)) {
+            migrate_legacy_file(key);
+        }
+    }
+}
+
+/**
+ * Lists the cache directory once to learn which old files exist. Without any
+ * the directory is not kept open and misses never look for files.
+ */
+static void legacy_open(void) {
+    DIR* dir = opendir(g_config.cache_dir);
+    if (!dir) {
+        return;
+    }
+
+    char           key[HASH_MD5_STRING_LENGTH];
+    size_t         count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        count += legacy_key(entry->d_name, key);
+    }
+    if (count == 0) {
+        closedir(dir);
+        return;
+    }
+
+    /* Without the filter every miss looks for a file, still correct */
+    rewinddir(dir);
+    if (bloom_filter_initiate(&g_legacy.files, count, 0) == 0) {
+        while ((entry = readdir(dir)) != NULL) {
+            if (legacy_key(entry->d_name, key)) {
+                bloom_filter_add(&g_legacy.files, legacy_hash(key));
+            }
+        }
+        rewinddir(dir);
+    }
+
+    printf("[METEO] %zu old cache files to convert\n", count);
+    g_legacy.dir = dir;
+}
+
+static void legacy_close(void) {
+    if (g_legacy.dir) {
+        closedir(g_legacy.dir);
+        g_legacy.dir = NULL;
+    }
+    bloom_filter_dispose(&g_legacy.files);
+}
+
+/**
+ * Old files are named <md5>.json, the store's own files are not. Copies the
+ * key of an old file's name to key and returns 1, returns 0 for other names.
+ */
+static int legacy_key(const char* name, char* key) {
+    if (strlen(name) != RAW_JSON_KEY_LENGTH - 1 ||
+        strcmp(name + HASH_MD5_STRING_LENGTH - 1, RAW_JSON_KEY_SUFFIX) != 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < HASH_MD5_STRING_LENGTH - 1; i++) {
+        if (!isxdigit((unsigned char)name[i])) {
+            return 0;
+        }
+        key[i] = name[i];
+    }
+    key[HASH_MD5_STRING_LENGTH - 1] = '\0';
+    return 1;
+}
+
+/**
+ * The key is an MD5 already, its first 16 hex digits make a good hash
+ */
+static uint64_t legacy_hash(const char* key) {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < 16; i++) {
+        int c = tolower((unsigned char)key[i]);
+        hash  = hash << 4 | (uint64_t)(isdigit(c) ? c - '0' : c - 'a' + 10);
+    }
+    return hash;
+}
+
+static int legacy_may_exist(const char* key) {
+    if (!g_legacy.dir) {
+        return 0;
+    }
+    return !g_legacy.files.blocks ||
+           bloom_filter_may_contain(&g_legacy.files, legacy_hash(key));
+}
+
+static uint64_t monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+/**
+ * Keeps a record if it may still be served. JSON blobs and records stored
+ * under other coordinates than their own, such as converted old cache
+ * files, are skipped.
+ */
+static int warm_up_scan_record(const char* key, size_t key_len,
+                               const LogStoreRecord* record, void* context) {
+    WarmWorker* worker = context;
+
+    WeatherData data;
+    if (key_len != HASH_MD5_STRING_LENGTH - 1 ||
+        weather_record_decode(record->value, record->value_len, &data) != 0) {
+        return 0;
+    }
+
+    char own_key[HASH_MD5_STRING_LENGTH];
+    if (generate_cache_key(data.latitude, data.longitude, own_key) != 0 ||
+        memcmp(own_key, key, key_len) != 0) {
+        return 0;
+    }
+
+    int grace = g_config.stale_while_revalidate > g_config.stale_if_error
+                    ? g_config.stale_while_revalidate
+                    : g_config.stale_if_error;
+    int ttl   = open_meteo_api_entry_ttl(&data, data.latitude, data.longitude);
+    if (time(NULL) > data.fetched_at + ttl + grace) {
+        return 0;
+    }
+
+    if (worker->count == worker->capacity) {
+        size_t         capacity = worker->capacity ? worker->capacity * 2 : 64;
+        WarmCandidate* grown =
+            realloc(worker->candidates, capacity * sizeof(WarmCandidate));
+        if (!grown) {
+            worker->failed = 1;
+            return 1;
+        }
+        worker->candidates = grown;
+        worker->capacity   = capacity;
+    }
+
+    WarmCandidate* candidate = &worker->candidates[worker->count++];
+    memcpy(candidate->key, own_key, sizeof(candidate->key));
+    candidate->fetched_at = data.fetched_at;
+
+    /* Past the budget the scan stops, with what it found so far */
+    return (worker->count & 63) == 0 && monotonic_ms() >= worker->deadline;
+}
+
+static void* warm_up_scan(void* context) {
+    WarmWorker* worker = context;
+    log_store_scan(&g_store, worker->part, worker->parts, warm_up_scan_record,
+                   worker);
+    return NULL;
+}
+
+/**
+ * Loads and renders candidates until none are left or time runs out. Only
+ * reads the store, so the threads need no lock besides claiming work.
+ */
+static void* warm_up_render(void* context) {
+    WarmWorker* worker = context;
+
+    while (monotonic_ms() < worker->deadline) {
+        size_t i = __atomic_fetch_add(worker->next, 1, __ATOMIC_RELAXED);
+        if (i >= worker->chosen_count) {
+            break;
+        }
+
+        LogStoreRecord record;
+        WeatherData*   data = calloc(1, sizeof(WeatherData));
+        if (!data ||
+            log_store_read(&g_store, worker->chosen[i].key, &record) != 0 ||
+            weather_record_decode(record.value, record.value_len, data) !=
+                0) {
+            free(data);
+            continue;
+        }
+        open_meteo_api_get_city_name(data->latitude, data->longitude,
+                                     data->city_name, sizeof(data->city_name));
+        data->cache_status = WEATHER_CACHE_HIT;
+
+        OpenMeteoWarmEntry* entry = &worker->entries[i];
+        entry->data               = data;
+        entry->ttl  = open_meteo_api_entry_ttl(data, data->latitude,
+                                               data->longitude);
+        entry->body = open_meteo_api_build_json_response(data, data->latitude,
+                                                         data->longitude);
+    }
+    return NULL;
+}
+
+/**
+ * Runs work on every worker, each in its own thread. A worker whose thread
+ * could not be started runs on the caller's.
+ */
+static void warm_up_run(WarmWorker* workers, size_t count,
+                        void* (*work)(void*)) {
+    int started[WARMUP_MAX_THREADS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        started[i] =
+            pthread_create(&workers[i].thread, NULL, work, &workers[i]) == 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (started[i]) {
+            pthread_join(workers[i].thread, NULL);
+        } else {
+            work(&workers[i]);
+        }
+    }
+}
+
+/* Newest first */
+static int compare_candidates(const void* a, const void* b) {
+    time_t left  = ((const WarmCandidate*)a)->fetched_at;
+    time_t right = ((const WarmCandidate*)b)->fetched_at;
+    return left > right ? -1 : left < right;
+}
+
+static void refresh_job_free(RefreshJob* job) {
+    if (job->curl) {
+        if (g_refresh.multi) {
+            curl_multi_remove_handle(g_refresh.multi, job->curl);
+        }
+        upstream_release(job->curl);
+    }
+    free(job->chunk.data);
+    free(job->url);
+    free(job);
+}
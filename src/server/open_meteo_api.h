@@ -6,9 +6,21 @@
 #include <stdbool.h>
 #include <time.h>
 
+/* Where the data came from */
+typedef enum {
+    WEATHER_CACHE_MISS,        /* Fetched from Open-Meteo */
+    WEATHER_CACHE_HIT,         /* Fresh cache entry */
+    WEATHER_CACHE_STALE,       /* Past its TTL, a refresh is running */
+    WEATHER_CACHE_STALE_ERROR, /* Past its TTL, upstream failed */
+} WeatherCacheStatus;
+
 /* Weather data structure */
 typedef struct {
-    time_t timestamp;
+    time_t timestamp;  /* Start of the upstream interval, current.time */
+    int    interval;   /* Upstream update interval in seconds, 0 if unknown */
+    time_t fetched_at; /* When the data was fetched from Open-Meteo */
+    WeatherCacheStatus cache_status;
+    int    ttl_percent; /* TTL scale chosen by the TTL policy, 100 keeps it */
     int    weather_code;
 
     double temperature;
@@ -35,6 +47,32 @@ typedef struct {
     char* _raw_json_cache;
 } WeatherData;
 
+/* Decides how long data stays fresh relative to the normal TTL, returning a
+ * percentage: above 100 keeps it longer, below 100 refreshes it sooner.
+ * previous is the data being replaced, NULL if there was none. */
+typedef int (*OpenMeteoTtlPolicy)(const WeatherData* data,
+                                  const WeatherData* previous);
+
+/* When the disk cache is flushed to stable storage. Flushing always happens
+ * on a background thread, so requests never wait for the disk. */
+typedef enum {
+    WEATHER_FSYNC_NONE,     /* Left to the kernel's writeback */
+    WEATHER_FSYNC_PERIODIC, /* Every cache_fsync_period_ms */
+    WEATHER_FSYNC_ALWAYS,   /* After every write */
+} WeatherFsyncPolicy;
+
+/* open_meteo_api_get_current errors the caller may want to tell apart */
+#define OPEN_METEO_API_ERROR_UPSTREAM -3 /* Unreachable or failing */
+#define OPEN_METEO_API_ERROR_REJECTED -4 /* Upstream refused the location */
+#define OPEN_METEO_API_ERROR_UNAVAILABLE -5 /* Not asked, breaker refused */
+
+/* A cached location loaded by open_meteo_api_warm_up */
+typedef struct {
+    WeatherData* data; /* Free with open_meteo_api_free_current */
+    char*        body; /* Rendered response, free with free */
+    int          ttl;  /* open_meteo_api_entry_ttl of data */
+} OpenMeteoWarmEntry;
+
 /* Location structure */
 typedef struct {
     float       latitude;
@@ -47,14 +85,140 @@ typedef struct {
     const char* cache_dir;
     int         cache_ttl;
     bool        use_cache;
+
+    /* Keep upstream's JSON next to each binary record and answer with it, so
+     * clients see every field upstream sent. Without it responses are built
+     * from the record alone. */
+    bool keep_raw_json;
+
+    /* Disk cache limits, 0 for none: bytes on disk and cached locations.
+     * Past either the oldest entries are evicted in the background. */
+    size_t cache_max_bytes;
+    int    cache_max_entries;
+
+    /* How much a crash may lose of what was written to the disk cache */
+    WeatherFsyncPolicy cache_fsync;
+    int                cache_fsync_period_ms;
+
+    /* Disk reads for cache lookups kept in flight at once, so requests whose
+     * entry is not in memory wait for it without blocking the others. 0
+     * reads the disk cache synchronously. */
+    int cache_read_depth;
+
+    /* Startup warm-up of the in-memory cache from disk: threads to load it
+     * with, 0 disables it, and how long startup may wait for it */
+    int warmup_threads;
+    int warmup_budget_ms;
+
+    /* Grace windows after cache_ttl, in seconds. Within
+     * stale_while_revalidate stale data is served at once while a background
+     * refresh runs, within stale_if_error it is served when upstream fails.
+     * 0 disables a window. */
+    int stale_while_revalidate;
+    int stale_if_error;
+
+    /* How long failures are remembered so a client retrying in a loop does
+     * not reach upstream: negative_ttl after upstream failed, rejected_ttl
+     * after it refused the coordinates. 0 disables negative caching. */
+    int negative_ttl;
+    int rejected_ttl;
+
+    /* Spread of each entry's TTL around cache_ttl, in percent, so entries
+     * written together do not expire together */
+    int cache_ttl_jitter;
+
+    /* Evaluated once per fetch, NULL keeps every TTL as is. The result is
+     * clamped to [ttl_percent_min, ttl_percent_max] and no TTL grows past
+     * cache_ttl_max seconds. */
+    OpenMeteoTtlPolicy ttl_policy;
+    int                ttl_percent_min;
+    int                ttl_percent_max;
+    int                cache_ttl_max;
+
+    /* XFetch early refresh aggressiveness, 0 disables it. 1.0 refreshes
+     * shortly before expiry, scaled by the measured fetch duration. */
+    double xfetch_beta;
+
+    /* Background prefetch of the most requested locations: how many to keep
+     * warm, how many seconds before expiry to refresh them and how many
+     * upstream requests per minute prefetching may spend. 0 disables it. */
+    int prefetch_top_k;
+    int prefetch_lead;
+    int prefetch_budget;
+
+    /* Response compression: gzip/brotli level 1-9 and the smallest body
+     * worth compressing, in bytes */
+    int    compression_level;
+    size_t compression_min_size;
+
+    /* Upstream forecast endpoint, NULL for Open-Meteo's, and the CA bundle
+     * to verify it with, NULL for the system's. Connections, DNS answers and
+     * TLS sessions are reused across requests through upstream_handles
+     * pooled curl handles. upstream_http2 negotiates HTTP/2 so concurrent
+     * refreshes share one connection. */
+    const char* upstream_url;
+    const char* upstream_ca_file;
+    int         upstream_handles;
+    bool        upstream_http2;
+
+    /* Circuit breaker around upstream. It opens once the moving average of
+     * failures reaches upstream_error_percent or that of latency reaches
+     * upstream_latency_ms, 0 disables either trigger. While open, misses
+     * fail at once or get stale data and nothing is sent upstream; after
+     * upstream_open_ms, longer while upstream stays down, probes decide
+     * whether it closes. Requests in flight are limited adaptively, up to
+     * upstream_max_in_flight. */
+    int upstream_error_percent;
+    int upstream_latency_ms;
+    int upstream_open_ms;
+    int upstream_max_in_flight;
 } WeatherConfig;
 
+/* Fills config with the defaults of every field, the single place they are
+ * defined. Start from these and change what differs. */
+void open_meteo_api_default_config(WeatherConfig* config);
+
 /* Initialize weather API */
 int open_meteo_api_init(WeatherConfig* config);
 
-/* Get current weather for location */
+/* Get the active configuration */
+const WeatherConfig* open_meteo_api_get_config(void);
+
+/* Get current weather for location. Returns 0 on success,
+ * OPEN_METEO_API_ERROR_UPSTREAM or OPEN_METEO_API_ERROR_REJECTED when the
+ * fetch failed, OPEN_METEO_API_ERROR_UNAVAILABLE when upstream was not asked
+ * and another negative value on local errors. */
 int open_meteo_api_get_current(Location* location, WeatherData** data);
 
+/* Seconds data stays fresh after fetched_at. When upstream reported its
+ * interval this runs to the next interval boundary, when new data exists,
+ * plus a little jitter. Otherwise it is cache_ttl with jitter either way.
+ * Both are scaled by the entry's ttl_percent: calm entries skip part of the
+ * next interval, volatile ones lose their jitter. */
+int open_meteo_api_entry_ttl(const WeatherData* data, float lat, float lon);
+
+/* Default TTL policy. Calm, unchanging weather (dry, light wind, steady
+ * pressure) keeps longer, thunderstorms, heavy precipitation and strong wind
+ * are refreshed sooner. */
+int open_meteo_api_ttl_policy_volatility(const WeatherData* data,
+                                         const WeatherData* previous);
+
+/* XFetch: returns 1 if an entry of this age should be refreshed before it
+ * expires. Each call draws a new random number, so among many requests for a
+ * hot entry only a few, usually one, trigger the refresh. */
+int open_meteo_api_should_refresh_early(time_t age, int ttl);
+
+/* Called when a background refresh finished, result is 0 on success */
+typedef void (*OpenMeteoRefreshCallback)(float lat, float lon, int result);
+
+void open_meteo_api_set_refresh_callback(OpenMeteoRefreshCallback callback);
+
+/* Starts a non-blocking refresh of the cache file for location, driven by an
+ * smw task. Returns 0 when started, 1 if one is already running for that
+ * location, 2 if upstream is not being asked now (circuit open or at its
+ * concurrency limit) and negative on error. */
+int open_meteo_api_refresh_async(const Location* location);
+
 /* Free weather data */
 void open_meteo_api_free_current(WeatherData* data);
 
@@ -68,7 +232,25 @@ const char* open_meteo_api_get_description(int weather_code);
 char* open_meteo_api_build_json_response(WeatherData* data, float lat,
                                          float lon);
 
-/* Parse query parameters: lat=X&long=Y or lat=X&lon=Y */
+/* Returns 1 if looking location up in the disk cache will not wait for the
+ * disk, starting reads of the missing parts otherwise and returning 0. Call
+ * again on a later pass of the loop until it returns 1. */
+int open_meteo_api_cache_ready(float lat, float lon);
+
+/* Loads up to max_entries cached locations that may still be served, most
+ * recently fetched first, and renders their responses. The work is spread
+ * over warmup_threads threads and stops after warmup_budget_ms, keeping what
+ * was done by then. Must run before requests are served. Returns the number
+ * of entries in *entries, a malloc'd array the caller frees, or negative on
+ * error. */
+int open_meteo_api_warm_up(size_t max_entries, OpenMeteoWarmEntry** entries);
+
+/* Describe the disk cache: size, limits and eviction counters. Returns an
+ * allocated JSON string (caller must free), NULL on error. */
+char* open_meteo_api_cache_stats_json(void);
+
+/* Parse query parameters: lat=X&long=Y or lat=X&lon=Y. Returns -1 if a
+ * value is missing or not a number and -2 if it is out of range. */
 int open_meteo_api_parse_query(const char* query, float* lat, float* lon);
 
 /* Get city name from coordinates using reverse geocoding */
@@ -3,8 +3,13 @@
 
 #include "open_meteo_handler.h"
 
+#include "cache.h"
 #include "open_meteo_api.h"
+#include "smw.h"
+#include "space_saving.h"
+#include "weather_key.h"
 
+#include <jansson.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +18,36 @@
 #define HTTP_OK 200
 #define HTTP_BAD_REQUEST 400
 #define HTTP_INTERNAL_ERROR 500
+#define HTTP_SERVICE_UNAVAILABLE 503
+
+/* In-memory responses keyed by WeatherKey, created on first use */
+static Cache* g_response_cache = NULL;
+
+/* Request popularity and the task keeping the most popular keys warm */
+static struct {
+    SpaceSaving sketch;
+    SmwTask*    task;
+    uint64_t    next_run;
+    uint64_t    next_decay;
+    uint64_t    last_refill;
+    double      tokens; /* Upstream requests prefetching may still spend */
+    uint64_t    started; /* Refreshes started by prefetching */
+} g_prefetch = {0};
+
+static WeatherResponse* weather_response_create(int status_code, char* body,
+                                                time_t fetched_at);
+static WeatherResponse* weather_response_create_tagged(
+    int status_code, char* body, time_t fetched_at, const unsigned char* md5);
+static WeatherResponse* build_current_response(float lat, float lon,
+                                               WeatherCacheStatus* status,
+                                               int*                error);
+static WeatherResponse* build_failure_response(int error);
+static Cache*           response_cache_get(void);
+static void on_refresh_done(float lat, float lon, int result);
+static int  start_refresh(float lat, float lon);
+static void prefetch_task_work(void* context, uint64_t mon_time);
+static void cache_store_response(WeatherKey key, WeatherResponse* response);
+static void warm_up_response_cache(void);
 
 /* Build error JSON response */
 static char* build_error_response(const char* error_msg, int code) {
@@ -34,11 +69,39 @@ static char* build_error_response(const char* error_msg, int code) {
 
 /* Initialize weather server module */
 int open_meteo_handler_init(void) {
-    WeatherConfig config = {.cache_dir = "./cache/",
-                            .cache_ttl = 900, /* 15 minutes */
-                            .use_cache = true};
+    /* Tuning defaults live in open_meteo_api.c, set only what differs */
+    WeatherConfig config;
+    open_meteo_api_default_config(&config);
+    config.cache_dir = "./cache/";
+
+    /* Points the server at another upstream, a local stub in tests. NULL
+     * keeps Open-Meteo and the system's CA bundle. */
+    config.upstream_url     = getenv("WEATHER_UPSTREAM_URL");
+    config.upstream_ca_file = getenv("WEATHER_UPSTREAM_CA_FILE");
+
+    open_meteo_api_set_refresh_callback(on_refresh_done);
+
+    int result = open_meteo_api_init(&config);
+    if (result != 0) {
+        return result;
+    }
+
+    if (config.prefetch_top_k > 0) {
+        /* Spare counters keep the top-k stable under churn in the tail */
+        if (space_saving_initiate(&g_prefetch.sketch,
+                                  (size_t)config.prefetch_top_k * 4) != 0) {
+            return -2;
+        }
+        g_prefetch.tokens = config.prefetch_budget;
+        g_prefetch.task   = smw_create_task(NULL, prefetch_task_work);
+    }
+
+    /* Runs before the listener exists, so requests never see a cold cache */
+    if (config.use_cache && config.warmup_threads > 0) {
+        warm_up_response_cache();
+    }
 
-    return open_meteo_api_init(&config);
+    return 0;
 }
 
 /* Handle GET /v1/current endpoint */
@@ -51,17 +114,533 @@ int open_meteo_handler_current(const char* query_string, char** response_json,
     *response_json = NULL;
     *status_code   = HTTP_INTERNAL_ERROR;
 
+    WeatherResponse* response = NULL;
+    int              result =
+        open_meteo_handler_current_response(query_string, &response, NULL);
+    if (!response) {
+        return -1;
+    }
+
+    *response_json = strdup(response->body);
+    *status_code   = response->status_code;
+    weather_response_release(response);
+
+    return *response_json ? result : -1;
+}
+
+/* Handle GET /v1/current endpoint, sharing cached responses */
+int open_meteo_handler_current_response(const char*         query_string,
+                                        WeatherResponse**   response,
+                                        WeatherCacheStatus* cache_status) {
+    if (!response) {
+        return -1;
+    }
+
+    WeatherCacheStatus unused_status;
+    if (!cache_status) {
+        cache_status = &unused_status;
+    }
+
+    *response     = NULL;
+    *cache_status = WEATHER_CACHE_MISS;
+
     /* Parse query parameters */
     float lat, lon;
-    if (open_meteo_api_parse_query(query_string, &lat, &lon) != 0) {
-        *response_json =
-            build_error_response("Invalid query parameters. Expected format: "
-                                 "lat=XX.XXXX&long=YY.YYYY",
-                                 HTTP_BAD_REQUEST);
-        *status_code = HTTP_BAD_REQUEST;
+    int   parsed = open_meteo_api_parse_query(query_string, &lat, &lon);
+    if (parsed != 0) {
+        *response = weather_response_create(
+            HTTP_BAD_REQUEST,
+            build_error_response(
+                parsed == -2 ? "Coordinates out of range. Expected lat in "
+                               "[-90, 90] and lon in [-180, 180]"
+                             : "Invalid query parameters. Expected format: "
+                               "lat=XX.XXXX&long=YY.YYYY",
+                HTTP_BAD_REQUEST),
+            time(NULL));
         return -1;
     }
 
+    const WeatherConfig* config = open_meteo_api_get_config();
+
+    WeatherKey key = weather_key_make(lat, lon);
+
+    WeatherResponse* cached = NULL;
+    time_t           age    = 0;
+    if (config->use_cache && g_response_cache) {
+        cached = cache_peek_id(g_response_cache, key, NULL);
+    }
+
+    /* Not in memory, come back once the disk cache has it there too */
+    if (!cached && !open_meteo_api_cache_ready(lat, lon)) {
+        return OPEN_METEO_HANDLER_PENDING;
+    }
+
+    if (g_prefetch.task) {
+        space_saving_increment(&g_prefetch.sketch, key);
+    }
+
+    if (cached && cached->status_code != HTTP_OK) {
+        /* A remembered failure, upstream is not asked again until it expires */
+        time_t now = time(NULL);
+        if (now <= cached->fetched_at + cached->ttl) {
+            weather_response_retain(cached);
+            *response     = cached;
+            *cache_status = WEATHER_CACHE_HIT;
+            return -1;
+        }
+        cached = NULL;
+    }
+
+    if (cached) {
+        time_t now = time(NULL);
+        age        = now > cached->fetched_at ? now - cached->fetched_at : 0;
+
+        if (age <= cached->ttl) {
+            /* Hot entries get refreshed just before they expire */
+            if (open_meteo_api_should_refresh_early(age, cached->ttl)) {
+                start_refresh(lat, lon);
+            }
+
+            weather_response_retain(cached);
+            *response     = cached;
+            *cache_status = WEATHER_CACHE_HIT;
+            return 0;
+        }
+
+        /* Serve the old body now, the refresh drops it once it lands */
+        if (age <= cached->ttl + config->stale_while_revalidate) {
+            start_refresh(lat, lon);
+
+            weather_response_retain(cached);
+            *response     = cached;
+            *cache_status = WEATHER_CACHE_STALE;
+            return 0;
+        }
+
+        /* Too old to serve outright, but still good as an error fallback */
+        weather_response_retain(cached);
+    }
+
+    int              error = 0;
+    WeatherResponse* built =
+        build_current_response(lat, lon, cache_status, &error);
+    if (!built) {
+        if (cached && age <= cached->ttl + config->stale_if_error) {
+            printf("[METEO] Serving stale response (%lds old) after error\n",
+                   (long)age);
+            *response     = cached;
+            *cache_status = WEATHER_CACHE_STALE_ERROR;
+            return 0;
+        }
+        if (cached) {
+            weather_response_release(cached);
+        }
+
+        *response = build_failure_response(error);
+        if (*response && (*response)->ttl > 0 && response_cache_get()) {
+            weather_response_retain(*response);
+            cache_insert_id(g_response_cache, key, *response,
+                            (*response)->body_len, (*response)->ttl);
+        }
+        return -1;
+    }
+
+    if (cached) {
+        weather_response_release(cached);
+    }
+
+    cache_store_response(key, built);
+
+    *response = built;
+    return 0;
+}
+
+const void* weather_response_body(WeatherResponse* response,
+                                  unsigned accepted, HttpEncoding* encoding,
+                                  size_t* len) {
+    const WeatherConfig* config = open_meteo_api_get_config();
+
+    for (int i = HTTP_ENCODING_IDENTITY + 1; i < HTTP_ENCODING_COUNT; i++) {
+        unsigned bit = HTTP_ENCODING_BIT(i);
+        if (!(accepted & bit) || (response->encoded_tried & bit)) {
+            continue;
+        }
+
+        /* Only try once, a failed or skipped variant stays identity */
+        response->encoded_tried |= bit;
+        if (response->body_len < config->compression_min_size ||
+            !http_encoding_supported((HttpEncoding)i)) {
+            continue;
+        }
+
+        uint8_t* data = NULL;
+        size_t   size = 0;
+        if (http_encoding_compress((HttpEncoding)i, config->compression_level,
+                                   response->body, response->body_len, &data,
+                                   &size) == 0) {
+            if (size < response->body_len) {
+                response->encoded[i]     = data;
+                response->encoded_len[i] = size;
+            } else {
+                free(data);
+            }
+        }
+    }
+
+    unsigned available = HTTP_ENCODING_BIT(HTTP_ENCODING_IDENTITY);
+    for (int i = HTTP_ENCODING_IDENTITY + 1; i < HTTP_ENCODING_COUNT; i++) {
+        if (response->encoded[i]) {
+            available |= HTTP_ENCODING_BIT(i);
+        }
+    }
+
+    *encoding = http_encoding_choose(accepted, available);
+    if (*encoding == HTTP_ENCODING_IDENTITY) {
+        *len = response->body_len;
+        return response->body;
+    }
+
+    *len = response->encoded_len[*encoding];
+    return response->encoded[*encoding];
+}
+
+void weather_response_retain(WeatherResponse* response) {
+    response->refcount++;
+}
+
+void weather_response_release(void* context) {
+    WeatherResponse* response = (WeatherResponse*)context;
+    if (!response || --response->refcount > 0) {
+        return;
+    }
+
+    for (int i = 0; i < HTTP_ENCODING_COUNT; i++) {
+        free(response->encoded[i]);
+    }
+    free(response->body);
+    free(response);
+}
+
+/* Describe the popularity sketch and the locations kept warm, as JSON */
+char* open_meteo_handler_hot_locations_json(void) {
+    const WeatherConfig* config = open_meteo_api_get_config();
+
+    json_t* root      = json_object();
+    json_t* locations = json_array();
+    if (!root || !locations) {
+        json_decref(root);
+        json_decref(locations);
+        return NULL;
+    }
+
+    json_object_set_new(root, "top_k", json_integer(config->prefetch_top_k));
+    json_object_set_new(root, "requests_counted",
+                        json_integer((json_int_t)g_prefetch.sketch.total));
+    json_object_set_new(root, "prefetch_budget_left",
+                        json_integer((json_int_t)g_prefetch.tokens));
+    json_object_set_new(root, "prefetches_started",
+                        json_integer((json_int_t)g_prefetch.started));
+
+    size_t              max = config->prefetch_top_k > 0
+                                  ? (size_t)config->prefetch_top_k
+                                  : 0;
+    SpaceSavingCounter* top = max ? malloc(max * sizeof(*top)) : NULL;
+    size_t              count =
+        top ? space_saving_top(&g_prefetch.sketch, top, max) : 0;
+    time_t now = time(NULL);
+
+    for (size_t i = 0; i < count; i++) {
+        json_t* location = json_object();
+        char key[WEATHER_KEY_STRING_LENGTH];
+        weather_key_format(top[i].key, key);
+        json_object_set_new(location, "key", json_string(key));
+        json_object_set_new(location, "count",
+                            json_integer((json_int_t)top[i].count));
+        json_object_set_new(location, "error",
+                            json_integer((json_int_t)top[i].error));
+
+        WeatherResponse* cached =
+            g_response_cache
+                ? cache_peek_id(g_response_cache, top[i].key, NULL)
+                : NULL;
+        if (cached) {
+            json_object_set_new(
+                location, "expires_in",
+                json_integer((json_int_t)(cached->fetched_at + cached->ttl -
+                                          now)));
+        } else {
+            json_object_set_new(location, "expires_in", json_null());
+        }
+
+        json_array_append_new(locations, location);
+    }
+    free(top);
+
+    json_object_set_new(root, "locations", locations);
+
+    char* json = json_dumps(root, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+    json_decref(root);
+    return json;
+}
+
+/* Cleanup weather server module */
+void open_meteo_handler_cleanup(void) {
+    if (g_prefetch.task) {
+        smw_destroy_task(g_prefetch.task);
+        g_prefetch.task = NULL;
+    }
+    space_saving_dispose(&g_prefetch.sketch);
+
+    cache_destroy(g_response_cache);
+    g_response_cache = NULL;
+
+    open_meteo_api_cleanup();
+}
+
+/* ============= Internal Functions Implementation ============= */
+
+/**
+ * Wraps a malloc'd body, the response takes ownership of it. Returns NULL and
+ * frees body on failure.
+ */
+static WeatherResponse* weather_response_create(int status_code, char* body,
+                                                time_t fetched_at) {
+    return weather_response_create_tagged(status_code, body, fetched_at, NULL);
+}
+
+/**
+ * Same as weather_response_create, taking the binary MD5 of body for the
+ * ETag when the caller already has it, NULL hashes body here
+ */
+static WeatherResponse* weather_response_create_tagged(
+    int status_code, char* body, time_t fetched_at, const unsigned char* md5) {
+    if (!body) {
+        return NULL;
+    }
+
+    WeatherResponse* response = calloc(1, sizeof(WeatherResponse));
+    if (!response) {
+        free(body);
+        return NULL;
+    }
+
+    response->refcount    = 1;
+    response->status_code = status_code;
+    response->fetched_at  = fetched_at;
+    response->body        = body;
+    response->body_len    = strlen(body);
+
+    /* Computed once here so revalidation never has to look at the body */
+    if (md5) {
+        hash_md5_binary_to_string(md5, response->etag,
+                                  sizeof(response->etag));
+    } else {
+        hash_md5_string(response->body, response->body_len, response->etag,
+                        sizeof(response->etag));
+    }
+    http_format_date(response->last_modified, fetched_at);
+
+    return response;
+}
+
+/**
+ * Returns the in-memory response cache, creating it on first use. NULL when
+ * caching is disabled or creation failed.
+ */
+static Cache* response_cache_get(void) {
+    const WeatherConfig* config = open_meteo_api_get_config();
+    if (!config->use_cache) {
+        return NULL;
+    }
+
+    if (!g_response_cache) {
+        g_response_cache = cache_create(OPEN_METEO_HANDLER_CACHE_MAX_ENTRIES,
+                                        config->cache_ttl);
+        if (g_response_cache) {
+            cache_set_free_data(g_response_cache, weather_response_release);
+        }
+    }
+    return g_response_cache;
+}
+
+/**
+ * Keeps a successful response through its grace windows, lookups check the
+ * age. The cache takes its own reference.
+ */
+static void cache_store_response(WeatherKey key, WeatherResponse* response) {
+    const WeatherConfig* config = open_meteo_api_get_config();
+    if (!response_cache_get()) {
+        return;
+    }
+
+    int grace = config->stale_while_revalidate > config->stale_if_error
+                    ? config->stale_while_revalidate
+                    : config->stale_if_error;
+    time_t ttl = response->fetched_at + response->ttl + grace - time(NULL);
+    if (ttl > 0) {
+        weather_response_retain(response);
+        cache_insert_id(g_response_cache, key, response, response->body_len,
+                        ttl);
+    }
+}
+
+/**
+ * Fills the response cache from the disk cache, most recently fetched
+ * locations first
+ */
+static void warm_up_response_cache(void) {
+    OpenMeteoWarmEntry* entries = NULL;
+    int                 count   = open_meteo_api_warm_up(
+        OPEN_METEO_HANDLER_CACHE_MAX_ENTRIES, &entries);
+    if (count < 0) {
+        fprintf(stderr, "[METEO] Warm-up failed (%d)\n", count);
+        return;
+    }
+
+    /* Hash every body for its ETag in one batch, lanes side by side. Each
+     * response hashes its own if there was no memory for that. */
+    const void**   bodies  = malloc((size_t)count * sizeof(*bodies));
+    size_t*        sizes   = malloc((size_t)count * sizeof(*sizes));
+    unsigned char* digests = malloc((size_t)count * HASH_MD5_BINARY_LENGTH);
+    int            hashed  = 0;
+    if (bodies && sizes && digests) {
+        for (int i = 0; i < count; i++) {
+            bodies[i] = entries[i].body;
+            sizes[i]  = strlen(entries[i].body);
+        }
+        hashed = hash_md5_binary_many(bodies, sizes, (size_t)count,
+                                      digests) == 0;
+    }
+    free(bodies);
+    free(sizes);
+
+    for (int i = 0; i < count; i++) {
+        WeatherData* data = entries[i].data;
+
+        WeatherResponse* response = weather_response_create_tagged(
+            HTTP_OK, entries[i].body, data->fetched_at,
+            hashed ? digests + (size_t)i * HASH_MD5_BINARY_LENGTH : NULL);
+        if (response) {
+            response->ttl         = entries[i].ttl;
+            response->next_update = data->interval > 0
+                                        ? data->timestamp + data->interval
+                                        : 0;
+
+            cache_store_response(
+                weather_key_make(data->latitude, data->longitude), response);
+            weather_response_release(response);
+        }
+        open_meteo_api_free_current(data);
+    }
+    free(digests);
+    free(entries);
+}
+
+/**
+ * A background refresh rewrote the cache file, the next request rebuilds
+ * from it. Failed refreshes keep the stale entry for stale_if_error.
+ */
+static void on_refresh_done(float lat, float lon, int result) {
+    if (result != 0 || !g_response_cache) {
+        return;
+    }
+
+    cache_remove_id(g_response_cache, weather_key_make(lat, lon));
+}
+
+static int start_refresh(float lat, float lon) {
+    Location location = {
+        .latitude = lat, .longitude = lon, .name = "Query Location"};
+    return open_meteo_api_refresh_async(&location);
+}
+
+/**
+ * Refreshes the most requested locations shortly before they expire, within
+ * the upstream budget. Entries that follow upstream intervals are never
+ * refreshed before the interval ends, there is no new data before that.
+ */
+static void prefetch_task_work(void* context, uint64_t mon_time) {
+    (void)context;
+
+    if (mon_time < g_prefetch.next_run) {
+        return;
+    }
+    g_prefetch.next_run = mon_time + OPEN_METEO_HANDLER_PREFETCH_PERIOD_MS;
+
+    const WeatherConfig* config = open_meteo_api_get_config();
+
+    /* Token bucket holding at most a minute of budget */
+    if (g_prefetch.last_refill != 0) {
+        g_prefetch.tokens += (double)(mon_time - g_prefetch.last_refill) *
+                             config->prefetch_budget / 60000.0;
+        if (g_prefetch.tokens > config->prefetch_budget) {
+            g_prefetch.tokens = config->prefetch_budget;
+        }
+    }
+    g_prefetch.last_refill = mon_time;
+
+    if (mon_time >= g_prefetch.next_decay) {
+        if (g_prefetch.next_decay != 0) {
+            space_saving_decay(&g_prefetch.sketch);
+        }
+        g_prefetch.next_decay =
+            mon_time + OPEN_METEO_HANDLER_POPULARITY_DECAY_MS;
+    }
+
+    if (!g_response_cache || g_prefetch.tokens < 1.0) {
+        return;
+    }
+
+    SpaceSavingCounter top[64];
+    size_t             max = config->prefetch_top_k < 64
+                                 ? (size_t)config->prefetch_top_k
+                                 : 64;
+    size_t             count = space_saving_top(&g_prefetch.sketch, top, max);
+    time_t             now   = time(NULL);
+
+    for (size_t i = 0; i < count && g_prefetch.tokens >= 1.0; i++) {
+        WeatherResponse* cached =
+            cache_peek_id(g_response_cache, top[i].key, NULL);
+        if (!cached || cached->status_code != HTTP_OK) {
+            continue; /* Not requested since its last refresh, or failing */
+        }
+
+        time_t refresh_at = cached->fetched_at + cached->ttl -
+                            config->prefetch_lead;
+        if (cached->next_update > refresh_at) {
+            refresh_at = cached->next_update;
+        }
+        if (cached->prefetch_at > refresh_at) {
+            refresh_at = cached->prefetch_at;
+        }
+        if (now < refresh_at) {
+            continue;
+        }
+
+        float lat = weather_key_latitude(top[i].key);
+        float lon = weather_key_longitude(top[i].key);
+
+        // A successful refresh replaces the entry, so this only spaces out
+        // retries while upstream keeps failing
+        cached->prefetch_at = now + config->prefetch_lead;
+
+        if (start_refresh(lat, lon) == 0) {
+            g_prefetch.tokens -= 1.0;
+            g_prefetch.started++;
+            printf("[METEO] Prefetching hot location %.6f,%.6f (%llu "
+                   "requests)\n",
+                   lat, lon, (unsigned long long)top[i].count);
+        }
+    }
+}
+
+/**
+ * Fetches the weather, from the file cache or Open-Meteo, and renders it.
+ * On failure returns NULL with the open_meteo_api_get_current error in error.
+ */
+static WeatherResponse* build_current_response(float lat, float lon,
+                                               WeatherCacheStatus* status,
+                                               int*                error) {
     /* Create location */
     Location location = {
         .latitude = lat, .longitude = lon, .name = "Query Location"};
@@ -71,27 +650,71 @@ int open_meteo_handler_current(const char* query_string, char** response_json,
     int          result = open_meteo_api_get_current(&location, &weather_data);
 
     if (result != 0 || !weather_data) {
-        *response_json = build_error_response(
-            "Failed to fetch weather data from Open-Meteo API",
-            HTTP_INTERNAL_ERROR);
-        *status_code = HTTP_INTERNAL_ERROR;
-        return -1;
+        *error = result;
+        return NULL;
     }
 
     /* Build JSON response */
-    *response_json = open_meteo_api_build_json_response(weather_data, lat, lon);
+    char*  json       = open_meteo_api_build_json_response(weather_data, lat,
+                                                           lon);
+    time_t fetched_at  = weather_data->fetched_at;
+    int    ttl         = open_meteo_api_entry_ttl(weather_data, lat, lon);
+    time_t next_update = weather_data->interval > 0
+                             ? weather_data->timestamp + weather_data->interval
+                             : 0;
+    *status            = weather_data->cache_status;
 
     /* Cleanup */
     open_meteo_api_free_current(weather_data);
 
-    if (!*response_json) {
-        *status_code = HTTP_INTERNAL_ERROR;
-        return -1;
+    WeatherResponse* response =
+        weather_response_create(HTTP_OK, json, fetched_at);
+    if (response) {
+        response->ttl         = ttl;
+        response->next_update = next_update;
     }
 
-    *status_code = HTTP_OK;
-    return 0;
+    return response;
 }
 
-/* Cleanup weather server module */
-void wopen_meteo_handler_cleanup(void) { open_meteo_api_cleanup(); }
+/**
+ * Error response for a failed fetch, with the TTL it may be remembered for.
+ * Coordinates upstream refused stay refused far longer than an outage lasts.
+ * Refusals of the circuit breaker are not remembered, they cost nothing and
+ * the next one may be let through.
+ */
+static WeatherResponse* build_failure_response(int error) {
+    const WeatherConfig* config = open_meteo_api_get_config();
+
+    WeatherResponse* response;
+    if (error == OPEN_METEO_API_ERROR_REJECTED) {
+        response = weather_response_create(
+            HTTP_BAD_REQUEST,
+            build_error_response("Open-Meteo rejected the coordinates",
+                                 HTTP_BAD_REQUEST),
+            time(NULL));
+        if (response) {
+            response->ttl = config->rejected_ttl;
+        }
+        return response;
+    }
+
+    if (error == OPEN_METEO_API_ERROR_UNAVAILABLE) {
+        return weather_response_create(
+            HTTP_SERVICE_UNAVAILABLE,
+            build_error_response("Open-Meteo API is unavailable, try again "
+                                 "later",
+                                 HTTP_SERVICE_UNAVAILABLE),
+            time(NULL));
+    }
+
+    response = weather_response_create(
+        HTTP_INTERNAL_ERROR,
+        build_error_response("Failed to fetch weather data from Open-Meteo API",
+                             HTTP_INTERNAL_ERROR),
+        time(NULL));
+    if (response && error == OPEN_METEO_API_ERROR_UPSTREAM) {
+        response->ttl = config->negative_ttl;
+    }
+    return response;
+}
@@ -4,6 +4,53 @@
 #ifndef OPEN_METEO_HANDLER_H
 #define OPEN_METEO_HANDLER_H
 
+#include "hash_md5.h"
+#include "open_meteo_api.h"
+#include "http_server/http_encoding.h"
+#include "http_server/http_response.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Responses kept in memory, one per coordinate */
+#define OPEN_METEO_HANDLER_CACHE_MAX_ENTRIES 1024
+
+/* How often the prefetch task looks at the hot locations */
+#define OPEN_METEO_HANDLER_PREFETCH_PERIOD_MS 1000
+
+/* Counts are halved this often so popularity follows recent traffic */
+#define OPEN_METEO_HANDLER_POPULARITY_DECAY_MS 60000
+
+/* open_meteo_handler_current_response is waiting for the disk */
+#define OPEN_METEO_HANDLER_PENDING 1
+
+/**
+ * A finished /v1/current response shared between the in-memory cache and the
+ * connections sending it. Compressed variants are built on first request for
+ * that encoding and live as long as the response, so each body is compressed
+ * at most once per TTL.
+ */
+typedef struct {
+    int    refcount;
+    int    status_code;
+    time_t fetched_at; /* When the weather data was fetched upstream */
+    int    ttl;        /* Seconds fresh after fetched_at, jitter included */
+    time_t next_update; /* When upstream publishes new data, 0 if unknown */
+    time_t prefetch_at; /* Earliest next prefetch, pushed back after a try */
+
+    char*  body;
+    size_t body_len;
+
+    /* Validators: MD5 of the identity body and fetched_at as an HTTP date */
+    char etag[HASH_MD5_STRING_LENGTH];
+    char last_modified[HTTP_DATE_LENGTH + 1];
+
+    uint8_t* encoded[HTTP_ENCODING_COUNT];
+    size_t   encoded_len[HTTP_ENCODING_COUNT];
+    unsigned encoded_tried; /* HTTP_ENCODING_BIT() of variants attempted */
+} WeatherResponse;
+
 /**
  * Initialize the weather server module
  * Must be called before handling requests
@@ -20,7 +67,7 @@ int open_meteo_handler_init(void);
  * (caller must free)
  * @param status_code Output parameter - HTTP status code
  *
- * @return 0 on success, -1 on error
+ * @return 0 on success, -1 on error or while disk cache reads are in flight
  *
  * Example usage in http_server.c:
  *   char* json = NULL;
@@ -32,6 +79,42 @@ int open_meteo_handler_init(void);
 int open_meteo_handler_current(const char* query_string, char** response_json,
                                int* status_code);
 
+/**
+ * Handle GET /v1/current endpoint, serving from the in-memory response cache
+ *
+ * @param query_string Query parameters (e.g., "lat=37.7749&long=-122.4194")
+ * @param response Output parameter - response with a reference held for the
+ * caller, release it with weather_response_release
+ * @param cache_status Output parameter, optional - how the response was served
+ *
+ * @return 0 on success, -1 on error (response is still set when possible),
+ * OPEN_METEO_HANDLER_PENDING while disk cache reads are in flight: response
+ * is not set, call again on a later pass of the loop
+ */
+int open_meteo_handler_current_response(const char*         query_string,
+                                        WeatherResponse**   response,
+                                        WeatherCacheStatus* cache_status);
+
+/**
+ * Pick the body to send for an Accept-Encoding mask, compressing it on first
+ * use. Falls back to the identity body for small bodies or failed encodings.
+ */
+const void* weather_response_body(WeatherResponse* response,
+                                  unsigned accepted, HttpEncoding* encoding,
+                                  size_t* len);
+
+void weather_response_retain(WeatherResponse* response);
+
+/* Drops a reference, takes void* so it can be used as a release callback */
+void weather_response_release(void* response);
+
+/**
+ * Describe the locations being kept warm, for the admin endpoint
+ *
+ * @return Allocated JSON string (caller must free), NULL on error
+ */
+char* open_meteo_handler_hot_locations_json(void);
+
 /**
  * Cleanup the weather server module
  * Should be called on server shutdown
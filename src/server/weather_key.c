@@ -0,0 +1,117 @@
+/* weather_key.c - Binary cache keys for coordinates */
+
+#include "weather_key.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MICRO_DEGREES 1000000
+
+#define LATITUDE_MAX (90 * MICRO_DEGREES)
+#define LONGITUDE_MAX (180 * MICRO_DEGREES)
+
+#define LONGITUDE_BITS 29
+#define LATITUDE_BITS 28
+#define VERSION_SHIFT (LATITUDE_BITS + LONGITUDE_BITS)
+
+/* Rounds like "%.6f": a float times 10^6 is exact in a double, so lrint
+ * rounds the true value, halfway cases to even */
+static int to_micro_degrees(float value, int32_t max, int32_t* out) {
+    if (!(fabsf(value) <= (float)max / MICRO_DEGREES + 1.0f)) {
+        return -1;
+    }
+    long micro = lrint((double)value * MICRO_DEGREES);
+    if (micro < -max || micro > max) {
+        return -1;
+    }
+    *out = (int32_t)micro;
+    return 0;
+}
+
+static int32_t key_latitude(WeatherKey key) {
+    return (int32_t)((key >> LONGITUDE_BITS) & ((1u << LATITUDE_BITS) - 1)) -
+           LATITUDE_MAX;
+}
+
+static int32_t key_longitude(WeatherKey key) {
+    return (int32_t)(key & ((1u << LONGITUDE_BITS) - 1)) - LONGITUDE_MAX;
+}
+
+/* Writes micro as degrees with six decimals, returns the length */
+static size_t format_micro_degrees(int32_t micro, char* out) {
+    char*    p     = out;
+    uint32_t value = (uint32_t)micro;
+    if (micro < 0) {
+        *p++  = '-';
+        value = 0u - value;
+    }
+
+    uint32_t whole = value / MICRO_DEGREES;
+    uint32_t part  = value % MICRO_DEGREES;
+
+    if (whole >= 100) {
+        *p++ = (char)('0' + whole / 100);
+    }
+    if (whole >= 10) {
+        *p++ = (char)('0' + whole / 10 % 10);
+    }
+    *p++ = (char)('0' + whole % 10);
+    *p++ = '.';
+    for (int i = 5; i >= 0; i--) {
+        p[i] = (char)('0' + part % 10);
+        part /= 10;
+    }
+    p += 6;
+
+    return (size_t)(p - out);
+}
+
+WeatherKey weather_key_make(float lat, float lon) {
+    int32_t lat_micro, lon_micro;
+    if (to_micro_degrees(lat, LATITUDE_MAX, &lat_micro) != 0 ||
+        to_micro_degrees(lon, LONGITUDE_MAX, &lon_micro) != 0) {
+        return WEATHER_KEY_INVALID;
+    }
+
+    return (uint64_t)WEATHER_KEY_VERSION << VERSION_SHIFT |
+           (uint64_t)(lat_micro + LATITUDE_MAX) << LONGITUDE_BITS |
+           (uint64_t)(lon_micro + LONGITUDE_MAX);
+}
+
+float weather_key_latitude(WeatherKey key) {
+    return (float)((double)key_latitude(key) / MICRO_DEGREES);
+}
+
+float weather_key_longitude(WeatherKey key) {
+    return (float)((double)key_longitude(key) / MICRO_DEGREES);
+}
+
+void weather_key_format(WeatherKey key, char* out) {
+    size_t len = format_micro_degrees(key_latitude(key), out);
+    out[len++] = ',';
+    len += format_micro_degrees(key_longitude(key), out + len);
+    out[len] = '\0';
+}
+
+int weather_key_store_name(WeatherKey key, char* out) {
+    if (key == WEATHER_KEY_INVALID) {
+        return -1;
+    }
+
+    /* Built the way snprintf("weather_%.6f_%.6f") built it, so entries
+     * cached before keys were binary are still found */
+    char   name[48] = "weather_";
+    size_t len      = strlen(name);
+    len += format_micro_degrees(key_latitude(key), name + len);
+    name[len++] = '_';
+    len += format_micro_degrees(key_longitude(key), name + len);
+
+    if (WEATHER_KEY_VERSION > 1) {
+        /* Later variable sets must not find the old entries */
+        len += (size_t)snprintf(name + len, sizeof(name) - len, "_v%d",
+                                WEATHER_KEY_VERSION);
+    }
+
+    return hash_md5_string(name, len, out, HASH_MD5_STRING_LENGTH);
+}
@@ -0,0 +1,49 @@
+/* weather_key.h - Binary cache keys for coordinates
+ *
+ * A key packs both coordinates as fixed-point micro-degrees, the precision
+ * every cache has always used, together with a version tag into one 64-bit
+ * integer. In-memory tables compare and hash keys as plain integers, nothing
+ * is formatted or hashed with MD5 on the way. The MD5 name the disk cache
+ * knows a location by is derived from the key only when the disk is asked.
+ *
+ * Layout, most significant bits first:
+ *   7 bits  version tag, never 0 so no valid key is 0
+ *   28 bits latitude + 90 in micro-degrees, 0 to 180000000
+ *   29 bits longitude + 180 in micro-degrees, 0 to 360000000
+ */
+
+#ifndef WEATHER_KEY_H
+#define WEATHER_KEY_H
+
+#include "hash_md5.h"
+
+#include <stdint.h>
+
+/* Changes whenever the set of variables fetched from upstream does, so data
+ * cached for another set is never mistaken for the current one */
+#define WEATHER_KEY_VERSION 1
+
+/* Returned for coordinates out of range */
+#define WEATHER_KEY_INVALID 0
+
+typedef uint64_t WeatherKey;
+
+/* Key for coordinates rounded to micro-degrees as "%.6f" rounds them,
+ * WEATHER_KEY_INVALID if they are out of range or not a number */
+WeatherKey weather_key_make(float lat, float lon);
+
+/* Coordinates of key, weather_key_make gives the same key for them */
+float weather_key_latitude(WeatherKey key);
+float weather_key_longitude(WeatherKey key);
+
+/* Writes "<lat>,<lon>" with six decimals, for logs. out must hold
+ * WEATHER_KEY_STRING_LENGTH bytes. */
+#define WEATHER_KEY_STRING_LENGTH 24
+void weather_key_format(WeatherKey key, char* out);
+
+/* Disk cache name of key: the MD5 of "weather_<lat>_<lon>", which also named
+ * the old per-location JSON files. out must hold HASH_MD5_STRING_LENGTH
+ * bytes. Returns 0 on success, -1 for an invalid key. */
+int weather_key_store_name(WeatherKey key, char* out);
+
+#endif /* WEATHER_KEY_H */
@@ -0,0 +1,185 @@
+/* weather_record.c - Fixed-layout binary encoding of WeatherData */
+
+#include "weather_record.h"
+
+#include <string.h>
+#include <zlib.h>
+
+/* Field offsets, all integers and floats little-endian */
+#define OFFSET_MAGIC 0
+#define OFFSET_VERSION 4
+#define OFFSET_SIZE 6
+#define OFFSET_TIMESTAMP 8
+#define OFFSET_FETCHED_AT 16
+#define OFFSET_INTERVAL 24
+#define OFFSET_TTL_PERCENT 28
+#define OFFSET_WEATHER_CODE 32
+#define OFFSET_WINDDIRECTION 36
+#define OFFSET_IS_DAY 40
+#define OFFSET_TEMPERATURE 48
+#define OFFSET_WINDSPEED 56
+#define OFFSET_PRECIPITATION 64
+#define OFFSET_HUMIDITY 72
+#define OFFSET_PRESSURE 80
+#define OFFSET_LATITUDE 88
+#define OFFSET_LONGITUDE 92
+#define OFFSET_TEMPERATURE_UNIT 96
+#define OFFSET_WINDSPEED_UNIT 112
+#define OFFSET_WINDDIRECTION_UNIT 128
+#define OFFSET_PRECIPITATION_UNIT 144
+#define OFFSET_CRC 160
+
+#define UNIT_LENGTH 16
+
+/* ============= Byte Order Helpers ============= */
+
+static void put_u16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static void put_u64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint16_t get_u16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t get_u64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+/* Floats travel as their IEEE 754 bit patterns */
+static void put_f64(uint8_t* out, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_u64(out, bits);
+}
+
+static void put_f32(uint8_t* out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_u32(out, bits);
+}
+
+static double get_f64(const uint8_t* in) {
+    uint64_t bits = get_u64(in);
+    double   value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static float get_f32(const uint8_t* in) {
+    uint32_t bits = get_u32(in);
+    float    value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/* Units are NUL-padded, a unit filling all 16 bytes has no terminator */
+static void put_unit(uint8_t* out, const char* unit) {
+    memset(out, 0, UNIT_LENGTH);
+    memcpy(out, unit, strnlen(unit, UNIT_LENGTH));
+}
+
+static void get_unit(const uint8_t* in, char* unit, size_t size) {
+    size_t len = strnlen((const char*)in, UNIT_LENGTH);
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(unit, in, len);
+    unit[len] = '\0';
+}
+
+/* ============= Public API Implementation ============= */
+
+void weather_record_encode(const WeatherData* data, uint8_t* out) {
+    memset(out, 0, WEATHER_RECORD_SIZE);
+
+    put_u32(out + OFFSET_MAGIC, WEATHER_RECORD_MAGIC);
+    put_u16(out + OFFSET_VERSION, WEATHER_RECORD_VERSION);
+    put_u16(out + OFFSET_SIZE, WEATHER_RECORD_SIZE);
+
+    put_u64(out + OFFSET_TIMESTAMP, (uint64_t)(int64_t)data->timestamp);
+    put_u64(out + OFFSET_FETCHED_AT, (uint64_t)(int64_t)data->fetched_at);
+    put_u32(out + OFFSET_INTERVAL, (uint32_t)data->interval);
+    put_u32(out + OFFSET_TTL_PERCENT, (uint32_t)data->ttl_percent);
+    put_u32(out + OFFSET_WEATHER_CODE, (uint32_t)data->weather_code);
+    put_u32(out + OFFSET_WINDDIRECTION, (uint32_t)data->winddirection);
+    put_u32(out + OFFSET_IS_DAY, (uint32_t)data->is_day);
+
+    put_f64(out + OFFSET_TEMPERATURE, data->temperature);
+    put_f64(out + OFFSET_WINDSPEED, data->windspeed);
+    put_f64(out + OFFSET_PRECIPITATION, data->precipitation);
+    put_f64(out + OFFSET_HUMIDITY, data->humidity);
+    put_f64(out + OFFSET_PRESSURE, data->pressure);
+    put_f32(out + OFFSET_LATITUDE, data->latitude);
+    put_f32(out + OFFSET_LONGITUDE, data->longitude);
+
+    put_unit(out + OFFSET_TEMPERATURE_UNIT, data->temperature_unit);
+    put_unit(out + OFFSET_WINDSPEED_UNIT, data->windspeed_unit);
+    put_unit(out + OFFSET_WINDDIRECTION_UNIT, data->winddirection_unit);
+    put_unit(out + OFFSET_PRECIPITATION_UNIT, data->precipitation_unit);
+
+    put_u32(out + OFFSET_CRC, (uint32_t)crc32(0L, out, OFFSET_CRC));
+}
+
+int weather_record_decode(const uint8_t* in, size_t len, WeatherData* data) {
+    if (len != WEATHER_RECORD_SIZE ||
+        get_u32(in + OFFSET_MAGIC) != WEATHER_RECORD_MAGIC ||
+        get_u16(in + OFFSET_VERSION) != WEATHER_RECORD_VERSION ||
+        get_u16(in + OFFSET_SIZE) != WEATHER_RECORD_SIZE) {
+        return -1;
+    }
+    if (get_u32(in + OFFSET_CRC) != (uint32_t)crc32(0L, in, OFFSET_CRC)) {
+        return -2;
+    }
+
+    data->timestamp     = (time_t)(int64_t)get_u64(in + OFFSET_TIMESTAMP);
+    data->fetched_at    = (time_t)(int64_t)get_u64(in + OFFSET_FETCHED_AT);
+    data->interval      = (int32_t)get_u32(in + OFFSET_INTERVAL);
+    data->ttl_percent   = (int32_t)get_u32(in + OFFSET_TTL_PERCENT);
+    data->weather_code  = (int32_t)get_u32(in + OFFSET_WEATHER_CODE);
+    data->winddirection = (int32_t)get_u32(in + OFFSET_WINDDIRECTION);
+    data->is_day        = (int32_t)get_u32(in + OFFSET_IS_DAY);
+
+    data->temperature   = get_f64(in + OFFSET_TEMPERATURE);
+    data->windspeed     = get_f64(in + OFFSET_WINDSPEED);
+    data->precipitation = get_f64(in + OFFSET_PRECIPITATION);
+    data->humidity      = get_f64(in + OFFSET_HUMIDITY);
+    data->pressure      = get_f64(in + OFFSET_PRESSURE);
+    data->latitude      = get_f32(in + OFFSET_LATITUDE);
+    data->longitude     = get_f32(in + OFFSET_LONGITUDE);
+
+    get_unit(in + OFFSET_TEMPERATURE_UNIT, data->temperature_unit,
+             sizeof(data->temperature_unit));
+    get_unit(in + OFFSET_WINDSPEED_UNIT, data->windspeed_unit,
+             sizeof(data->windspeed_unit));
+    get_unit(in + OFFSET_WINDDIRECTION_UNIT, data->winddirection_unit,
+             sizeof(data->winddirection_unit));
+    get_unit(in + OFFSET_PRECIPITATION_UNIT, data->precipitation_unit,
+             sizeof(data->precipitation_unit));
+
+    return 0;
+}
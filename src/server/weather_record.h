@@ -0,0 +1,33 @@
+/* weather_record.h - Fixed-layout binary encoding of WeatherData for the
+ * disk cache
+ *
+ * Every field sits at a fixed offset in little-endian byte order, so a record
+ * written on one machine reads the same on any other and decoding is a
+ * handful of loads, no parsing. A CRC-32 over the record catches torn or
+ * corrupted bytes. The version changes whenever the layout does, records of
+ * another version read as invalid and get refetched.
+ */
+
+#ifndef WEATHER_RECORD_H
+#define WEATHER_RECORD_H
+
+#include "open_meteo_api.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WEATHER_RECORD_MAGIC 0x4457574au /* "JWWD" */
+#define WEATHER_RECORD_VERSION 1
+
+/* Encoded size in bytes */
+#define WEATHER_RECORD_SIZE 168
+
+/* Encodes data into out, which must hold WEATHER_RECORD_SIZE bytes.
+ * city_name and the raw JSON are not part of the record. */
+void weather_record_encode(const WeatherData* data, uint8_t* out);
+
+/* Decodes a record into data. Returns 0 on success, -1 if it is not a record
+ * of this version and -2 if the checksum does not match. */
+int weather_record_decode(const uint8_t* in, size_t len, WeatherData* data);
+
+#endif /* WEATHER_RECORD_H */
@@ -7,19 +7,32 @@
 
 //-----------------Internal Functions-----------------
 
-void weather_server_task_work(void* context, uint64_t mon_time);
 int  weather_server_on_http_connection(void*                 context,
                                        HTTPServerConnection* connection);
+void weather_server_on_instance_dispose(void*                  context,
+                                        WeatherServerInstance* instance);
 
 //----------------------------------------------------
 
 int weather_server_initiate(WeatherServer* server) {
-    http_server_initiate(&server->httpServer,
-                         weather_server_on_http_connection);
+    intrusive_list_init(&server->instances);
+    intrusive_list_init(&server->instance_pool);
 
-    server->instances = linked_list_create();
+    int result = weather_server_instance_routes_initiate(&server->router);
+    if (result != 0) {
+        printf("WeatherServer_Initiate: Failed to compile routes\n");
+        return result;
+    }
 
-    server->task = smw_create_task(server, weather_server_task_work);
+    result = weather_server_instance_responses_initiate();
+    if (result != 0) {
+        printf("WeatherServer_Initiate: Failed to build static responses\n");
+        http_router_dispose(&server->router);
+        return result;
+    }
+
+    http_server_initiate(&server->httpServer,
+                         weather_server_on_http_connection);
 
     return 0;
 }
@@ -50,29 +63,59 @@ int weather_server_on_http_connection(void*                 context,
     WeatherServer* server = (WeatherServer*)context;
 
     WeatherServerInstance* instance = NULL;
-    int result = weather_server_instance_initiate_ptr(connection, &instance);
-    if (result != 0) {
-        printf("WeatherServer_OnHTTPConnection: Failed to initiate instance\n");
-        return -1;
+    ListHook*              hook =
+        intrusive_list_pop_front(&server->instance_pool);
+    if (hook) {
+        instance = IntrusiveList_entry(hook, WeatherServerInstance, hook);
+    } else {
+        instance =
+            (WeatherServerInstance*)malloc(sizeof(WeatherServerInstance));
+        if (instance == NULL) {
+            printf("WeatherServer_OnHTTPConnection: Failed to allocate "
+                   "instance\n");
+            return -1;
+        }
     }
 
-    linked_list_append(server->instances, instance);
+    weather_server_instance_initiate(instance, connection, &server->router);
+    weather_server_instance_set_callback(instance, server,
+                                         weather_server_on_instance_dispose);
+
+    intrusive_list_append(&server->instances, &instance->hook);
 
     return 0;
 }
 
-void weather_server_task_work(void* context, uint64_t mon_time) {
+void weather_server_on_instance_dispose(void*                  context,
+                                        WeatherServerInstance* instance) {
     WeatherServer* server = (WeatherServer*)context;
 
-    LinkedList_foreach(server->instances, node) {
-        WeatherServerInstance* instance = (WeatherServerInstance*)node->item;
-        weather_server_instance_work(instance, mon_time);
+    intrusive_list_remove(&server->instances, &instance->hook);
+    weather_server_instance_dispose(instance);
+
+    if (server->instance_pool.size < WEATHER_SERVER_INSTANCE_POOL_MAX) {
+        intrusive_list_append(&server->instance_pool, &instance->hook);
+    } else {
+        free(instance);
     }
 }
 
 void weather_server_dispose(WeatherServer* server) {
     http_server_dispose(&server->httpServer);
-    smw_destroy_task(server->task);
+
+    ListHook* hook;
+    while ((hook = intrusive_list_pop_front(&server->instances)) != NULL) {
+        WeatherServerInstance* instance =
+            IntrusiveList_entry(hook, WeatherServerInstance, hook);
+        weather_server_instance_dispose(instance);
+        free(instance);
+    }
+    while ((hook = intrusive_list_pop_front(&server->instance_pool)) != NULL) {
+        free(IntrusiveList_entry(hook, WeatherServerInstance, hook));
+    }
+
+    http_router_dispose(&server->router);
+    weather_server_instance_responses_dispose();
 }
 
 void weather_server_dispose_ptr(WeatherServer** server_ptr) {
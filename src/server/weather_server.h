@@ -1,16 +1,22 @@
 #ifndef WEATHER_SERVER_H
 #define WEATHER_SERVER_H
 
+#include "http_server/http_router.h"
 #include "http_server/http_server.h"
 #include "linked_list.h"
 #include "smw.h"
 
+// Released instances kept for reuse by later connections
+#ifndef WEATHER_SERVER_INSTANCE_POOL_MAX
+#    define WEATHER_SERVER_INSTANCE_POOL_MAX 256
+#endif
+
 typedef struct {
     HTTPServer httpServer;
+    HttpRouter router;
 
-    LinkedList* instances;
-
-    SmwTask* task;
+    IntrusiveList instances;     // Instances with a live connection
+    IntrusiveList instance_pool; // Released instances, ready for reuse
 
 } WeatherServer;
 
@@ -1,29 +1,187 @@
 #include "weather_server_instance.h"
 
+#include "open_meteo_api.h"
 #include "open_meteo_handler.h"
 
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 //-----------------Internal Functions-----------------
 
-int weather_server_instance_on_request(void* context);
+int  weather_server_instance_on_request(void* context);
+void weather_server_instance_on_connection_dispose(void* context);
+
+static int weather_server_instance_homepage(void*                 context,
+                                            const HttpRouteMatch* match);
+static int weather_server_instance_echo(void*                 context,
+                                        const HttpRouteMatch* match);
+static int weather_server_instance_current(void*                 context,
+                                           const HttpRouteMatch* match);
+static int weather_server_instance_hot_locations(void* context,
+                                                 const HttpRouteMatch* match);
+static int weather_server_instance_cache_stats(void*                 context,
+                                               const HttpRouteMatch* match);
+static int weather_server_instance_method_not_allowed(
+    WeatherServerInstance* inst, const char* path, size_t path_len,
+    const char* allow);
+static int weather_server_instance_not_found(WeatherServerInstance* inst,
+                                             const char*            path,
+                                             size_t                 path_len);
+static int weather_server_instance_send_static(
+    HTTPServerConnection* conn, const HttpStaticResponse* static_response);
+static int weather_server_instance_not_modified(HTTPServerConnection*  conn,
+                                                const WeatherResponse* weather,
+                                                char*                  etag);
+static void weather_server_instance_format_etag(const WeatherResponse* weather,
+                                                HttpEncoding           encoding,
+                                                char*                  etag);
+static void weather_server_instance_add_freshness(
+    HttpResponse* response, const WeatherResponse* weather);
+static void weather_server_instance_add_cache_status(
+    HttpResponse* response, WeatherCacheStatus status);
+static int  weather_server_instance_not_found_tail_initiate(void);
+
+static unsigned weather_server_instance_accepted(HTTPServerConnection* conn);
+
+static const HttpRoute WEATHER_SERVER_ROUTES[] = {
+    {"GET", "/", weather_server_instance_homepage},
+    {"GET", "/echo", weather_server_instance_echo},
+    {"POST", "/echo", weather_server_instance_echo},
+    {"GET", "/v1/current", weather_server_instance_current},
+    {"GET", "/v1/admin/hot", weather_server_instance_hot_locations},
+    {"GET", "/v1/admin/cache", weather_server_instance_cache_stats},
+};
 
 //----------------------------------------------------
 
+static const char HOMEPAGE_HTML[] =
+    "<!DOCTYPE html>"
+    "<html>"
+    "<head><title>Just Weather</title></head>"
+    "<body>"
+    "<h1>Just Weather API</h1>"
+    "<p>Available endpoints:</p>"
+    "<ul>"
+    "  <li><b>GET /echo</b> — echo raw request</li>"
+    "  <li><b>POST /echo</b> — echo raw body</li>"
+    "  <li><b>GET /v1/current?lat=XX&lon=YY</b> — current weather</li>"
+    "  <li><b>GET /v1/admin/hot</b> — locations kept warm</li>"
+    "  <li><b>GET /v1/admin/cache</b> — disk cache size and evictions</li>"
+    "</ul>"
+    "<p>Source code available on <a "
+    "href=\"https://github.com/Stockholm-3/just-weather\" "
+    "target=\"_blank\">GitHub</a>.</p>"
+    "</body>"
+    "</html>";
+
+static const char INTERNAL_ERROR_JSON[] =
+    "{\n"
+    "  \"error\": \"Internal Server Error\",\n"
+    "  \"message\": \"Failed to fetch weather data from Open-Meteo API\"\n"
+    "}\n";
+
+// Error bodies are fixed text around the request method and path, which are
+// sent as extra body parts straight from the connection
+static const char NOT_FOUND_JSON_HEAD[] =
+    "{\n"
+    "  \"error\": \"Not Found\",\n"
+    "  \"message\": \"The requested endpoint was not found\",\n"
+    "  \"method\": \"";
+static const char NOT_FOUND_JSON_ENDPOINTS[] =
+    "\",\n"
+    "  \"available_endpoints\": [\n";
+static const char NOT_FOUND_JSON_END[] = "  ]\n}\n";
+
+static const char METHOD_NOT_ALLOWED_JSON_HEAD[] =
+    "{\n"
+    "  \"error\": \"Method Not Allowed\",\n"
+    "  \"message\": \"The requested method is not allowed for this "
+    "endpoint\",\n"
+    "  \"method\": \"";
+static const char METHOD_NOT_ALLOWED_JSON_ALLOW[] = "\",\n  \"allow\": \"";
+static const char METHOD_NOT_ALLOWED_JSON_TAIL[]  = "\"\n}\n";
+
+static const char JSON_PATH_FIELD[] = "\",\n  \"path\": \"";
+
+// Quoted MD5 plus the encoding suffix, e.g. "\"<md5>-gzip\""
+#define WEATHER_ETAG_MAX_LEN (HASH_MD5_STRING_LENGTH + 16)
+
+#define STATIC_ENCODINGS                                                       \
+    (HTTP_ENCODING_BIT(HTTP_ENCODING_GZIP) |                                   \
+     HTTP_ENCODING_BIT(HTTP_ENCODING_BR))
+
+static HttpStaticResponse g_homepage_response;
+static HttpStaticResponse g_internal_error_response;
+
+// Ends the 404 body with every route, built from WEATHER_SERVER_ROUTES
+static char*  g_not_found_tail     = NULL;
+static size_t g_not_found_tail_len = 0;
+
+int weather_server_instance_routes_initiate(HttpRouter* router) {
+    return http_router_initiate(router, WEATHER_SERVER_ROUTES,
+                                sizeof(WEATHER_SERVER_ROUTES) /
+                                    sizeof(WEATHER_SERVER_ROUTES[0]));
+}
+
+int weather_server_instance_responses_initiate(void) {
+    int result = http_static_response_initiate(
+        &g_homepage_response, 200, HTTP_CONTENT_TYPE_HTML HTTP_HEADER_CORS,
+        HOMEPAGE_HTML, sizeof(HOMEPAGE_HTML) - 1, STATIC_ENCODINGS,
+        HTTP_ENCODING_DEFAULT_LEVEL);
+    if (result != 0) {
+        return result;
+    }
+
+    result = http_static_response_initiate(
+        &g_internal_error_response, 500,
+        HTTP_CONTENT_TYPE_JSON HTTP_HEADER_CORS, INTERNAL_ERROR_JSON,
+        sizeof(INTERNAL_ERROR_JSON) - 1, STATIC_ENCODINGS,
+        HTTP_ENCODING_DEFAULT_LEVEL);
+    if (result != 0) {
+        http_static_response_dispose(&g_homepage_response);
+        return result;
+    }
+
+    result = weather_server_instance_not_found_tail_initiate();
+    if (result != 0) {
+        http_static_response_dispose(&g_homepage_response);
+        http_static_response_dispose(&g_internal_error_response);
+        return result;
+    }
+
+    return 0;
+}
+
+void weather_server_instance_responses_dispose(void) {
+    http_static_response_dispose(&g_homepage_response);
+    http_static_response_dispose(&g_internal_error_response);
+
+    free(g_not_found_tail);
+    g_not_found_tail     = NULL;
+    g_not_found_tail_len = 0;
+}
+
 int weather_server_instance_initiate(WeatherServerInstance* instance,
-                                     HTTPServerConnection*  connection) {
+                                     HTTPServerConnection*  connection,
+                                     const HttpRouter*      router) {
     instance->connection = connection;
+    instance->router     = router;
+    instance->query      = NULL;
+    instance->context    = NULL;
+    instance->onDispose  = NULL;
 
-    http_server_connection_set_callback(instance->connection, instance,
-                                        weather_server_instance_on_request);
+    http_server_connection_set_callback(
+        instance->connection, instance, weather_server_instance_on_request,
+        weather_server_instance_on_connection_dispose);
 
     return 0;
 }
 
 int weather_server_instance_initiate_ptr(HTTPServerConnection*   connection,
+                                         const HttpRouter*       router,
                                          WeatherServerInstance** instance_ptr) {
     if (instance_ptr == NULL) {
         return -1;
@@ -35,7 +193,7 @@ int weather_server_instance_initiate_ptr(HTTPServerConnection*   connection,
         return -2;
     }
 
-    int result = weather_server_instance_initiate(instance, connection);
+    int result = weather_server_instance_initiate(instance, connection, router);
     if (result != 0) {
         free(instance);
         return result;
@@ -46,213 +204,413 @@ int weather_server_instance_initiate_ptr(HTTPServerConnection*   connection,
     return 0;
 }
 
+void weather_server_instance_set_callback(
+    WeatherServerInstance* instance, void* context,
+    WeatherServerInstanceOnDispose on_dispose) {
+    instance->context   = context;
+    instance->onDispose = on_dispose;
+}
+
 int weather_server_instance_on_request(void* context) {
     WeatherServerInstance* inst = (WeatherServerInstance*)context;
     HTTPServerConnection*  conn = inst->connection;
 
-    printf("[WEATHER] onRequest: %s %s\n", conn->method, conn->request_path);
+    // Called again while a handler waits, log the request once
+    if (conn->state != HTTP_SERVER_CONNECTION_STATE_WAIT) {
+        printf("[WEATHER] onRequest: %s %s\n", conn->method,
+               conn->request_path);
+    }
 
-    // Parse URL to get path and query
-    char path[256]  = {0};
-    char query[512] = {0};
+    // Split URL into path and query without copying
+    const char* path          = conn->request_path;
+    const char* question_mark = strchr(path, '?');
+    size_t      path_len =
+        question_mark ? (size_t)(question_mark - path) : strlen(path);
+    inst->query = question_mark ? question_mark + 1 : "";
+
+    HttpRouteMatch   match;
+    HttpRouterResult result =
+        http_router_match(inst->router, conn->method, path, path_len, &match);
+
+    switch (result) {
+    case HTTP_ROUTER_MATCH:
+        return match.route->handler(inst, &match);
+    case HTTP_ROUTER_METHOD_NOT_ALLOWED:
+        return weather_server_instance_method_not_allowed(inst, path, path_len,
+                                                          match.allow);
+    case HTTP_ROUTER_NOT_FOUND:
+        break;
+    }
 
-    char* question_mark = strchr(conn->request_path, '?');
-    if (question_mark) {
-        size_t path_len = question_mark - conn->request_path;
-        strncpy(path, conn->request_path, path_len);
-        path[path_len] = '\0';
-        strcpy(query, question_mark + 1);
-    } else {
-        strcpy(path, conn->request_path);
+    return weather_server_instance_not_found(inst, path, path_len);
+}
+
+static int weather_server_instance_homepage(void*                 context,
+                                            const HttpRouteMatch* match) {
+    WeatherServerInstance* inst = (WeatherServerInstance*)context;
+
+    printf("[WEATHER] Serving homepage\n");
+
+    return weather_server_instance_send_static(inst->connection,
+                                               &g_homepage_response);
+}
+
+static int weather_server_instance_echo(void*                 context,
+                                        const HttpRouteMatch* match) {
+    WeatherServerInstance* inst     = (WeatherServerInstance*)context;
+    HTTPServerConnection*  conn     = inst->connection;
+    HttpResponse*          response = &conn->response;
+
+    printf("[WEATHER] Echo endpoint hit (%s)\n", conn->method);
+
+    // The read buffer lives until the connection is disposed
+    http_response_begin(response, 200);
+    http_response_add_literal(response,
+                              HTTP_CONTENT_TYPE_TEXT HTTP_HEADER_CORS);
+    http_response_add_body(response, conn->read_buffer, conn->read_buffer_size,
+                           NULL, NULL);
+    return http_response_finish(response);
+}
+
+static int weather_server_instance_current(void*                 context,
+                                           const HttpRouteMatch* match) {
+    WeatherServerInstance* inst     = (WeatherServerInstance*)context;
+    HTTPServerConnection*  conn     = inst->connection;
+    HttpResponse*          response = &conn->response;
+
+    if (conn->state != HTTP_SERVER_CONNECTION_STATE_WAIT) {
+        printf("[WEATHER] Handling /v1/current request\n");
     }
 
-    if (strcmp(conn->method, "GET") == 0 && strcmp(path, "/") == 0) {
-        printf("[WEATHER] Serving homepage\n");
-
-        const char* html =
-            "<!DOCTYPE html>"
-            "<html>"
-            "<head><title>Just Weather</title></head>"
-            "<body>"
-            "<h1>Just Weather API</h1>"
-            "<p>Available endpoints:</p>"
-            "<ul>"
-            "  <li><b>GET /echo</b> — echo raw request</li>"
-            "  <li><b>POST /echo</b> — echo raw body</li>"
-            "  <li><b>GET /v1/current?lat=XX&lon=YY</b> — current weather</li>"
-            "</ul>"
-            "<p>Source code available on <a "
-            "href=\"https://github.com/Stockholm-3/just-weather\" "
-            "target=\"_blank\">GitHub</a>.</p>"
-            "</body>"
-            "</html>";
-
-        char header[256];
-        int  header_len = snprintf(header, sizeof(header),
-                                   "HTTP/1.1 200 OK\r\n"
-                                    "Content-Type: text/html; charset=utf-8\r\n"
-                                    "Access-Control-Allow-Origin: *\r\n"
-                                    "Content-Length: %zu\r\n"
-                                    "\r\n",
-                                   strlen(html));
-
-        size_t   total = header_len + strlen(html);
-        uint8_t* buf   = malloc(total);
-
-        memcpy(buf, header, header_len);
-        memcpy(buf + header_len, html, strlen(html));
-
-        conn->write_buffer = buf;
-        conn->write_size   = total;
-        return 0;
+    WeatherResponse*   weather      = NULL;
+    WeatherCacheStatus cache_status = WEATHER_CACHE_MISS;
+
+    // Call your Open-Meteo handler
+    if (open_meteo_handler_current_response(inst->query, &weather,
+                                            &cache_status) ==
+        OPEN_METEO_HANDLER_PENDING) {
+        return HTTP_SERVER_CONNECTION_PENDING;
     }
 
-    // Echo endpoint
-    if (strcmp(path, "/echo") == 0) {
-        printf("[WEATHER] Echo endpoint hit (%s)\n", conn->method);
+    if (!weather) {
+        printf("[WEATHER] /v1/current failed: %s\n",
+               "Failed to fetch weather data from Open-Meteo API");
+        return weather_server_instance_send_static(conn,
+                                                   &g_internal_error_response);
+    }
 
-        size_t body_len = conn->read_buffer_size;
+    unsigned accepted = weather_server_instance_accepted(conn);
 
-        char header[256];
-        int  header_len = snprintf(header, sizeof(header),
-                                   "HTTP/1.1 200 OK\r\n"
-                                    "Content-Type: text/plain\r\n"
-                                    "Access-Control-Allow-Origin: *\r\n"
-                                    "Content-Length: %zu\r\n"
-                                    "\r\n",
-                                   body_len);
+    // Validators are checked before a body is picked, a 304 never compresses
+    char etag[WEATHER_ETAG_MAX_LEN] = "";
+    int  validated                  = weather->status_code == 200;
+    int  status                     = weather->status_code;
+    if (validated &&
+        weather_server_instance_not_modified(conn, weather, etag)) {
+        status = 304;
+    }
 
-        size_t   total = header_len + body_len;
-        uint8_t* resp  = malloc(total);
+    HttpEncoding encoding = HTTP_ENCODING_IDENTITY;
+    size_t       body_len = 0;
+    const void*  body     = NULL;
+    if (status != 304) {
+        body = weather_response_body(weather, accepted, &encoding, &body_len);
+        weather_server_instance_format_etag(weather, encoding, etag);
+    }
 
-        memcpy(resp, header, header_len);
-        memcpy(resp + header_len, conn->read_buffer, body_len);
+    http_response_begin(response, status);
+    http_response_add_literal(response,
+                              HTTP_HEADER_CORS HTTP_HEADER_VARY_ENCODING);
+    if (validated) {
+        // Empty on a 304 from If-Modified-Since, the cache keeps its own tag
+        if (etag[0] != '\0') {
+            http_response_add_header(response, "ETag", etag);
+        }
+        http_response_add_header(response, "Last-Modified",
+                                 weather->last_modified);
+        weather_server_instance_add_freshness(response, weather);
+        weather_server_instance_add_cache_status(response, cache_status);
+    } else {
+        // Errors say nothing about the weather, keep them out of caches
+        http_response_add_literal(response, "Cache-Control: no-store\r\n");
+    }
 
-        conn->write_buffer = resp;
-        conn->write_size   = total;
-        return 0;
+    if (status == 304) {
+        printf("[WEATHER] 304 Not Modified: %s\n", etag);
+        weather_response_release(weather);
+        return http_response_finish(response);
     }
 
-    if (strcmp(conn->method, "GET") == 0 && strcmp(path, "/v1/current") == 0) {
-        printf("[WEATHER] Handling /v1/current request\n");
+    http_response_add_literal(response, HTTP_CONTENT_TYPE_JSON);
+    if (encoding != HTTP_ENCODING_IDENTITY) {
+        http_response_add_header(response, "Content-Encoding",
+                                 http_encoding_name(encoding));
+    }
 
-        char* json_response = NULL;
-        int   status_code   = 0;
-
-        // Call your Open-Meteo handler
-        open_meteo_handler_current(query, &json_response, &status_code);
-
-        if (!json_response) {
-            // Provide a reason for failure
-            const char* reason =
-                "Failed to fetch weather data from Open-Meteo API";
-
-            char body[256];
-            int  body_len = snprintf(body, sizeof(body),
-                                     "{\n"
-                                      "  \"error\": \"Internal Server Error\",\n"
-                                      "  \"message\": \"%s\"\n"
-                                      "}\n",
-                                     reason);
-
-            char header[256];
-            int  header_len = snprintf(header, sizeof(header),
-                                       "HTTP/1.1 500 Internal Server Error\r\n"
-                                        "Content-Type: application/json\r\n"
-                                        "Access-Control-Allow-Origin: *\r\n"
-                                        "Content-Length: %d\r\n"
-                                        "\r\n",
-                                       body_len);
-
-            size_t   total_len = header_len + body_len;
-            uint8_t* response  = malloc(total_len + 1);
-            if (response) {
-                memcpy(response, header, header_len);
-                memcpy(response + header_len, body, body_len);
-                response[total_len] = '\0'; // null-terminate for safety
-
-                conn->write_buffer = response;
-                conn->write_size   = total_len;
-            }
+    // The response holds our reference until it has been sent
+    http_response_add_body(response, body, body_len, weather_response_release,
+                           weather);
+    return http_response_finish(response);
+}
 
-            printf("[WEATHER] /v1/current failed: %s\n", reason);
-            return 0;
-        }
+static int weather_server_instance_hot_locations(void* context,
+                                                 const HttpRouteMatch* match) {
+    WeatherServerInstance* inst     = (WeatherServerInstance*)context;
+    HTTPServerConnection*  conn     = inst->connection;
+    HttpResponse*          response = &conn->response;
 
-        // Success: return JSON from Open-Meteo
-        char header[256];
-        int  header_len =
-            snprintf(header, sizeof(header),
-                     "HTTP/1.1 %d %s\r\n"
-                     "Content-Type: application/json\r\n"
-                     "Access-Control-Allow-Origin: *\r\n"
-                     "Content-Length: %zu\r\n"
-                     "\r\n",
-                     status_code, status_code == 200 ? "OK" : "Error",
-                     strlen(json_response));
-
-        size_t   total_len = header_len + strlen(json_response);
-        uint8_t* response  = malloc(total_len + 1);
-        if (response) {
-            memcpy(response, header, header_len);
-            strcpy((char*)(response + header_len), json_response);
-
-            conn->write_buffer = response;
-            conn->write_size   = total_len;
-        }
+    char* json = open_meteo_handler_hot_locations_json();
+    if (!json) {
+        return weather_server_instance_send_static(conn,
+                                                   &g_internal_error_response);
+    }
 
-        free(json_response);
+    http_response_begin(response, 200);
+    http_response_add_literal(response, HTTP_CONTENT_TYPE_JSON HTTP_HEADER_CORS
+                              "Cache-Control: no-store\r\n");
+    http_response_add_body(response, json, strlen(json), free, json);
+    return http_response_finish(response);
+}
 
-        return 0;
+static int weather_server_instance_cache_stats(void*                 context,
+                                               const HttpRouteMatch* match) {
+    WeatherServerInstance* inst     = (WeatherServerInstance*)context;
+    HTTPServerConnection*  conn     = inst->connection;
+    HttpResponse*          response = &conn->response;
+
+    char* json = open_meteo_api_cache_stats_json();
+    if (!json) {
+        return weather_server_instance_send_static(conn,
+                                                   &g_internal_error_response);
     }
 
+    http_response_begin(response, 200);
+    http_response_add_literal(response, HTTP_CONTENT_TYPE_JSON HTTP_HEADER_CORS
+                              "Cache-Control: no-store\r\n");
+    http_response_add_body(response, json, strlen(json), free, json);
+    return http_response_finish(response);
+}
+
+static int weather_server_instance_method_not_allowed(
+    WeatherServerInstance* inst, const char* path, size_t path_len,
+    const char* allow) {
+    HTTPServerConnection* conn     = inst->connection;
+    HttpResponse*         response = &conn->response;
+
+    printf("[WEATHER] 405 Method Not Allowed: %s %.*s\n", conn->method,
+           (int)path_len, path);
+
+    http_response_begin(response, 405);
+    http_response_add_literal(response,
+                              HTTP_CONTENT_TYPE_JSON HTTP_HEADER_CORS);
+    http_response_add_header(response, "Allow", allow);
+    http_response_add_body(response, METHOD_NOT_ALLOWED_JSON_HEAD,
+                           sizeof(METHOD_NOT_ALLOWED_JSON_HEAD) - 1, NULL,
+                           NULL);
+    http_response_add_body(response, conn->method, strlen(conn->method), NULL,
+                           NULL);
+    http_response_add_body(response, JSON_PATH_FIELD,
+                           sizeof(JSON_PATH_FIELD) - 1, NULL, NULL);
+    http_response_add_body(response, path, path_len, NULL, NULL);
+    http_response_add_body(response, METHOD_NOT_ALLOWED_JSON_ALLOW,
+                           sizeof(METHOD_NOT_ALLOWED_JSON_ALLOW) - 1, NULL,
+                           NULL);
+    http_response_add_body(response, allow, strlen(allow), NULL, NULL);
+    http_response_add_body(response, METHOD_NOT_ALLOWED_JSON_TAIL,
+                           sizeof(METHOD_NOT_ALLOWED_JSON_TAIL) - 1, NULL,
+                           NULL);
+    return http_response_finish(response);
+}
+
+static int weather_server_instance_not_found(WeatherServerInstance* inst,
+                                             const char*            path,
+                                             size_t                 path_len) {
+    HTTPServerConnection* conn     = inst->connection;
+    HttpResponse*         response = &conn->response;
+
     // 404 Not Found for unknown endpoints
-    printf("[WEATHER] 404 Not Found: %s %s\n", conn->method, path);
-
-    const char* response_body =
-        "{\n"
-        "  \"error\": \"Not Found\",\n"
-        "  \"message\": \"The requested endpoint was not found\",\n"
-        "  \"method\": \"%s\",\n"
-        "  \"path\": \"%s\",\n"
-        "  \"available_endpoints\": [\n"
-        "    \"GET /\",\n"
-        "    \"POST /echo\",\n"
-        "    \"GET /v1/current?lat=XX&lon=YY\"\n"
-        "  ]\n"
-        "}\n";
-
-    char body[512];
-    snprintf(body, sizeof(body), response_body, conn->method, path);
-
-    char header[256];
-    int  header_len = snprintf(header, sizeof(header),
-                               "HTTP/1.1 404 Not Found\r\n"
-                                "Content-Type: application/json\r\n"
-                                "Access-Control-Allow-Origin: *\r\n"
-                                "Content-Length: %zu\r\n"
-                                "\r\n",
-                               strlen(body));
-
-    size_t   total_len = header_len + strlen(body);
-    uint8_t* response  = malloc(total_len + 1);
-
-    if (response) {
-        memcpy(response, header, header_len);
-        strcpy((char*)response + header_len, body);
-
-        conn->write_buffer = response;
-        conn->write_size   = total_len;
+    printf("[WEATHER] 404 Not Found: %s %.*s\n", conn->method, (int)path_len,
+           path);
+
+    http_response_begin(response, 404);
+    http_response_add_literal(response,
+                              HTTP_CONTENT_TYPE_JSON HTTP_HEADER_CORS);
+    http_response_add_body(response, NOT_FOUND_JSON_HEAD,
+                           sizeof(NOT_FOUND_JSON_HEAD) - 1, NULL, NULL);
+    http_response_add_body(response, conn->method, strlen(conn->method), NULL,
+                           NULL);
+    http_response_add_body(response, JSON_PATH_FIELD,
+                           sizeof(JSON_PATH_FIELD) - 1, NULL, NULL);
+    http_response_add_body(response, path, path_len, NULL, NULL);
+    http_response_add_body(response, g_not_found_tail, g_not_found_tail_len,
+                           NULL, NULL);
+    return http_response_finish(response);
+}
+
+static int weather_server_instance_not_found_tail_initiate(void) {
+    size_t count = sizeof(WEATHER_SERVER_ROUTES) /
+                   sizeof(WEATHER_SERVER_ROUTES[0]);
+
+    // Each entry is "    \"METHOD pattern\",\n"
+    size_t size = sizeof(NOT_FOUND_JSON_ENDPOINTS) + sizeof(NOT_FOUND_JSON_END);
+    for (size_t i = 0; i < count; i++) {
+        size += strlen(WEATHER_SERVER_ROUTES[i].method) +
+                strlen(WEATHER_SERVER_ROUTES[i].pattern) + 9;
+    }
+
+    char* tail = malloc(size);
+    if (!tail) {
+        return -1;
+    }
+
+    size_t len = (size_t)snprintf(tail, size, "%s", NOT_FOUND_JSON_ENDPOINTS);
+    for (size_t i = 0; i < count; i++) {
+        len += (size_t)snprintf(tail + len, size - len, "    \"%s %s\"%s\n",
+                                WEATHER_SERVER_ROUTES[i].method,
+                                WEATHER_SERVER_ROUTES[i].pattern,
+                                i + 1 < count ? "," : "");
+    }
+    len += (size_t)snprintf(tail + len, size - len, "%s", NOT_FOUND_JSON_END);
+
+    g_not_found_tail     = tail;
+    g_not_found_tail_len = len;
+    return 0;
+}
+
+static int weather_server_instance_send_static(
+    HTTPServerConnection* conn, const HttpStaticResponse* static_response) {
+    return http_response_set_static(&conn->response, static_response,
+                                    weather_server_instance_accepted(conn));
+}
+
+/* Encodings the client takes, from its Accept-Encoding header */
+static unsigned weather_server_instance_accepted(HTTPServerConnection* conn) {
+    size_t      accept_len = 0;
+    const char* accept =
+        http_server_connection_get_header(conn, "Accept-Encoding", &accept_len);
+    return http_encoding_parse_accept(accept, accept_len);
+}
+
+/**
+ * Evaluates the request's validators, If-None-Match wins over
+ * If-Modified-Since when both are present. The client may hold any encoding
+ * it accepts, so If-None-Match is compared with the tag of each and the one
+ * that matched is left in etag. Otherwise etag is left empty.
+ */
+static int weather_server_instance_not_modified(HTTPServerConnection*  conn,
+                                                const WeatherResponse* weather,
+                                                char*                  etag) {
+    size_t      len  = 0;
+    const char* list =
+        http_server_connection_get_header(conn, "If-None-Match", &len);
+    if (list) {
+        unsigned accepted = weather_server_instance_accepted(conn);
+
+        for (int i = HTTP_ENCODING_IDENTITY; i < HTTP_ENCODING_COUNT; i++) {
+            if (i != HTTP_ENCODING_IDENTITY &&
+                (!(accepted & HTTP_ENCODING_BIT(i)) ||
+                 !http_encoding_supported((HttpEncoding)i))) {
+                continue;
+            }
+
+            weather_server_instance_format_etag(weather, (HttpEncoding)i, etag);
+            if (http_etag_list_match(list, len, etag)) {
+                return 1;
+            }
+        }
+        etag[0] = '\0';
         return 0;
     }
 
+    const char* since =
+        http_server_connection_get_header(conn, "If-Modified-Since", &len);
+    time_t since_time;
+    if (since && http_parse_date(since, len, &since_time) == 0) {
+        return weather->fetched_at <= since_time;
+    }
+
     return 0;
 }
 
-void weather_server_instance_work(WeatherServerInstance* instance,
-                                  uint64_t               mon_time) {}
+/* Every encoding is its own representation, so the tag names it. etag must
+ * hold WEATHER_ETAG_MAX_LEN bytes. */
+static void weather_server_instance_format_etag(const WeatherResponse* weather,
+                                                HttpEncoding           encoding,
+                                                char*                  etag) {
+    if (encoding == HTTP_ENCODING_IDENTITY) {
+        snprintf(etag, WEATHER_ETAG_MAX_LEN, "\"%s\"", weather->etag);
+    } else {
+        snprintf(etag, WEATHER_ETAG_MAX_LEN, "\"%s-%s\"", weather->etag,
+                 http_encoding_name(encoding));
+    }
+}
+
+/**
+ * Adds Cache-Control, Age and Expires from the entry's fetch time. max-age is
+ * the full TTL and Age the time already spent, so downstream caches keep the
+ * entry for exactly the remaining TTL.
+ */
+static void weather_server_instance_add_freshness(
+    HttpResponse* response, const WeatherResponse* weather) {
+    const WeatherConfig* config = open_meteo_api_get_config();
+
+    time_t now     = time(NULL);
+    time_t expires = weather->fetched_at + weather->ttl;
+    time_t age     = now > weather->fetched_at ? now - weather->fetched_at : 0;
+
+    char   value[96];
+    size_t len = sizeof("public, max-age=") - 1;
+    memcpy(value, "public, max-age=", len);
+    len += http_format_uint(value + len, (uint64_t)weather->ttl);
+    if (config->stale_while_revalidate > 0) {
+        memcpy(value + len, ", stale-while-revalidate=",
+               sizeof(", stale-while-revalidate=") - 1);
+        len += sizeof(", stale-while-revalidate=") - 1;
+        len += http_format_uint(value + len,
+                                (uint64_t)config->stale_while_revalidate);
+    }
+    value[len] = '\0';
+
+    http_response_add_header(response, "Cache-Control", value);
+    http_response_add_header_uint(response, "Age", (uint64_t)age);
+    http_response_add_header_date(response, "Expires", expires);
+}
+
+static void weather_server_instance_add_cache_status(
+    HttpResponse* response, WeatherCacheStatus status) {
+    switch (status) {
+    case WEATHER_CACHE_HIT:
+        http_response_add_literal(response, "X-Cache: HIT\r\n");
+        break;
+    case WEATHER_CACHE_MISS:
+        http_response_add_literal(response, "X-Cache: MISS\r\n");
+        break;
+    case WEATHER_CACHE_STALE:
+        http_response_add_literal(
+            response, "X-Cache: STALE\r\n"
+                      "Warning: 110 - \"Response is Stale\"\r\n");
+        break;
+    case WEATHER_CACHE_STALE_ERROR:
+        http_response_add_literal(
+            response, "X-Cache: STALE\r\n"
+                      "Warning: 111 - \"Revalidation Failed\"\r\n");
+        break;
+    }
+}
 
-void weather_server_instance_dispose(WeatherServerInstance* instance) {}
+void weather_server_instance_on_connection_dispose(void* context) {
+    WeatherServerInstance* instance = (WeatherServerInstance*)context;
+
+    http_server_connection_dispose_ptr(&instance->connection);
+
+    if (instance->onDispose) {
+        instance->onDispose(instance->context, instance);
+    }
+}
+
+void weather_server_instance_dispose(WeatherServerInstance* instance) {
+    http_server_connection_dispose_ptr(&instance->connection);
+}
 
 void weather_server_instance_dispose_ptr(WeatherServerInstance** instance_ptr) {
     if (instance_ptr == NULL || *(instance_ptr) == NULL) {
@@ -1,19 +1,45 @@
 #ifndef WEATHER_SERVER_INSTANCE_H
 #define WEATHER_SERVER_INSTANCE_H
 
+#include "http_server/http_router.h"
 #include "http_server/http_server_connection.h"
+#include "linked_list.h"
 
-typedef struct {
+typedef struct WeatherServerInstance WeatherServerInstance;
+
+/// Called once the instance's connection has been released, the instance can
+/// then be disposed or reused for another connection.
+typedef void (*WeatherServerInstanceOnDispose)(void* context,
+                                               WeatherServerInstance* instance);
+
+struct WeatherServerInstance {
+    ListHook              hook; // Position in WeatherServer.instances
     HTTPServerConnection* connection;
-} WeatherServerInstance;
+    const HttpRouter*     router;
+    const char*           query; // Query string of the current request
+
+    void*                          context;
+    WeatherServerInstanceOnDispose onDispose;
+};
+
+/// Compiles the instance route table into router, done once at startup
+int weather_server_instance_routes_initiate(HttpRouter* router);
+
+/// Serializes the responses that never change (homepage, internal error),
+/// with their compressed variants, once at startup
+int  weather_server_instance_responses_initiate(void);
+void weather_server_instance_responses_dispose(void);
 
 int weather_server_instance_initiate(WeatherServerInstance* instance,
-                                     HTTPServerConnection*  connection);
+                                     HTTPServerConnection*  connection,
+                                     const HttpRouter*      router);
 int weather_server_instance_initiate_ptr(HTTPServerConnection*   connection,
+                                         const HttpRouter*       router,
                                          WeatherServerInstance** instance_ptr);
 
-void weather_server_instance_work(WeatherServerInstance* instance,
-                                  uint64_t               mon_time);
+void weather_server_instance_set_callback(
+    WeatherServerInstance* instance, void* context,
+    WeatherServerInstanceOnDispose on_dispose);
 
 void weather_server_instance_dispose(WeatherServerInstance* instance);
 void weather_server_instance_dispose_ptr(WeatherServerInstance** instance_ptr);
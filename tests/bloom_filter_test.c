@@ -0,0 +1,106 @@
+#include "bloom_filter.h"
+#include "main.h"
+
+#include <stdio.h>
+
+#define KEYS 100000
+
+/* Well-spread test hashes, splitmix64 of the index */
+static uint64_t hash_of(uint64_t i) {
+    uint64_t z = i * 0x9e3779b97f4a7c15ull;
+    z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z          = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static double measured_rate(const BloomFilter* filter, uint64_t first) {
+    size_t positives = 0;
+    for (uint64_t i = first; i < first + KEYS; i++) {
+        positives += bloom_filter_may_contain(filter, hash_of(i));
+    }
+    return (double)positives / KEYS;
+}
+
+TEST(test_no_false_negatives) {
+    BloomFilter filter;
+    assert(bloom_filter_initiate(&filter, KEYS, 0) == 0);
+    for (uint64_t i = 0; i < KEYS; i++) {
+        bloom_filter_add(&filter, hash_of(i));
+    }
+    assert(filter.count == KEYS);
+    for (uint64_t i = 0; i < KEYS; i++) {
+        assert(bloom_filter_may_contain(&filter, hash_of(i)));
+    }
+    bloom_filter_dispose(&filter);
+}
+
+TEST(test_weak_hashes) {
+    // Hashes differing only in their low or only in their high bits
+    BloomFilter filter;
+    assert(bloom_filter_initiate(&filter, 2 * 4096, 0) == 0);
+    for (uint64_t i = 0; i < 4096; i++) {
+        bloom_filter_add(&filter, i);
+        bloom_filter_add(&filter, i << 52);
+    }
+    for (uint64_t i = 0; i < 4096; i++) {
+        assert(bloom_filter_may_contain(&filter, i));
+        assert(bloom_filter_may_contain(&filter, i << 52));
+    }
+    bloom_filter_dispose(&filter);
+}
+
+TEST(test_overfilled) {
+    // Past its capacity it only gets less selective
+    BloomFilter filter;
+    assert(bloom_filter_initiate(&filter, KEYS / 8, 0) == 0);
+    for (uint64_t i = 0; i < KEYS; i++) {
+        bloom_filter_add(&filter, hash_of(i));
+    }
+    for (uint64_t i = 0; i < KEYS; i++) {
+        assert(bloom_filter_may_contain(&filter, hash_of(i)));
+    }
+    bloom_filter_dispose(&filter);
+}
+
+TEST(test_false_positive_rate) {
+    BloomFilter filter;
+    assert(bloom_filter_initiate(&filter, KEYS, 0) == 0);
+    assert(bloom_filter_false_positive_rate(&filter) == 0.0);
+    assert(measured_rate(&filter, 0) == 0.0);
+
+    for (uint64_t i = 0; i < KEYS; i++) {
+        bloom_filter_add(&filter, hash_of(i));
+    }
+
+    // About 1.3% at the default bits per key, and the estimate agrees
+    double rate     = measured_rate(&filter, KEYS);
+    double estimate = bloom_filter_false_positive_rate(&filter);
+    printf("  measured %.4f, estimated %.4f\n", rate, estimate);
+    assert(rate > 0.0 && rate < 0.03);
+    assert(estimate > rate / 2 && estimate < rate * 2);
+    bloom_filter_dispose(&filter);
+}
+
+TEST(test_clear) {
+    BloomFilter filter;
+    assert(bloom_filter_initiate(&filter, 0, 0) == 0);
+    assert(filter.block_count > 0);
+    bloom_filter_add(&filter, hash_of(1));
+    assert(bloom_filter_may_contain(&filter, hash_of(1)));
+
+    bloom_filter_clear(&filter);
+    assert(filter.count == 0);
+    assert(!bloom_filter_may_contain(&filter, hash_of(1)));
+    bloom_filter_dispose(&filter);
+}
+
+int main(void) {
+    RUN_TEST(test_no_false_negatives);
+    RUN_TEST(test_weak_hashes);
+    RUN_TEST(test_overfilled);
+    RUN_TEST(test_false_positive_rate);
+    RUN_TEST(test_clear);
+
+    printf("All Bloom filter tests passed\n");
+    return 0;
+}
@@ -0,0 +1,260 @@
+#include "circuit_breaker.h"
+#include "main.h"
+
+#include <stdio.h>
+
+#define OPEN_MS 1000
+
+/* Starts as many calls as the breaker admits at now */
+static unsigned acquire_all(CircuitBreaker* breaker, uint64_t now) {
+    unsigned count = 0;
+    while (circuit_breaker_acquire(breaker, now)) {
+        count++;
+    }
+    return count;
+}
+
+static void release_all(CircuitBreaker* breaker, uint64_t now, unsigned count,
+                        int success, double latency_ms) {
+    for (unsigned i = 0; i < count; i++) {
+        circuit_breaker_release(breaker, now, success, latency_ms);
+    }
+}
+
+/* One call at a time, returns the time after it */
+static uint64_t call(CircuitBreaker* breaker, uint64_t now, int success,
+                     double latency_ms) {
+    assert(circuit_breaker_acquire(breaker, now));
+    now += (uint64_t)latency_ms;
+    circuit_breaker_release(breaker, now, success, latency_ms);
+    return now;
+}
+
+/* Opens a fresh breaker with failed calls, returns the time it opened */
+static uint64_t trip(CircuitBreaker* breaker, uint64_t now) {
+    while (breaker->state == CIRCUIT_CLOSED) {
+        now = call(breaker, now, 0, 10);
+    }
+    assert(breaker->state == CIRCUIT_OPEN);
+    return now;
+}
+
+TEST(test_trips_on_error_rate) {
+    CircuitBreaker breaker;
+    circuit_breaker_initiate(&breaker, 4, 16);
+    circuit_breaker_set_thresholds(&breaker, 50, 0, OPEN_MS);
+    uint64_t now = 1000;
+
+    // One failure in four keeps the average below half
+    for (int i = 0; i < 40; i++) {
+        now = call(&breaker, now, i % 4 != 3, 10);
+    }
+    assert(breaker.state == CIRCUIT_CLOSED);
+    assert(breaker.error_rate < 0.5);
+
+    // Nothing but failures, yet not before enough samples since closing
+    circuit_breaker_initiate(&breaker, 4, 16);
+    circuit_breaker_set_thresholds(&breaker, 50, 0, OPEN_MS);
+    for (int i = 1; i < CIRCUIT_BREAKER_MIN_SAMPLES; i++) {
+        now = call(&breaker, now, 0, 10);
+        assert(breaker.state == CIRCUIT_CLOSED);
+    }
+    now = call(&breaker, now, 0, 10);
+    assert(breaker.state == CIRCUIT_OPEN);
+    assert(breaker.opened == 1);
+    assert(breaker.open_until == now + OPEN_MS);
+
+    // Refused without reaching upstream until the open time is over
+    assert(!circuit_breaker_acquire(&breaker, now));
+    assert(!circuit_breaker_acquire(&breaker, now + OPEN_MS - 1));
+    assert(breaker.rejected == 2);
+    assert(circuit_breaker_acquire(&breaker, now + OPEN_MS));
+    assert(breaker.state == CIRCUIT_HALF_OPEN);
+}
+
+TEST(test_trips_on_latency) {
+    CircuitBreaker breaker;
+    circuit_breaker_initiate(&breaker, 4, 16);
+    circuit_breaker_set_thresholds(&breaker, 0, 500, OPEN_MS);
+    uint64_t now = 1000;
+
+    // With the error trigger off failures alone never open it
+    for (int i = 0; i < 20; i++) {
+        now = call(&breaker, now, 0, 100);
+    }
+    assert(breaker.state == CIRCUIT_CLOSED);
+
+    // Successful but slow calls do, once the average gets there
+    int slow = 0;
+    while (breaker.state == CIRCUIT_CLOSED) {
+        now = call(&breaker, now, 1, 1000);
+        slow++;
+        assert(slow < 20);
+    }
+    assert(breaker.latency_ms >= 500);
+    assert(slow > 1);
+    printf("  opened after %d slow calls\n", slow);
+}
+
+TEST(test_half_open_probes) {
+    CircuitBreaker breaker;
+    circuit_breaker_initiate(&breaker, 4, 16);
+    circuit_breaker_set_thresholds(&breaker, 50, 0, OPEN_MS);
+    uint64_t now = trip(&breaker, 1000) + OPEN_MS;
+
+    // One probe at a time, a cancelled one frees its place
+    assert(circuit_breaker_acquire(&breaker, now));
+    assert(breaker.state == CIRCUIT_HALF_OPEN);
+    assert(!circuit_breaker_acquire(&breaker, now));
+    circuit_breaker_cancel(&breaker);
+    assert(breaker.state == CIRCUIT_HALF_OPEN);
+
+    for (int i = 1; i < CIRCUIT_BREAKER_PROBES; i++) {
+        now = call(&breaker, now, 1, 10);
+        assert(breaker.state == CIRCUIT_HALF_OPEN);
+        assert(breaker.probes == (uint32_t)i);
+    }
+    now = call(&breaker, now, 1, 10);
+    assert(breaker.state == CIRCUIT_CLOSED);
+
+    // The outage is forgotten, failures need the full sample count again
+    assert(breaker.samples == 0);
+    assert(breaker.error_rate == 0.0);
+    for (int i = 1; i < CIRCUIT_BREAKER_MIN_SAMPLES; i++) {
+        now = call(&breaker, now, 0, 10);
+    }
+    assert(breaker.state == CIRCUIT_CLOSED);
+}
+
+TEST(test_backoff) {
+    CircuitBreaker breaker;
+    circuit_breaker_initiate(&breaker, 4, 16);
+    circuit_breaker_set_thresholds(&breaker, 50, 0, OPEN_MS);
+    uint64_t now = trip(&breaker, 1000);
+    assert(breaker.open_until - now == OPEN_MS);
+
+    // Every failed probe doubles the wait, up to the cap
+    uint64_t expected = OPEN_MS;
+    for (int i = 0; i < 8; i++) {
+        now = breaker.open_until;
+        now = call(&breaker, now, 0, 10);
+        assert(breaker.state == CIRCUIT_OPEN);
+
+        expected *= 2;
+        if (expected > OPEN_MS * CIRCUIT_BREAKER_MAX_BACKOFF) {
+            expected = OPEN_MS * CIRCUIT_BREAKER_MAX_BACKOFF;
+        }
+        assert(breaker.open_until - now == expected);
+    }
+    assert(expected == OPEN_MS * CIRCUIT_BREAKER_MAX_BACKOFF);
+
+    // Closing again starts over from the configured open time
+    now = breaker.open_until;
+    for (int i = 0; i < CIRCUIT_BREAKER_PROBES; i++) {
+        now = call(&breaker, now, 1, 10);
+    }
+    assert(breaker.state == CIRCUIT_CLOSED);
+    now = trip(&breaker, now);
+    assert(breaker.open_until - now == OPEN_MS);
+}
+
+TEST(test_limit) {
+    CircuitBreaker breaker;
+    circuit_breaker_initiate(&breaker, 8, 32);
+    circuit_breaker_set_thresholds(&breaker, 50, 0, OPEN_MS);
+    uint64_t now = 1000;
+
+    // Fully used at a steady latency the limit grows. Only the releases while
+    // at least half of it was in flight count, so half a call a round.
+    for (int round = 0; round < 10; round++) {
+        unsigned count = acquire_all(&breaker, now);
+        assert(count == (unsigned)breaker.limit);
+        now += 100;
+        release_all(&breaker, now, count, 1, 100);
+    }
+    assert(breaker.limit > 12.5 && breaker.limit < 14);
+
+    // Barely used it does not
+    double limit = breaker.limit;
+    for (int i = 0; i < 50; i++) {
+        now = call(&breaker, now, 1, 100);
+    }
+    assert(breaker.limit == limit);
+
+    // A failure halves it, once per round trip however many fail
+    now = call(&breaker, now, 0, 100);
+    assert(breaker.limit == limit / 2);
+    now = call(&breaker, now, 1, 10);
+    now = call(&breaker, now, 0, 10);
+    assert(breaker.limit == limit / 2);
+
+    // So does a call far slower than usual, though it succeeded
+    now += 1000;
+    now = call(&breaker, now, 1, 100 * CIRCUIT_BREAKER_LATENCY_TOLERANCE + 50);
+    assert(breaker.limit == limit / 4);
+    assert(breaker.state == CIRCUIT_CLOSED);
+
+    // Never below the minimum, with the error trigger off to stay closed
+    circuit_breaker_set_thresholds(&breaker, 0, 0, OPEN_MS);
+    for (int i = 0; i < 20; i++) {
+        now += 1000;
+        now = call(&breaker, now, 0, 10);
+    }
+    assert(breaker.state == CIRCUIT_CLOSED);
+    assert(breaker.limit == CIRCUIT_BREAKER_MIN_LIMIT);
+    circuit_breaker_set_thresholds(&breaker, 50, 0, OPEN_MS);
+
+    // Then grows back while upstream keeps up, up to the maximum
+    int rounds = 0;
+    while (breaker.limit < 8) {
+        unsigned count = acquire_all(&breaker, now);
+        now += 100;
+        release_all(&breaker, now, count, 1, 100);
+        rounds++;
+    }
+    printf("  back from %d to 8 in %d rounds\n", CIRCUIT_BREAKER_MIN_LIMIT,
+           rounds);
+    for (int round = 0; round < 200; round++) {
+        unsigned count = acquire_all(&breaker, now);
+        now += 100;
+        release_all(&breaker, now, count, 1, 100);
+    }
+    assert(breaker.limit == 32);
+    assert(acquire_all(&breaker, now) == 32);
+}
+
+TEST(test_limit_after_outage) {
+    CircuitBreaker breaker;
+    circuit_breaker_initiate(&breaker, 16, 32);
+    circuit_breaker_set_thresholds(&breaker, 0, 500, OPEN_MS);
+    uint64_t now = 1000;
+
+    // Opened by latency short of congestion, so the limit is still whole
+    for (int i = 0; i < 20; i++) {
+        now = call(&breaker, now, 1, 400);
+    }
+    while (breaker.state == CIRCUIT_CLOSED) {
+        now = call(&breaker, now, 1, 700);
+    }
+    assert(breaker.limit == 16);
+
+    // A recovering upstream gets half of it at first
+    now = breaker.open_until;
+    for (int i = 0; i < CIRCUIT_BREAKER_PROBES; i++) {
+        now = call(&breaker, now, 1, 100);
+    }
+    assert(breaker.state == CIRCUIT_CLOSED);
+    assert(breaker.limit == 8);
+}
+
+int main(void) {
+    RUN_TEST(test_trips_on_error_rate);
+    RUN_TEST(test_trips_on_latency);
+    RUN_TEST(test_half_open_probes);
+    RUN_TEST(test_backoff);
+    RUN_TEST(test_limit);
+    RUN_TEST(test_limit_after_outage);
+
+    printf("All circuit breaker tests passed\n");
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include "curl_pool.h"
+#include "main.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const char RESPONSE[] = "HTTP/1.1 200 OK\r\n"
+                               "Content-Length: 2\r\n"
+                               "\r\n"
+                               "ok";
+
+/* Local HTTP/1.1 listener that keeps connections alive and counts them */
+static int  g_listen_fd = -1;
+static char g_url[64];
+static int  g_accepted;
+
+static void* serve_connection(void* context) {
+    int  fd = (int)(intptr_t)context;
+    char buffer[4096];
+    int  used = 0;
+
+    for (;;) {
+        ssize_t n = recv(fd, buffer + used, sizeof(buffer) - 1 - used, 0);
+        if (n <= 0) {
+            break;
+        }
+        used += (int)n;
+        buffer[used] = '\0';
+
+        // Answer every complete request, keep what follows
+        char* end;
+        while ((end = strstr(buffer, "\r\n\r\n")) != NULL) {
+            if (send(fd, RESPONSE, sizeof(RESPONSE) - 1, MSG_NOSIGNAL) < 0) {
+                break;
+            }
+            int rest = used - (int)(end + 4 - buffer);
+            memmove(buffer, end + 4, rest + 1);
+            used = rest;
+        }
+    }
+
+    close(fd);
+    return NULL;
+}
+
+static void* serve(void* context) {
+    (void)context;
+    for (;;) {
+        int fd = accept(g_listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+        __atomic_add_fetch(&g_accepted, 1, __ATOMIC_SEQ_CST);
+
+        pthread_t thread;
+        pthread_create(&thread, NULL, serve_connection, (void*)(intptr_t)fd);
+        pthread_detach(thread);
+    }
+}
+
+static int accepted(void) {
+    return __atomic_load_n(&g_accepted, __ATOMIC_SEQ_CST);
+}
+
+static size_t count_body(char* data, size_t size, size_t count, void* out) {
+    (void)data;
+    *(size_t*)out += size * count;
+    return size * count;
+}
+
+/* Points a pooled handle at the listener, body bytes are added to received */
+static void prepare(CURL* curl, size_t* received) {
+    curl_easy_setopt(curl, CURLOPT_URL, g_url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, count_body);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, received);
+}
+
+static void fetch(CurlPool* pool) {
+    size_t received = 0;
+    CURL*  curl     = curl_pool_acquire(pool);
+    assert(curl != NULL);
+    prepare(curl, &received);
+    assert(curl_easy_perform(curl) == CURLE_OK);
+    assert(received == 2);
+    curl_pool_release(pool, curl);
+}
+
+TEST(test_reuse) {
+    CurlPool pool;
+    assert(curl_pool_initiate(&pool, 2, NULL, 0) == 0);
+    int before = accepted();
+
+    // The released handle comes back, with its options reset
+    CURL* curl = curl_pool_acquire(&pool);
+    assert(curl != NULL);
+    size_t received = 0;
+    prepare(curl, &received);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*)&received);
+    assert(curl_easy_perform(curl) == CURLE_OK);
+    curl_pool_release(&pool, curl);
+    assert(pool.idle_count == 1);
+
+    CURL* again = curl_pool_acquire(&pool);
+    assert(again == curl);
+    char* private_data = (char*)&received;
+    assert(curl_easy_getinfo(again, CURLINFO_PRIVATE, &private_data) ==
+           CURLE_OK);
+    assert(private_data == NULL);
+    curl_pool_release(&pool, again);
+
+    // Later transfers send on the kept-alive connection
+    for (int i = 0; i < 5; i++) {
+        fetch(&pool);
+    }
+    assert(pool.requests == 7);
+    assert(pool.connections == 1);
+    assert(accepted() - before == 1);
+    curl_pool_dispose(&pool);
+}
+
+TEST(test_capacity) {
+    CurlPool pool;
+    assert(curl_pool_initiate(&pool, 2, NULL, 0) == 0);
+
+    CURL* curls[3];
+    for (int i = 0; i < 3; i++) {
+        curls[i] = curl_pool_acquire(&pool);
+        assert(curls[i] != NULL);
+    }
+    assert(curls[0] != curls[1] && curls[1] != curls[2]);
+
+    // Only capacity handles are kept, the one over it is cleaned up
+    for (int i = 0; i < 3; i++) {
+        curl_pool_release(&pool, curls[i]);
+    }
+    assert(pool.idle_count == 2);
+    assert(pool.idle[0] == curls[0] && pool.idle[1] == curls[1]);
+    assert(pool.requests == 3);
+
+    curl_pool_release(&pool, NULL);
+    assert(pool.requests == 3);
+    curl_pool_dispose(&pool);
+}
+
+TEST(test_multi) {
+    CurlPool pool;
+    assert(curl_pool_initiate(&pool, 4, NULL, 0) == 0);
+    CURLM* multi = curl_multi_init();
+    assert(multi != NULL);
+    curl_pool_setup_multi(&pool, multi);
+
+    CURL*  curls[4];
+    size_t received[4] = {0};
+    for (int i = 0; i < 4; i++) {
+        curls[i] = curl_pool_acquire(&pool);
+        prepare(curls[i], &received[i]);
+        assert(curl_multi_add_handle(multi, curls[i]) == CURLM_OK);
+    }
+
+    int running = 1;
+    while (running) {
+        assert(curl_multi_perform(multi, &running) == CURLM_OK);
+        if (running) {
+            curl_multi_poll(multi, NULL, 0, 100, NULL);
+        }
+    }
+
+    CURLMsg* message;
+    int      queued;
+    int      done = 0;
+    while ((message = curl_multi_info_read(multi, &queued)) != NULL) {
+        assert(message->msg == CURLMSG_DONE);
+        assert(message->data.result == CURLE_OK);
+        done++;
+    }
+    assert(done == 4);
+
+    // Handles leave the multi handle before they go back
+    for (int i = 0; i < 4; i++) {
+        assert(received[i] == 2);
+        assert(curl_multi_remove_handle(multi, curls[i]) == CURLM_OK);
+        curl_pool_release(&pool, curls[i]);
+    }
+    curl_multi_cleanup(multi);
+    assert(pool.idle_count == 4);
+    assert(pool.requests == 4);
+
+    // The connections they opened are cached for the next blocking fetch
+    uint64_t connections = pool.connections;
+    fetch(&pool);
+    assert(pool.connections == connections);
+    curl_pool_dispose(&pool);
+}
+
+TEST(test_dispose_order) {
+    CurlPool pool;
+    assert(curl_pool_initiate(&pool, 2, NULL, 0) == 0);
+    fetch(&pool);
+
+    // Idle handles hold the share, so it can only go after them
+    assert(curl_share_cleanup(pool.share) == CURLSHE_IN_USE);
+    curl_pool_dispose(&pool);
+    assert(pool.share == NULL);
+    assert(pool.idle == NULL);
+    assert(pool.idle_count == 0);
+
+    // A pool that never handed out a handle disposes as well
+    assert(curl_pool_initiate(&pool, 0, "/nonexistent/ca.pem", 1) == 0);
+    assert(pool.capacity == CURL_POOL_DEFAULT_HANDLES);
+    curl_pool_dispose(&pool);
+    assert(pool.ca_file == NULL);
+}
+
+int main(void) {
+    g_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(g_listen_fd >= 0);
+    struct sockaddr_in address = {0};
+    address.sin_family         = AF_INET;
+    address.sin_addr.s_addr    = htonl(INADDR_LOOPBACK);
+    socklen_t length           = sizeof(address);
+    assert(bind(g_listen_fd, (struct sockaddr*)&address, length) == 0);
+    assert(listen(g_listen_fd, 16) == 0);
+    assert(getsockname(g_listen_fd, (struct sockaddr*)&address, &length) == 0);
+    snprintf(g_url, sizeof(g_url), "http://127.0.0.1:%d/",
+             ntohs(address.sin_port));
+
+    pthread_t server;
+    assert(pthread_create(&server, NULL, serve, NULL) == 0);
+    assert(curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK);
+
+    RUN_TEST(test_reuse);
+    RUN_TEST(test_capacity);
+    RUN_TEST(test_multi);
+    RUN_TEST(test_dispose_order);
+
+    curl_global_cleanup();
+    shutdown(g_listen_fd, SHUT_RDWR);
+    pthread_join(server, NULL);
+    close(g_listen_fd);
+
+    printf("All curl pool tests passed\n");
+    return 0;
+}
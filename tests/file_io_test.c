@@ -0,0 +1,136 @@
+#include "file_io.h"
+#include "main.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FILE_SIZE 65536
+#define DEPTH 8
+
+static char g_path[] = "/tmp/file_io_test.XXXXXX";
+static int  g_fd     = -1;
+
+typedef struct {
+    int     done;
+    ssize_t result;
+} Read;
+
+static void on_read(void* context, ssize_t result) {
+    Read* read = (Read*)context;
+    read->done++;
+    read->result = result;
+}
+
+static uint8_t byte_at(size_t offset) { return (uint8_t)(offset * 31 + 7); }
+
+/* Runs the event loop until count reads completed, or fails after 5 s */
+static void wait_for(const Read* reads, size_t count) {
+    time_t deadline = time(NULL) + 5;
+    for (;;) {
+        size_t done = 0;
+        for (size_t i = 0; i < count; i++) {
+            done += reads[i].done;
+        }
+        if (done == count) {
+            return;
+        }
+        assert(time(NULL) < deadline);
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        smw_work((uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+        usleep(100);
+    }
+}
+
+TEST(test_read_ranges) {
+    FileIo io;
+    assert(file_io_initiate(&io, DEPTH, 0) == 0);
+    printf("  backend %s\n", file_io_backend_name(&io));
+
+    static uint8_t buffers[DEPTH][4096];
+    Read           reads[DEPTH] = {0};
+    for (size_t i = 0; i < DEPTH; i++) {
+        off_t offset = (off_t)(i * 7919);
+        assert(file_io_read(&io, g_fd, buffers[i], sizeof(buffers[i]), offset,
+                            on_read, &reads[i]) == 0);
+    }
+    assert(io.in_flight == DEPTH);
+
+    wait_for(reads, DEPTH);
+    for (size_t i = 0; i < DEPTH; i++) {
+        assert(reads[i].done == 1);
+        assert(reads[i].result == sizeof(buffers[i]));
+        for (size_t j = 0; j < sizeof(buffers[i]); j++) {
+            assert(buffers[i][j] == byte_at(i * 7919 + j));
+        }
+    }
+    assert(io.in_flight == 0);
+    assert(io.completed == DEPTH);
+    file_io_dispose(&io);
+}
+
+TEST(test_short_and_failed_reads) {
+    FileIo io;
+    assert(file_io_initiate(&io, DEPTH, 0) == 0);
+
+    uint8_t buffer[256];
+    Read    reads[3] = {0};
+    assert(file_io_read(&io, g_fd, buffer, sizeof(buffer), FILE_SIZE - 100,
+                        on_read, &reads[0]) == 0);
+    assert(file_io_read(&io, g_fd, buffer, sizeof(buffer), FILE_SIZE * 2,
+                        on_read, &reads[1]) == 0);
+    assert(file_io_read(&io, 12345, buffer, sizeof(buffer), 0, on_read,
+                        &reads[2]) == 0);
+
+    wait_for(reads, 3);
+    assert(reads[0].result == 100);
+    assert(reads[1].result == 0);
+    assert(reads[2].result == -EBADF);
+    file_io_dispose(&io);
+}
+
+TEST(test_depth_limit) {
+    FileIo io;
+    assert(file_io_initiate(&io, 2, 0) == 0);
+
+    uint8_t buf[3][64];
+    Read    reads[3] = {0};
+    assert(file_io_read(&io, g_fd, buf[0], 64, 0, on_read, &reads[0]) == 0);
+    assert(file_io_read(&io, g_fd, buf[1], 64, 0, on_read, &reads[1]) == 0);
+    assert(file_io_read(&io, g_fd, buf[2], 64, 0, on_read, &reads[2]) == -1);
+
+    // Dispose delivers what is still in flight
+    file_io_dispose(&io);
+    assert(reads[0].done == 1 && reads[0].result == 64);
+    assert(reads[1].done == 1 && reads[1].result == 64);
+    assert(reads[2].done == 0);
+}
+
+int main(void) {
+    g_fd = mkstemp(g_path);
+    assert(g_fd >= 0);
+    uint8_t* data = malloc(FILE_SIZE);
+    assert(data != NULL);
+    for (size_t i = 0; i < FILE_SIZE; i++) {
+        data[i] = byte_at(i);
+    }
+    assert(write(g_fd, data, FILE_SIZE) == FILE_SIZE);
+    free(data);
+    assert(smw_init() == 0);
+
+    RUN_TEST(test_read_ranges);
+    RUN_TEST(test_short_and_failed_reads);
+    RUN_TEST(test_depth_limit);
+
+    smw_dispose();
+    close(g_fd);
+    unlink(g_path);
+
+    printf("All file I/O tests passed\n");
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "hash_md5.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MESSAGES 4096
+#define BYTES_PER_RUN (64u << 20)
+
+static volatile unsigned char g_sink;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Hashes MESSAGES messages of size bytes in batches until BYTES_PER_RUN,
+ * returns ns per message */
+static double run(const void* const* data, const size_t* sizes, size_t size,
+                  unsigned char* output) {
+    size_t rounds = BYTES_PER_RUN / (MESSAGES * (size + 1)) + 1;
+
+    double start = now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        hash_md5_binary_many(data, sizes, MESSAGES, output);
+        g_sink ^= output[r % MESSAGES];
+    }
+    return (now_ns() - start) / (double)(rounds * MESSAGES);
+}
+
+int main(void) {
+    // Disk cache names hash about 30 bytes, the rest shows longer messages
+    static const size_t SIZES[] = {30, 55, 64, 256, 1024};
+    static const struct {
+        HashMd5ManyBackend backend;
+        const char*        name;
+    } BACKENDS[] = {
+        {HASH_MD5_MANY_SCALAR, "scalar"},
+        {HASH_MD5_MANY_SSE2, "sse2"},
+        {HASH_MD5_MANY_AVX2, "avx2"},
+    };
+
+    unsigned char* buffer = malloc(MESSAGES * 1024);
+    unsigned char* output = malloc(MESSAGES * HASH_MD5_BINARY_LENGTH);
+    const void**   data   = malloc(MESSAGES * sizeof(void*));
+    size_t*        sizes  = malloc(MESSAGES * sizeof(size_t));
+    if (!buffer || !output || !data || !sizes) {
+        return 1;
+    }
+    for (size_t i = 0; i < MESSAGES * 1024; i++) {
+        buffer[i] = (unsigned char)(i * 2654435761u >> 13);
+    }
+
+    printf("MD5 of %d messages per call, ns per message (MB/s):\n", MESSAGES);
+    printf("  %-6s", "bytes");
+    for (size_t b = 0; b < sizeof(BACKENDS) / sizeof(BACKENDS[0]); b++) {
+        printf(" %20s", BACKENDS[b].name);
+    }
+    printf("\n");
+
+    for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); s++) {
+        for (size_t i = 0; i < MESSAGES; i++) {
+            data[i]  = buffer + i * SIZES[s] % (MESSAGES * 1024 - SIZES[s]);
+            sizes[i] = SIZES[s];
+        }
+
+        printf("  %-6zu", SIZES[s]);
+        for (size_t b = 0; b < sizeof(BACKENDS) / sizeof(BACKENDS[0]); b++) {
+            if (hash_md5_many_set_backend(BACKENDS[b].backend) != 0) {
+                printf(" %20s", "n/a");
+                continue;
+            }
+            double ns = run(data, sizes, SIZES[s], output);
+            printf(" %9.1f (%8.1f)", ns, (double)SIZES[s] / ns * 1e3);
+        }
+        printf("\n");
+    }
+    hash_md5_many_set_backend(HASH_MD5_MANY_AUTO);
+
+    free(buffer);
+    free(output);
+    free(data);
+    free(sizes);
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "hash_md5.h"
+#include "main.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Lengths around the padding boundaries: the length fits in the last block
+ * up to 55 bytes, from 56 it needs one more */
+static const size_t LENGTHS[] = {0, 1, 55, 56, 63, 64, 119, 120, 128, 4099};
+
+#define LENGTH_COUNT (sizeof(LENGTHS) / sizeof(LENGTHS[0]))
+#define MESSAGES 37
+
+static unsigned char g_data[MESSAGES][4099];
+
+static const struct {
+    HashMd5ManyBackend backend;
+    const char*        name;
+} BACKENDS[] = {
+    {HASH_MD5_MANY_SCALAR, "scalar"},
+    {HASH_MD5_MANY_SSE2, "sse2"},
+    {HASH_MD5_MANY_AVX2, "avx2"},
+};
+
+static void check_many(const size_t* sizes, size_t count) {
+    const void*   data[MESSAGES] = {0};
+    unsigned char many[MESSAGES][HASH_MD5_BINARY_LENGTH];
+    for (size_t i = 0; i < count; i++) {
+        data[i] = g_data[i];
+    }
+    assert(hash_md5_binary_many(data, sizes, count, &many[0][0]) == 0);
+
+    for (size_t i = 0; i < count; i++) {
+        unsigned char one[HASH_MD5_BINARY_LENGTH];
+        assert(hash_md5_binary(g_data[i], sizes[i], one) == 0);
+        assert(memcmp(many[i], one, HASH_MD5_BINARY_LENGTH) == 0);
+    }
+}
+
+TEST(test_known_digests) {
+    char hex[HASH_MD5_STRING_LENGTH];
+    assert(hash_md5_string("", 0, hex, sizeof(hex)) == 0);
+    assert(strcmp(hex, "d41d8cd98f00b204e9800998ecf8427e") == 0);
+    assert(hash_md5_string("abc", 3, hex, sizeof(hex)) == 0);
+    assert(strcmp(hex, "900150983cd24fb0d6963f7d28e17f72") == 0);
+
+    const char* text = "12345678901234567890123456789012345678901234567890123"
+                       "456789012345678901234567890";
+    assert(hash_md5_string(text, strlen(text), hex, sizeof(hex)) == 0);
+    assert(strcmp(hex, "57edf4a22be3c955ac49da2e2107b67a") == 0);
+}
+
+TEST(test_lanes_match_scalar) {
+    for (size_t b = 0; b < sizeof(BACKENDS) / sizeof(BACKENDS[0]); b++) {
+        if (hash_md5_many_set_backend(BACKENDS[b].backend) != 0) {
+            printf("  %s not available, skipped\n", BACKENDS[b].name);
+            continue;
+        }
+        assert(strcmp(hash_md5_many_backend(), BACKENDS[b].name) == 0);
+        printf("  %s\n", BACKENDS[b].name);
+
+        // Every length on its own, filling all lanes
+        size_t sizes[MESSAGES];
+        for (size_t l = 0; l < LENGTH_COUNT; l++) {
+            for (size_t i = 0; i < 9; i++) {
+                sizes[i] = LENGTHS[l];
+            }
+            check_many(sizes, 9);
+        }
+
+        // Mixed lengths, lanes finish at different blocks and take the next
+        // message while the others are still busy
+        for (size_t count = 2; count <= MESSAGES; count++) {
+            for (size_t i = 0; i < count; i++) {
+                sizes[i] = LENGTHS[(i * 5 + count) % LENGTH_COUNT];
+            }
+            check_many(sizes, count);
+        }
+    }
+
+    assert(hash_md5_many_set_backend(HASH_MD5_MANY_AUTO) == 0);
+}
+
+TEST(test_invalid_input) {
+    size_t        size = 1;
+    unsigned char out[HASH_MD5_BINARY_LENGTH];
+    const void*   data[2]  = {g_data[0], NULL};
+    size_t        sizes[2] = {1, 1};
+
+    assert(hash_md5_binary_many(NULL, NULL, 0, NULL) == 0);
+    assert(hash_md5_binary_many(NULL, &size, 1, out) == -1);
+    assert(hash_md5_binary_many(data, sizes, 2, out) == -1);
+    assert(hash_md5_many_set_backend((HashMd5ManyBackend)99) == -1);
+}
+
+int main(void) {
+    for (size_t i = 0; i < MESSAGES; i++) {
+        for (size_t j = 0; j < sizeof(g_data[i]); j++) {
+            g_data[i][j] = (unsigned char)(i * 131 + j * 7 + (j >> 8));
+        }
+    }
+
+    RUN_TEST(test_known_digests);
+    RUN_TEST(test_lanes_match_scalar);
+    RUN_TEST(test_invalid_input);
+
+    printf("All MD5 tests passed\n");
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include "http_server/http_router.h"
+#include "main.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SIBLINGS 300
+
+static int handle(void* context, const HttpRouteMatch* match) {
+    (void)context;
+    (void)match;
+    return 0;
+}
+
+static HttpRouterResult match_path(const HttpRouter* router, const char* method,
+                                   const char* path, HttpRouteMatch* match) {
+    return http_router_match(router, method, path, strlen(path), match);
+}
+
+/* Compares a captured parameter with value */
+static int param_is(const HttpRouteMatch* match, const char* name,
+                    const char* value) {
+    const HttpRouteParam* param = http_route_match_param(match, name);
+    return param != NULL && param->value_len == strlen(value) &&
+           memcmp(param->value, value, param->value_len) == 0;
+}
+
+TEST(test_many_siblings) {
+    static char      patterns[SIBLINGS][24];
+    static HttpRoute routes[SIBLINGS];
+    for (int i = 0; i < SIBLINGS; i++) {
+        snprintf(patterns[i], sizeof(patterns[i]), "/r/item%d", i);
+        routes[i] = (HttpRoute){"GET", patterns[i], handle};
+    }
+
+    HttpRouter router;
+    assert(http_router_initiate(&router, routes, SIBLINGS) == 0);
+
+    // Every sibling gets its own slot, each lookup finds exactly its route
+    HttpRouteMatch match;
+    for (int i = 0; i < SIBLINGS; i++) {
+        assert(match_path(&router, "GET", patterns[i], &match) ==
+               HTTP_ROUTER_MATCH);
+        assert(match.route == &routes[i]);
+        assert(match.param_count == 0);
+    }
+
+    assert(match_path(&router, "GET", "/r/item300", &match) ==
+           HTTP_ROUTER_NOT_FOUND);
+    assert(match_path(&router, "GET", "/r/item", &match) ==
+           HTTP_ROUTER_NOT_FOUND);
+    assert(match_path(&router, "GET", "/r", &match) == HTTP_ROUTER_NOT_FOUND);
+    http_router_dispose(&router);
+}
+
+TEST(test_static_before_param) {
+    static const HttpRoute routes[] = {
+        {"GET", "/a/:id", handle},
+        {"GET", "/a/b/c", handle},
+        {"GET", "/a/:id/edit", handle},
+    };
+    HttpRouter router;
+    assert(http_router_initiate(&router, routes, 3) == 0);
+
+    HttpRouteMatch match;
+    assert(match_path(&router, "GET", "/a/b/c", &match) == HTTP_ROUTER_MATCH);
+    assert(match.route == &routes[1]);
+    assert(match.param_count == 0);
+
+    // The static b has no route of its own, so b is taken as the id
+    assert(match_path(&router, "GET", "/a/b", &match) == HTTP_ROUTER_MATCH);
+    assert(match.route == &routes[0]);
+    assert(match.param_count == 1);
+    assert(param_is(&match, "id", "b"));
+
+    // The static branch fails deeper down and the parameter one takes over
+    assert(match_path(&router, "GET", "/a/b/edit", &match) ==
+           HTTP_ROUTER_MATCH);
+    assert(match.route == &routes[2]);
+    assert(match.param_count == 1);
+    assert(param_is(&match, "id", "b"));
+
+    assert(match_path(&router, "GET", "/a/42", &match) == HTTP_ROUTER_MATCH);
+    assert(match.route == &routes[0]);
+    assert(param_is(&match, "id", "42"));
+    assert(http_route_match_param(&match, "other") == NULL);
+
+    assert(match_path(&router, "GET", "/a/b/d", &match) ==
+           HTTP_ROUTER_NOT_FOUND);
+    assert(match.param_count == 0);
+    http_router_dispose(&router);
+}
+
+TEST(test_slashes_and_empty_segments) {
+    static const HttpRoute routes[] = {
+        {"GET", "/", handle},
+        {"GET", "/v1/current", handle},
+        {"GET", "/v1/:city/current", handle},
+    };
+    HttpRouter router;
+    assert(http_router_initiate(&router, routes, 3) == 0);
+
+    HttpRouteMatch match;
+    assert(match_path(&router, "GET", "/", &match) == HTTP_ROUTER_MATCH);
+    assert(match.route == &routes[0]);
+    assert(match_path(&router, "GET", "/v1/current", &match) ==
+           HTTP_ROUTER_MATCH);
+    assert(match.route == &routes[1]);
+
+    // Only the exact path matches, and a parameter never captures ""
+    const char* misses[] = {
+        "/v1/current/", "/v1//current", "//", "/v1/", "//current", "v1/current",
+    };
+    for (size_t i = 0; i < sizeof(misses) / sizeof(misses[0]); i++) {
+        assert(match_path(&router, "GET", misses[i], &match) ==
+               HTTP_ROUTER_NOT_FOUND);
+        assert(match.param_count == 0);
+    }
+    assert(http_router_match(&router, "GET", "", 0, &match) ==
+           HTTP_ROUTER_NOT_FOUND);
+
+    // The length bounds the path, a query string behind it is never read
+    const char* url = "/v1/current?lat=1&lon=2";
+    assert(http_router_match(&router, "GET", url, 11, &match) ==
+           HTTP_ROUTER_MATCH);
+    assert(match.route == &routes[1]);
+    http_router_dispose(&router);
+}
+
+TEST(test_max_params) {
+    static const HttpRoute routes[] = {
+        {"GET", "/:p0/:p1/:p2/:p3/:p4/:p5/:p6/:p7", handle},
+        {"GET", "/:p0/:p1/:p2/:p3/:p4/:p5/:p6/:p7/:p8", handle},
+    };
+    HttpRouter router;
+    assert(http_router_initiate(&router, routes, 2) == 0);
+
+    HttpRouteMatch match;
+    assert(match_path(&router, "GET", "/a/b/c/d/e/f/g/h", &match) ==
+           HTTP_ROUTER_MATCH);
+    assert(match.route == &routes[0]);
+    assert(match.param_count == HTTP_ROUTER_MAX_PARAMS);
+    assert(param_is(&match, "p0", "a"));
+    assert(param_is(&match, "p7", "h"));
+
+    // A route needing more captures than fit never matches
+    assert(match_path(&router, "GET", "/a/b/c/d/e/f/g/h/i", &match) ==
+           HTTP_ROUTER_NOT_FOUND);
+    assert(match.param_count == 0);
+    http_router_dispose(&router);
+}
+
+TEST(test_method_not_allowed) {
+    static const HttpRoute routes[] = {
+        {"GET", "/echo", handle},
+        {"POST", "/echo", handle},
+        {"POST", "/upload", handle},
+        {"GET", "/page", handle},
+        {"HEAD", "/page", handle},
+    };
+    HttpRouter router;
+    assert(http_router_initiate(&router, routes, 5) == 0);
+
+    HttpRouteMatch match;
+    assert(match_path(&router, "DELETE", "/echo", &match) ==
+           HTTP_ROUTER_METHOD_NOT_ALLOWED);
+    assert(match.route == NULL);
+    assert(strcmp(match.allow, "GET, HEAD, POST") == 0);
+
+    assert(match_path(&router, "GET", "/upload", &match) ==
+           HTTP_ROUTER_METHOD_NOT_ALLOWED);
+    assert(strcmp(match.allow, "POST") == 0);
+    assert(match_path(&router, "HEAD", "/upload", &match) ==
+           HTTP_ROUTER_METHOD_NOT_ALLOWED);
+
+    assert(match_path(&router, "BREW", "/page", &match) ==
+           HTTP_ROUTER_METHOD_NOT_ALLOWED);
+    assert(strcmp(match.allow, "GET, HEAD") == 0);
+
+    // HEAD is served by GET unless it has a route of its own
+    assert(match_path(&router, "HEAD", "/echo", &match) == HTTP_ROUTER_MATCH);
+    assert(match.route == &routes[0]);
+    assert(match_path(&router, "HEAD", "/page", &match) == HTTP_ROUTER_MATCH);
+    assert(match.route == &routes[4]);
+    http_router_dispose(&router);
+}
+
+TEST(test_invalid_tables) {
+    static const HttpRoute duplicate[] = {
+        {"GET", "/a", handle},
+        {"GET", "/a", handle},
+    };
+    static const HttpRoute conflicting[] = {
+        {"GET", "/a/:id", handle},
+        {"GET", "/a/:name/b", handle},
+    };
+    static const HttpRoute unknown[]  = {{"BREW", "/a", handle}};
+    static const HttpRoute relative[] = {{"GET", "a", handle}};
+
+    HttpRouter router;
+    assert(http_router_initiate(&router, duplicate, 2) == -1);
+    assert(router.root == NULL);
+    assert(http_router_initiate(&router, conflicting, 2) == -1);
+    assert(http_router_initiate(&router, unknown, 1) == -1);
+    assert(http_router_initiate(&router, relative, 1) == -1);
+}
+
+int main(void) {
+    RUN_TEST(test_many_siblings);
+    RUN_TEST(test_static_before_param);
+    RUN_TEST(test_slashes_and_empty_segments);
+    RUN_TEST(test_max_params);
+    RUN_TEST(test_method_not_allowed);
+    RUN_TEST(test_invalid_tables);
+
+    printf("All router tests passed\n");
+    return 0;
+}
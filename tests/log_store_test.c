@@ -0,0 +1,314 @@
+#define _GNU_SOURCE
+#include "log_store.h"
+#include "main.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SEGMENT_SIZE 4096
+#define NEVER (time(NULL) + 3600)
+
+static char g_dir[] = "/tmp/log_store_test.XXXXXX";
+
+static void remove_dir(const char* path) {
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char file[512];
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        unlink(file);
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+/* Forces a rebuild on the next open, as after a crash */
+static void drop_index(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/index.map", g_dir);
+    assert(unlink(path) == 0);
+}
+
+/* Overwrites the first occurrence of needle in a segment file */
+static void damage_segment(uint32_t id, const char* needle) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/segment-%08u.log", g_dir, id);
+
+    int fd = open(path, O_RDWR);
+    assert(fd >= 0);
+    static char data[SEGMENT_SIZE];
+    assert(read(fd, data, sizeof(data)) == SEGMENT_SIZE);
+
+    char* found = memmem(data, sizeof(data), needle, strlen(needle));
+    assert(found != NULL);
+    memset(found, 'X', strlen(needle));
+    assert(pwrite(fd, data, sizeof(data), 0) == SEGMENT_SIZE);
+    close(fd);
+}
+
+static void put(LogStore* store, const char* key, const char* value) {
+    assert(log_store_put(store, key, value, strlen(value), NEVER) == 0);
+}
+
+static void expect_value(LogStore* store, const char* key, const char* value) {
+    LogStoreRecord record;
+    assert(log_store_get(store, key, &record) == 0);
+    assert(record.value_len == strlen(value));
+    assert(memcmp(record.value, value, record.value_len) == 0);
+}
+
+static void expect_missing(LogStore* store, const char* key) {
+    LogStoreRecord record;
+    assert(log_store_get(store, key, &record) == -1);
+}
+
+/* Writes key-NNN with a value of about 100 bytes, tagged with version */
+static void put_numbered(LogStore* store, int i, int version) {
+    char key[32], value[128];
+    snprintf(key, sizeof(key), "key-%03d", i);
+    snprintf(value, sizeof(value), "value-%03d-v%d-%080d", i, version, 0);
+    put(store, key, value);
+}
+
+/* Tells whether key-NNN is present, and with the value of version if so */
+static int has_numbered(LogStore* store, int i, int version) {
+    char key[32], value[128];
+    snprintf(key, sizeof(key), "key-%03d", i);
+    snprintf(value, sizeof(value), "value-%03d-v%d-%080d", i, version, 0);
+
+    LogStoreRecord record;
+    if (log_store_get(store, key, &record) != 0) {
+        return 0;
+    }
+    assert(record.value_len == strlen(value));
+    assert(memcmp(record.value, value, record.value_len) == 0);
+    return 1;
+}
+
+TEST(test_put_get_reopen) {
+    LogStore store;
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    assert(log_store_put(&store, "a", "first", 5, NEVER) == 0);
+    assert(log_store_put(&store, "a", "second", 6, NEVER) == 0);
+    assert(log_store_put(&store, "b", "other", 5, NEVER) == 0);
+    expect_value(&store, "a", "second");
+    expect_missing(&store, "c");
+    assert(log_store_count(&store) == 2);
+    log_store_dispose(&store);
+
+    // Clean reopen uses the saved index, unclean rebuilds it
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    expect_value(&store, "a", "second");
+    expect_value(&store, "b", "other");
+    log_store_dispose(&store);
+
+    drop_index();
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    expect_value(&store, "a", "second");
+    expect_value(&store, "b", "other");
+    assert(log_store_count(&store) == 2);
+    log_store_dispose(&store);
+}
+
+TEST(test_torn_record) {
+    LogStore store;
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    assert(log_store_put(&store, "kept", "kept-value", 10, NEVER) == 0);
+    assert(log_store_put(&store, "torn", "torn-value", 10, NEVER) == 0);
+    log_store_dispose(&store);
+
+    // The last record only half reached the disk before the crash
+    damage_segment(1, "torn-value");
+    drop_index();
+
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    expect_value(&store, "kept", "kept-value");
+    expect_missing(&store, "torn");
+    assert(log_store_count(&store) == 1);
+
+    // Writes after the damage must survive the next crash too
+    assert(log_store_put(&store, "after", "after-value", 11, NEVER) == 0);
+    expect_value(&store, "after", "after-value");
+    log_store_dispose(&store);
+
+    drop_index();
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    expect_value(&store, "kept", "kept-value");
+    expect_value(&store, "after", "after-value");
+    expect_missing(&store, "torn");
+    log_store_dispose(&store);
+}
+
+TEST(test_corrupt_record_with_index) {
+    LogStore store;
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    assert(log_store_put(&store, "good", "good-value", 10, NEVER) == 0);
+    assert(log_store_put(&store, "bad", "bad-value", 9, NEVER) == 0);
+    log_store_dispose(&store);
+
+    // The index survived, the checksum still catches the bad bytes
+    damage_segment(1, "bad-value");
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    LogStoreRecord record;
+    assert(log_store_read(&store, "bad", &record) == -1);
+    expect_missing(&store, "bad");
+    expect_value(&store, "good", "good-value");
+    assert(log_store_count(&store) == 1);
+    log_store_dispose(&store);
+}
+
+TEST(test_compaction_keeps_live_keys) {
+    LogStore store;
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+
+    // A few keys written once among many overwrites of one hot key, so
+    // sealed segments end up mostly dead
+    char key[32], value[64];
+    for (int i = 0; i < 200; i++) {
+        snprintf(value, sizeof(value), "hot-%d", i);
+        put(&store, "hot", value);
+        if (i % 20 == 0) {
+            snprintf(key, sizeof(key), "live-%d", i);
+            snprintf(value, sizeof(value), "value-%d", i);
+            put(&store, key, value);
+        }
+    }
+    assert(store.segment_count > 2);
+    size_t before = log_store_disk_size(&store);
+
+    while (log_store_compact_step(&store, time(NULL)) == 1) {
+    }
+    assert(store.compacted_segments > 0);
+    assert(log_store_disk_size(&store) < before);
+    assert(log_store_count(&store) == 11);
+
+    for (int pass = 0; pass < 2; pass++) {
+        expect_value(&store, "hot", "hot-199");
+        for (int i = 0; i < 200; i += 20) {
+            snprintf(key, sizeof(key), "live-%d", i);
+            snprintf(value, sizeof(value), "value-%d", i);
+            expect_value(&store, key, value);
+        }
+
+        // And the moved records are found again after a crash
+        log_store_dispose(&store);
+        drop_index();
+        assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+        assert(log_store_count(&store) == 11);
+    }
+    log_store_dispose(&store);
+}
+
+TEST(test_compaction_drops_expired) {
+    LogStore store;
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    time_t now = time(NULL);
+    assert(log_store_put(&store, "stale", "old", 3, now + 10) == 0);
+    assert(log_store_put(&store, "fresh", "new", 3, now + 1000) == 0);
+
+    log_store_compact_step(&store, now + 100);
+    expect_missing(&store, "stale");
+    expect_value(&store, "fresh", "new");
+    assert(store.expired_records == 1);
+    log_store_dispose(&store);
+}
+
+TEST(test_evict_over_byte_limit) {
+    LogStore store;
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    for (int i = 0; i < 100; i++) {
+        put_numbered(&store, i, 1);
+    }
+    assert(store.segment_count > 2);
+    uint32_t oldest = store.segments[0].id;
+
+    // Just over the limit, the oldest segment goes and nothing else
+    log_store_set_limits(&store, log_store_disk_size(&store) - 1, 0);
+    assert(log_store_compact_step(&store, time(NULL)) == 1);
+    assert(store.evicted_segments == 1);
+    assert(store.segments[0].id != oldest);
+    assert(log_store_disk_size(&store) <= store.max_bytes);
+
+    // Keys were written in order, so exactly the first ones are gone
+    size_t evicted = store.evicted_records;
+    assert(evicted > 0 && evicted < 100);
+    assert(log_store_count(&store) == 100 - evicted);
+    for (int i = 0; i < 100; i++) {
+        assert(has_numbered(&store, i, 1) == ((size_t)i >= evicted));
+    }
+
+    // Under the limit again, the next step does not evict
+    log_store_compact_step(&store, time(NULL));
+    assert(store.evicted_segments == 1);
+    log_store_dispose(&store);
+}
+
+TEST(test_evict_over_key_limit) {
+    LogStore store;
+    assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+    for (int i = 0; i < 100; i++) {
+        put_numbered(&store, i, 1);
+    }
+
+    // Rewritten late, so these are among the newest records
+    put_numbered(&store, 5, 2);
+    put_numbered(&store, 10, 2);
+
+    log_store_set_limits(&store, 0, 30);
+    while (log_store_count(&store) > 30) {
+        assert(log_store_compact_step(&store, time(NULL)) == 1);
+    }
+    assert(log_store_count(&store) == 30);
+    assert(store.evicted_records == 70);
+
+    // The oldest 70 in write order, skipping the two rewritten keys
+    for (int pass = 0; pass < 2; pass++) {
+        assert(has_numbered(&store, 5, 2));
+        assert(has_numbered(&store, 10, 2));
+        for (int i = 0; i < 100; i++) {
+            if (i != 5 && i != 10) {
+                assert(has_numbered(&store, i, 1) == (i >= 72));
+            }
+        }
+
+        // Compaction may reclaim the evicted records, the keys stay put
+        while (log_store_compact_step(&store, time(NULL)) == 1) {
+        }
+        assert(log_store_count(&store) == 30);
+
+        log_store_dispose(&store);
+        assert(log_store_initiate(&store, g_dir, SEGMENT_SIZE) == 0);
+        log_store_set_limits(&store, 0, 30);
+        assert(log_store_count(&store) == 30);
+    }
+    log_store_dispose(&store);
+}
+
+/* Every test starts from an empty directory */
+#define RUN_STORE_TEST(name)                                                   \
+    do {                                                                       \
+        strcpy(g_dir + sizeof(g_dir) - 7, "XXXXXX");                           \
+        assert(mkdtemp(g_dir) != NULL);                                        \
+        RUN_TEST(name);                                                        \
+        remove_dir(g_dir);                                                     \
+    } while (0)
+
+int main(void) {
+    RUN_STORE_TEST(test_put_get_reopen);
+    RUN_STORE_TEST(test_torn_record);
+    RUN_STORE_TEST(test_corrupt_record_with_index);
+    RUN_STORE_TEST(test_compaction_keeps_live_keys);
+    RUN_STORE_TEST(test_compaction_drops_expired);
+    RUN_STORE_TEST(test_evict_over_byte_limit);
+    RUN_STORE_TEST(test_evict_over_key_limit);
+
+    printf("All log store tests passed\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "main.h"
+#include "smw.h"
+
+#include <stdio.h>
+
+static int g_runs;
+
+static void count_work(void* context, uint64_t mon_time) {
+    (void)context;
+    (void)mon_time;
+    g_runs++;
+}
+
+static void destroy_self_work(void* context, uint64_t mon_time) {
+    (void)mon_time;
+    g_runs++;
+    smw_destroy_task(*(SmwTask**)context);
+}
+
+TEST(test_double_destroy) {
+    SmwTask* first  = smw_create_task(NULL, count_work);
+    SmwTask* second = smw_create_task(NULL, count_work);
+    assert(smw_get_task_count() == 2);
+
+    smw_destroy_task(first);
+    smw_destroy_task(first);
+    assert(smw_get_task_count() == 1);
+    assert(g_smw.tasks.head == &second->hook);
+    assert(g_smw.tasks.tail == &second->hook);
+    assert(g_smw.pool.size == 1);
+
+    g_runs = 0;
+    smw_work(0);
+    assert(g_runs == 1);
+
+    smw_destroy_task(second);
+    assert(smw_get_task_count() == 0);
+    assert(g_smw.pool.size == 2);
+}
+
+TEST(test_destroy_inside_work) {
+    SmwTask* self  = NULL;
+    self           = smw_create_task(&self, destroy_self_work);
+    SmwTask* after = smw_create_task(NULL, count_work);
+
+    // The task after the destroyed one still runs in the same pass
+    g_runs = 0;
+    smw_work(0);
+    assert(g_runs == 2);
+    assert(smw_get_task_count() == 1);
+
+    // Pooled tasks are handed out again
+    SmwTask* reused = smw_create_task(NULL, count_work);
+    assert(reused == self);
+    smw_destroy_task(reused);
+    smw_destroy_task(after);
+    assert(smw_get_task_count() == 0);
+}
+
+int main(void) {
+    assert(smw_init() == 0);
+
+    RUN_TEST(test_double_destroy);
+    RUN_TEST(test_destroy_inside_work);
+
+    smw_dispose();
+
+    printf("All smw tests passed\n");
+    return 0;
+}
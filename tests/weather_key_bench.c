@@ -0,0 +1,108 @@
+#include "cache.h"
+#include "weather_key.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define LOCATIONS 1024
+#define ROUNDS 2000000
+
+static float g_lat[LOCATIONS];
+static float g_lon[LOCATIONS];
+
+static volatile uint64_t g_sink;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Memory cache key as it was built before keys were binary */
+static void string_key(float lat, float lon, char* out) {
+    char name[256];
+    int  len = snprintf(name, sizeof(name), "weather_%.6f_%.6f", lat, lon);
+    hash_md5_string(name, (size_t)len, out, HASH_MD5_STRING_LENGTH);
+}
+
+static void keep(void* data) { (void)data; }
+
+static void report(const char* name, double before, double after) {
+    printf("  %-28s %9.1f ns -> %7.1f ns  (%.0fx)\n", name, before, after,
+           before / after);
+}
+
+int main(void) {
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (int i = 0; i < LOCATIONS; i++) {
+        state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+        g_lat[i] = (float)(state % 180000000) / 1e6f - 90.0f;
+        state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+        g_lon[i] = (float)(state % 360000000) / 1e6f - 180.0f;
+    }
+
+    printf("Weather key derivation, %d locations, ns per call:\n", LOCATIONS);
+
+    // Memory key: snprintf + MD5 before, packing the integers after
+    int    rounds = ROUNDS / 20;
+    char   key[HASH_MD5_STRING_LENGTH];
+    double start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        string_key(g_lat[i % LOCATIONS], g_lon[i % LOCATIONS], key);
+        g_sink += (uint8_t)key[0];
+    }
+    double before = (now_ns() - start) / rounds;
+
+    start = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        g_sink += weather_key_make(g_lat[i % LOCATIONS], g_lon[i % LOCATIONS]);
+    }
+    report("memory key", before, (now_ns() - start) / ROUNDS);
+
+    // Disk store name: the same MD5 either way, formatted without snprintf
+    WeatherKey keys[LOCATIONS];
+    for (int i = 0; i < LOCATIONS; i++) {
+        keys[i] = weather_key_make(g_lat[i], g_lon[i]);
+    }
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        weather_key_store_name(keys[i % LOCATIONS], key);
+        g_sink += (uint8_t)key[0];
+    }
+    report("store name", before, (now_ns() - start) / rounds);
+
+    // Cache hit, deriving the key included
+    Cache* by_string = cache_create(LOCATIONS, 3600);
+    Cache* by_id     = cache_create(LOCATIONS, 3600);
+    if (by_string == NULL || by_id == NULL) {
+        return 1;
+    }
+    static int values[LOCATIONS];
+    cache_set_free_data(by_string, keep);
+    cache_set_free_data(by_id, keep);
+    for (int i = 0; i < LOCATIONS; i++) {
+        string_key(g_lat[i], g_lon[i], key);
+        cache_insert(by_string, key, &values[i], sizeof(int), 0);
+        cache_insert_id(by_id, keys[i], &values[i], sizeof(int), 0);
+    }
+
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        string_key(g_lat[i % LOCATIONS], g_lon[i % LOCATIONS], key);
+        g_sink += (uintptr_t)cache_peek(by_string, key, NULL);
+    }
+    before = (now_ns() - start) / rounds;
+
+    start = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        int        at = i % LOCATIONS;
+        WeatherKey id = weather_key_make(g_lat[at], g_lon[at]);
+        g_sink += (uintptr_t)cache_peek_id(by_id, id, NULL);
+    }
+    report("cache hit, key included", before, (now_ns() - start) / ROUNDS);
+
+    cache_destroy(by_string);
+    cache_destroy(by_id);
+    return 0;
+}
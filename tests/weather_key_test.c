@@ -0,0 +1,188 @@
+#include "cache.h"
+#include "main.h"
+#include "weather_key.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SAMPLES 200000
+
+static uint64_t g_state = 0x853c49e6748fea9bull;
+
+/* xorshift64*, the same sequence on every run */
+static uint64_t next_random(void) {
+    g_state ^= g_state >> 12;
+    g_state ^= g_state << 25;
+    g_state ^= g_state >> 27;
+    return g_state * 0x2545f4914f6cdd1dull;
+}
+
+static float random_coordinate(float max) {
+    double unit = (double)(next_random() >> 11) / (double)(1ull << 53);
+    return (float)((unit * 2.0 - 1.0) * max);
+}
+
+/* How the caches named a location before keys were binary */
+static int old_store_name(float lat, float lon, char* out) {
+    char name[256];
+    int  len = snprintf(name, sizeof(name), "weather_%.6f_%.6f", lat, lon);
+    return hash_md5_string(name, (size_t)len, out, HASH_MD5_STRING_LENGTH);
+}
+
+static int g_freed = 0;
+
+static int insert(Cache* cache, WeatherKey key, int* value) {
+    return cache_insert_id(cache, key, value, sizeof(int), 0);
+}
+
+static void count_free(void* data) {
+    (void)data;
+    g_freed++;
+}
+
+TEST(test_make) {
+    WeatherKey key = weather_key_make(59.3293f, 18.0686f);
+    assert(key != WEATHER_KEY_INVALID);
+    assert(key == weather_key_make(59.3293f, 18.0686f));
+    assert(key != weather_key_make(18.0686f, 59.3293f));
+
+    // The whole range is valid, nothing past it
+    assert(weather_key_make(90.0f, 180.0f) != WEATHER_KEY_INVALID);
+    assert(weather_key_make(-90.0f, -180.0f) != WEATHER_KEY_INVALID);
+    assert(weather_key_make(0.0f, 0.0f) != WEATHER_KEY_INVALID);
+    assert(weather_key_make(90.001f, 0.0f) == WEATHER_KEY_INVALID);
+    assert(weather_key_make(0.0f, -180.001f) == WEATHER_KEY_INVALID);
+    assert(weather_key_make(NAN, 0.0f) == WEATHER_KEY_INVALID);
+    assert(weather_key_make(0.0f, INFINITY) == WEATHER_KEY_INVALID);
+
+    // Coordinates rounding to the same micro-degree share a key
+    assert(weather_key_make(1.0000001f, 2.0f) == weather_key_make(1.0f, 2.0f));
+}
+
+TEST(test_format) {
+    char out[WEATHER_KEY_STRING_LENGTH];
+
+    weather_key_format(weather_key_make(59.3293f, 18.0686f), out);
+    assert(strcmp(out, "59.329300,18.068600") == 0);
+
+    // Six decimals of the float, not of the literal
+    weather_key_format(weather_key_make(-33.8688f, 151.2093f), out);
+    assert(strcmp(out, "-33.868801,151.209305") == 0);
+
+    weather_key_format(weather_key_make(-90.0f, -180.0f), out);
+    assert(strcmp(out, "-90.000000,-180.000000") == 0);
+
+    weather_key_format(weather_key_make(0.0f, -0.5f), out);
+    assert(strcmp(out, "0.000000,-0.500000") == 0);
+}
+
+TEST(test_round_trip) {
+    // Formatting and naming match what snprintf gave for the same floats
+    for (int i = 0; i < SAMPLES; i++) {
+        float      lat = random_coordinate(90.0f);
+        float      lon = random_coordinate(180.0f);
+        WeatherKey key = weather_key_make(lat, lon);
+        assert(key != WEATHER_KEY_INVALID);
+
+        assert(weather_key_make(weather_key_latitude(key),
+                                weather_key_longitude(key)) == key);
+
+        char expected[64], out[WEATHER_KEY_STRING_LENGTH];
+        snprintf(expected, sizeof(expected), "%.6f,%.6f", lat, lon);
+        weather_key_format(key, out);
+        assert(strcmp(out, expected) == 0);
+
+        if (i % 16 == 0) {
+            char old_name[HASH_MD5_STRING_LENGTH];
+            char name[HASH_MD5_STRING_LENGTH];
+            assert(old_store_name(lat, lon, old_name) == 0);
+            assert(weather_key_store_name(key, name) == 0);
+            assert(strcmp(name, old_name) == 0);
+        }
+    }
+
+    char name[HASH_MD5_STRING_LENGTH];
+    assert(weather_key_store_name(WEATHER_KEY_INVALID, name) == -1);
+}
+
+TEST(test_cache_eviction) {
+    Cache* cache = cache_create(3, 60);
+    assert(cache != NULL);
+    cache_set_free_data(cache, count_free);
+    g_freed = 0;
+
+    static int values[4];
+    WeatherKey keys[4];
+    for (int i = 0; i < 4; i++) {
+        keys[i] = weather_key_make(10.0f + i, 20.0f);
+    }
+    for (int i = 0; i < 3; i++) {
+        assert(insert(cache, keys[i], &values[i]) == 0);
+    }
+
+    size_t size = 0;
+    assert(cache_peek_id(cache, keys[1], &size) == &values[1]);
+    assert(size == sizeof(int));
+
+    // Full, the oldest entry makes room
+    assert(insert(cache, keys[3], &values[3]) == 0);
+    assert(g_freed == 1);
+    assert(cache_peek_id(cache, keys[0], NULL) == NULL);
+    for (int i = 1; i < 4; i++) {
+        assert(cache_peek_id(cache, keys[i], NULL) == &values[i]);
+    }
+
+    // Replacing a key frees the old data, nothing else goes
+    assert(insert(cache, keys[1], &values[0]) == 0);
+    assert(g_freed == 2);
+    assert(cache_peek_id(cache, keys[1], NULL) == &values[0]);
+    assert(cache_peek_id(cache, keys[2], NULL) == &values[2]);
+
+    // A string key spelling the same coordinates is another entry
+    assert(cache_peek(cache, "10.000000,20.000000", NULL) == NULL);
+
+    cache_remove_id(cache, keys[2]);
+    assert(g_freed == 3);
+    assert(cache_peek_id(cache, keys[2], NULL) == NULL);
+
+    cache_destroy(cache);
+    assert(g_freed == 5);
+}
+
+TEST(test_cache_expiry) {
+    Cache* cache = cache_create(8, 60);
+    assert(cache != NULL);
+    cache_set_free_data(cache, count_free);
+    g_freed = 0;
+
+    static int stale, fresh;
+    WeatherKey stale_key = weather_key_make(1.0f, 2.0f);
+    WeatherKey fresh_key = weather_key_make(3.0f, 4.0f);
+    assert(cache_insert_id(cache, stale_key, &stale, sizeof(int), 1) == 0);
+    assert(insert(cache, fresh_key, &fresh) == 0);
+
+    // Backdated rather than slept past, the oldest entry is the head
+    ListHook*   oldest = cache->entries.head;
+    CacheEntry* entry  = IntrusiveList_entry(oldest, CacheEntry, hook);
+    assert(entry->data == &stale);
+    assert(entry->expiry == entry->timestamp + 1);
+    entry->expiry = time(NULL) - 1;
+
+    assert(cache_peek_id(cache, stale_key, NULL) == NULL);
+    assert(g_freed == 1);
+    assert(cache_peek_id(cache, fresh_key, NULL) == &fresh);
+
+    cache_destroy(cache);
+}
+
+int main(void) {
+    RUN_TEST(test_make);
+    RUN_TEST(test_format);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_cache_eviction);
+    RUN_TEST(test_cache_expiry);
+
+    printf("All weather key tests passed\n");
+    return 0;
+}
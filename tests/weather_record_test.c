@@ -0,0 +1,129 @@
+#include "main.h"
+#include "weather_record.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void sample(WeatherData* data) {
+    memset(data, 0, sizeof(WeatherData));
+    data->timestamp     = 1760781600;
+    data->interval      = 900;
+    data->fetched_at    = 1760781723;
+    data->ttl_percent   = 150;
+    data->weather_code  = 61;
+    data->temperature   = -3.25;
+    data->windspeed     = 12.5;
+    data->winddirection = 275;
+    data->precipitation = 0.4;
+    data->humidity      = 87.0;
+    data->pressure      = 1013.2;
+    data->is_day        = 1;
+    data->latitude      = 59.3293f;
+    data->longitude     = -18.0686f;
+    strcpy(data->temperature_unit, "°C");
+    strcpy(data->windspeed_unit, "km/h");
+    strcpy(data->winddirection_unit, "°");
+    strcpy(data->precipitation_unit, "mm");
+}
+
+TEST(test_round_trip) {
+    WeatherData data, decoded;
+    uint8_t     record[WEATHER_RECORD_SIZE];
+    sample(&data);
+    weather_record_encode(&data, record);
+
+    // Little-endian magic at the start, whatever the host
+    assert(memcmp(record, "JWWD", 4) == 0);
+
+    memset(&decoded, 0xAA, sizeof(decoded));
+    assert(weather_record_decode(record, sizeof(record), &decoded) == 0);
+    assert(decoded.timestamp == data.timestamp);
+    assert(decoded.interval == data.interval);
+    assert(decoded.fetched_at == data.fetched_at);
+    assert(decoded.ttl_percent == data.ttl_percent);
+    assert(decoded.weather_code == data.weather_code);
+    assert(decoded.temperature == data.temperature);
+    assert(decoded.windspeed == data.windspeed);
+    assert(decoded.winddirection == data.winddirection);
+    assert(decoded.precipitation == data.precipitation);
+    assert(decoded.humidity == data.humidity);
+    assert(decoded.pressure == data.pressure);
+    assert(decoded.is_day == data.is_day);
+    assert(decoded.latitude == data.latitude);
+    assert(decoded.longitude == data.longitude);
+    assert(strcmp(decoded.temperature_unit, data.temperature_unit) == 0);
+    assert(strcmp(decoded.windspeed_unit, data.windspeed_unit) == 0);
+    assert(strcmp(decoded.winddirection_unit, data.winddirection_unit) == 0);
+    assert(strcmp(decoded.precipitation_unit, data.precipitation_unit) == 0);
+
+    // The same data always encodes to the same bytes
+    uint8_t again[WEATHER_RECORD_SIZE];
+    weather_record_encode(&decoded, again);
+    assert(memcmp(record, again, sizeof(record)) == 0);
+}
+
+TEST(test_long_unit) {
+    WeatherData data, decoded;
+    uint8_t     record[WEATHER_RECORD_SIZE];
+    sample(&data);
+    memset(data.windspeed_unit, 'u', sizeof(data.windspeed_unit) - 1);
+    data.windspeed_unit[sizeof(data.windspeed_unit) - 1] = '\0';
+
+    weather_record_encode(&data, record);
+    assert(weather_record_decode(record, sizeof(record), &decoded) == 0);
+    assert(strcmp(decoded.windspeed_unit, data.windspeed_unit) == 0);
+}
+
+TEST(test_truncated) {
+    WeatherData data, decoded;
+    uint8_t     record[WEATHER_RECORD_SIZE];
+    sample(&data);
+    weather_record_encode(&data, record);
+
+    assert(weather_record_decode(record, 0, &decoded) == -1);
+    assert(weather_record_decode(record, 8, &decoded) == -1);
+    assert(weather_record_decode(record, sizeof(record) - 1, &decoded) == -1);
+}
+
+TEST(test_wrong_header) {
+    WeatherData data, decoded;
+    uint8_t     record[WEATHER_RECORD_SIZE];
+    sample(&data);
+
+    weather_record_encode(&data, record);
+    record[0] ^= 0xFF; // Magic
+    assert(weather_record_decode(record, sizeof(record), &decoded) == -1);
+
+    weather_record_encode(&data, record);
+    record[4]++; // Version
+    assert(weather_record_decode(record, sizeof(record), &decoded) == -1);
+
+    weather_record_encode(&data, record);
+    record[6]--; // Size
+    assert(weather_record_decode(record, sizeof(record), &decoded) == -1);
+}
+
+TEST(test_corrupt) {
+    WeatherData data, decoded;
+    uint8_t     record[WEATHER_RECORD_SIZE];
+    sample(&data);
+
+    // A flipped bit up to the end of the checksum fails it, the last 4 bytes
+    // are padding
+    for (size_t i = 8; i < WEATHER_RECORD_SIZE - 4; i++) {
+        weather_record_encode(&data, record);
+        record[i] ^= 0x10;
+        assert(weather_record_decode(record, sizeof(record), &decoded) == -2);
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_long_unit);
+    RUN_TEST(test_truncated);
+    RUN_TEST(test_wrong_header);
+    RUN_TEST(test_corrupt);
+
+    printf("All weather record tests passed\n");
+    return 0;
+}